@@ -0,0 +1,137 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        acquisition.h
+//
+// Description:
+//
+//   Clocked sampling of a PMS7003 in passive mode.  Samples are due every
+//   period on a fixed grid (due += period, not now + period), so delays
+//   in one cycle don't push later ones back; a cycle that falls a whole
+//   period behind is skipped and counted instead of bursting to catch
+//   up.  Each due time sends a read request and waits up to a timeout for
+//   the answer.
+//
+//   step() never blocks.  The caller runs it whenever msUntilNext() says
+//   and gets true back when a new reading is ready.  SampleStats records
+//   the period actually achieved between readings and how far it strays
+//   from the nominal one.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <pms7003.h>
+
+#define ACQUIRE_SETTLE_MS   30000   // Fan spin-up before the first sample
+#define ACQUIRE_TIMEOUT_MS  500     // Longest wait for a requested reading
+#define ACQUIRE_POLL_MS     10      // UART check interval while waiting
+
+struct SampleStats {
+    uint32_t samples;
+    uint32_t timeouts;          // Requests the sensor never answered
+    uint32_t skipped;           // Due times missed by a whole period
+    uint32_t intervals;         // Back-to-back reading pairs measured below
+    uint32_t periodLastUs;      // Time between the last two readings
+    uint32_t periodMinUs;
+    uint32_t periodMaxUs;
+    uint32_t jitterMaxUs;       // Largest |period - nominal|
+    uint64_t jitterTotalUs;     // Sum of |period - nominal|, for the mean
+};
+
+class Acquisition {
+public:
+    Acquisition(Pms7003 &sensor, uint32_t periodMs) : m_sensor(sensor), m_periodMs(periodMs) {}
+
+    void begin(uint32_t nowMs) {
+        m_sensor.setPassive(true);
+        m_due = nowMs + ACQUIRE_SETTLE_MS;
+        m_waiting = false;
+        m_lastUs = 0;
+        m_stats = {};
+        m_stats.periodMinUs = UINT32_MAX;
+    }
+
+    // Advances the request/response cycle; true when reading() is new
+    bool step(uint32_t nowMs, uint32_t nowUs) {
+        if (m_waiting) {
+            if (m_sensor.poll()) {
+                m_waiting = false;
+                recordSample(nowUs);
+                return true;
+            }
+            if (nowMs - m_requestedAt >= ACQUIRE_TIMEOUT_MS) {
+                m_waiting = false;
+                m_stats.timeouts++;
+                m_lastUs = 0;  // Don't count the gap as jitter
+            }
+            return false;
+        }
+
+        m_sensor.poll();  // Drop acks and anything unrequested
+        if ((int32_t)(nowMs - m_due) < 0) {
+            return false;
+        }
+        m_sensor.requestRead();
+        m_requestedAt = nowMs;
+        m_waiting = true;
+        m_due += m_periodMs;
+        if ((int32_t)(nowMs - m_due) >= 0) {
+            uint32_t behind = (nowMs - m_due) / m_periodMs + 1;
+            m_stats.skipped += behind;
+            m_due += behind * m_periodMs;
+            m_lastUs = 0;  // Counted as skipped, not as jitter
+        }
+        return false;
+    }
+
+    // How long the caller may sleep before step() has work to do
+    uint32_t msUntilNext(uint32_t nowMs) const {
+        if (m_waiting) {
+            return ACQUIRE_POLL_MS;
+        }
+        int32_t left = (int32_t)(m_due - nowMs);
+        return left > 0 ? left : 0;
+    }
+
+    // Changes the period from the next sample on.  A shorter one pulls
+    // the next due time in, except while the fan is still settling.
+    void setPeriod(uint32_t periodMs, uint32_t nowMs) {
+        if (m_stats.samples && (int32_t)(m_due - (nowMs + periodMs)) > 0) {
+            m_due = nowMs + periodMs;
+        }
+        m_periodMs = periodMs;
+        m_lastUs = 0;  // The next interval is neither period; don't count it as jitter
+    }
+
+    const PmsReading &reading() const { return m_sensor.reading(); }
+    const SampleStats &stats() const { return m_stats; }
+    uint32_t periodMs() const { return m_periodMs; }
+
+private:
+    void recordSample(uint32_t nowUs) {
+        m_stats.samples++;
+        if (m_lastUs) {
+            uint32_t period = nowUs - m_lastUs;
+            uint32_t nominal = m_periodMs * 1000;
+            uint32_t jitter = period > nominal ? period - nominal : nominal - period;
+            m_stats.intervals++;
+            m_stats.periodLastUs = period;
+            m_stats.periodMinUs = period < m_stats.periodMinUs ? period : m_stats.periodMinUs;
+            m_stats.periodMaxUs = period > m_stats.periodMaxUs ? period : m_stats.periodMaxUs;
+            m_stats.jitterMaxUs = jitter > m_stats.jitterMaxUs ? jitter : m_stats.jitterMaxUs;
+            m_stats.jitterTotalUs += jitter;
+        }
+        m_lastUs = nowUs ? nowUs : 1;
+    }
+
+    Pms7003 &m_sensor;
+    uint32_t m_periodMs;
+    uint32_t m_due = 0;
+    uint32_t m_requestedAt = 0;
+    bool m_waiting = false;
+    uint32_t m_lastUs = 0;      // Arrival of the previous reading, 0 = none
+    SampleStats m_stats = {};
+};
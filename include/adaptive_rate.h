@@ -0,0 +1,202 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        adaptive_rate.h
+//
+// Description:
+//
+//   How often to sample the sensor and report to the mesh, from what the
+//   air is doing.  AdaptiveRate moves between three tiers:
+//
+//     calm    clean, steady air: sample every 10 s, report every minute
+//     active  the old fixed rates: sample every 2 s, report every 10 s
+//     event   smoke: sample every second, report every 5 s
+//
+//   A tier is entered as soon as pm2.5 or its rate of change reaches the
+//   tier's threshold, and left one step at a time once neither has been
+//   there for RATE_HOLD_MS, so a plume that comes and goes doesn't make
+//   the rate flap.  The rate of change is measured against a reading
+//   between RATE_SLOPE_MIN_MS and RATE_SLOPE_WINDOW_MS old, in ug/m3 per
+//   minute.
+//
+//   AirtimeBudget caps what one node puts on the mesh, whatever its tier:
+//   a token bucket in bytes that fills at RATE_AIRTIME_BYTES_PER_MIN and
+//   holds RATE_AIRTIME_BURST_BYTES, so an event reports at full rate for
+//   a while and then no faster than the budget.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+#define RATE_HOLD_MS                300000  // Below a tier this long before stepping down
+#define RATE_SLOPE_MIN_MS           30000   // Shortest span a rate of change is taken over; a
+                                            // 1 ug/m3 step over it stays under 3/min
+#define RATE_SLOPE_WINDOW_MS        120000  // Longest
+#ifndef RATE_AIRTIME_BYTES_PER_MIN
+#define RATE_AIRTIME_BYTES_PER_MIN  3000    // About a 200-byte reading every 4 s
+#endif
+#ifndef RATE_AIRTIME_BURST_BYTES
+#define RATE_AIRTIME_BURST_BYTES    12000
+#endif
+
+enum RateTier {
+    RATE_CALM,
+    RATE_ACTIVE,
+    RATE_EVENT,
+    RATE_TIER_COUNT
+};
+
+static const char *const kRateTierNames[RATE_TIER_COUNT] = { "calm", "active", "event" };
+
+struct RateTierConfig {
+    uint32_t sampleMs;
+    uint32_t reportMs;
+    uint16_t pm25;          // Entered at this pm2.5, ug/m3 ...
+    uint16_t slopePerMin;   // ... or this rise or fall per minute
+};
+
+// pm2.5 thresholds at the tops of the EPA "good" and "moderate" bands
+static const RateTierConfig kRateTiers[RATE_TIER_COUNT] = {
+    { 10000, 60000, 0, 0 },
+    { 2000, 10000, 12, 3 },
+    { 1000, 5000, 35, 15 },
+};
+
+struct RateStats {
+    uint32_t escalations;   // Steps up, several at once counting once
+    uint32_t decays;        // Steps down
+    uint32_t tierMs[RATE_TIER_COUNT];  // Time spent in each, to the last update
+};
+
+class AdaptiveRate {
+public:
+    explicit AdaptiveRate(const RateTierConfig *tiers = kRateTiers) : m_tiers(tiers) {}
+
+    // Starts in the active tier, the rates before any reading is in
+    void begin(uint32_t nowMs) {
+        m_tier = RATE_ACTIVE;
+        m_heldSince = nowMs;
+        m_lastMs = nowMs;
+        m_haveRef = false;
+        m_slope = 0;
+        m_stats = {};
+    }
+
+    // Takes a pm2.5 reading; true when the tier changed
+    bool update(uint32_t nowMs, uint16_t pm25) {
+        m_stats.tierMs[m_tier] += nowMs - m_lastMs;
+        m_lastMs = nowMs;
+        if (!m_haveRef) {
+            m_haveRef = true;
+            m_refMs = nowMs;
+            m_refPm25 = pm25;
+        }
+        uint32_t span = nowMs - m_refMs;
+        if (span >= RATE_SLOPE_MIN_MS) {
+            m_slope = (int32_t)((int64_t)((int32_t)pm25 - m_refPm25) * 60000 / (int32_t)span);
+            if (span >= RATE_SLOPE_WINDOW_MS) {
+                m_refMs = nowMs;
+                m_refPm25 = pm25;
+            }
+        }
+
+        uint32_t slope = m_slope < 0 ? -m_slope : m_slope;
+        int wanted = RATE_CALM;
+        for (int t = RATE_TIER_COUNT - 1; t > RATE_CALM; t--) {
+            if (pm25 >= m_tiers[t].pm25 || slope >= m_tiers[t].slopePerMin) {
+                wanted = t;
+                break;
+            }
+        }
+        if (wanted >= m_tier) {
+            m_heldSince = nowMs;
+            if (wanted == m_tier) {
+                return false;
+            }
+            m_tier = (RateTier)wanted;
+            m_stats.escalations++;
+            return true;
+        }
+        if (nowMs - m_heldSince < RATE_HOLD_MS) {
+            return false;
+        }
+        m_tier = (RateTier)(m_tier - 1);
+        m_heldSince = nowMs;
+        m_stats.decays++;
+        return true;
+    }
+
+    RateTier tier() const { return m_tier; }
+    uint32_t sampleMs() const { return m_tiers[m_tier].sampleMs; }
+    uint32_t reportMs() const { return m_tiers[m_tier].reportMs; }
+    int32_t slopePerMin() const { return m_slope; }
+    const RateStats &stats() const { return m_stats; }
+
+private:
+    const RateTierConfig *m_tiers;
+    RateTier m_tier = RATE_ACTIVE;
+    uint32_t m_heldSince = 0;   // Last time the tier's conditions held
+    uint32_t m_lastMs = 0;
+    bool m_haveRef = false;
+    uint32_t m_refMs = 0;       // Reading the rate of change is measured from
+    uint16_t m_refPm25 = 0;
+    int32_t m_slope = 0;
+    RateStats m_stats = {};
+};
+
+class AirtimeBudget {
+public:
+    AirtimeBudget(uint32_t bytesPerMin = RATE_AIRTIME_BYTES_PER_MIN, uint32_t burstBytes = RATE_AIRTIME_BURST_BYTES)
+        : m_rate(bytesPerMin), m_capacity((uint64_t)burstBytes * 60000), m_level(m_capacity) {}
+
+    // Spends bytes of airtime if the bucket holds them
+    bool take(uint32_t nowMs, uint32_t bytes) {
+        refill(nowMs);
+        uint64_t cost = (uint64_t)bytes * 60000;
+        if (m_level < cost) {
+            m_throttled++;
+            return false;
+        }
+        m_level -= cost;
+        return true;
+    }
+
+    // How long until take(bytes) would succeed; UINT32_MAX if it never
+    // will, with no refill or more than the bucket holds
+    uint32_t msUntil(uint32_t nowMs, uint32_t bytes) {
+        refill(nowMs);
+        uint64_t cost = (uint64_t)bytes * 60000;
+        if (m_level >= cost) {
+            return 0;
+        }
+        if (!m_rate || cost > m_capacity) {
+            return UINT32_MAX;
+        }
+        uint64_t ms = (cost - m_level + m_rate - 1) / m_rate;
+        return ms < UINT32_MAX ? (uint32_t)ms : UINT32_MAX;
+    }
+
+    uint32_t throttled() const { return m_throttled; }
+
+private:
+    // The level is in bytes x 60000, so a millisecond of refill is whole
+    void refill(uint32_t nowMs) {
+        if (m_started) {
+            m_level += (uint64_t)(nowMs - m_lastMs) * m_rate;
+            m_level = m_level < m_capacity ? m_level : m_capacity;
+        }
+        m_started = true;
+        m_lastMs = nowMs;
+    }
+
+    uint32_t m_rate;
+    uint64_t m_capacity;
+    uint64_t m_level;
+    uint32_t m_lastMs = 0;
+    bool m_started = false;
+    uint32_t m_throttled = 0;
+};
@@ -0,0 +1,91 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        aqi.h
+//
+// Description:
+//
+//   US EPA Air Quality Index from PM2.5 and PM10 concentrations, using the
+//   2024 breakpoint tables.  Concentrations are passed in tenths of
+//   ug/m3 so the whole calculation stays in integers; text readings go
+//   through Fixed16 to get there.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <fixed_point.h>
+
+struct AqiBreakpoint {
+    uint16_t cLow, cHigh;       // Concentration range, tenths of ug/m3
+    uint16_t iLow, iHigh;       // Index range
+};
+
+static const AqiBreakpoint kAqiPm25[] = {
+    {    0,   90,   0,  50 },
+    {   91,  354,  51, 100 },
+    {  355,  554, 101, 150 },
+    {  555, 1254, 151, 200 },
+    { 1255, 2254, 201, 300 },
+    { 2255, 3254, 301, 500 },
+};
+
+static const AqiBreakpoint kAqiPm10[] = {
+    {    0,  540,   0,  50 },
+    {  550, 1540,  51, 100 },
+    { 1550, 2540, 101, 150 },
+    { 2550, 3540, 151, 200 },
+    { 3550, 4240, 201, 300 },
+    { 4250, 6040, 301, 500 },
+};
+
+// Linear interpolation inside the matching band; clamps to 500 above the table
+inline uint16_t aqiFromTable(const AqiBreakpoint *table, int rows, uint32_t tenths) {
+    for (int i = 0; i < rows; i++) {
+        const AqiBreakpoint &b = table[i];
+        if (tenths <= b.cHigh) {
+            if (tenths < b.cLow) {
+                tenths = b.cLow;  // Gap between bands after truncation
+            }
+            uint32_t span = b.cHigh - b.cLow;
+            return b.iLow + ((tenths - b.cLow) * (b.iHigh - b.iLow) + span / 2) / span;
+        }
+    }
+    return 500;
+}
+
+inline uint16_t aqiPm25(uint32_t tenths) {
+    return aqiFromTable(kAqiPm25, sizeof(kAqiPm25) / sizeof(kAqiPm25[0]), tenths);
+}
+
+inline uint16_t aqiPm10(uint32_t tenths) {
+    return aqiFromTable(kAqiPm10, sizeof(kAqiPm10) / sizeof(kAqiPm10[0]), tenths);
+}
+
+// Overall index is the worse of the two pollutants
+inline uint16_t aqiOverall(uint32_t pm25Tenths, uint32_t pm10Tenths) {
+    uint16_t a = aqiPm25(pm25Tenths);
+    uint16_t b = aqiPm10(pm10Tenths);
+    return a > b ? a : b;
+}
+
+// Parses a decimal reading such as "12" or "12.34" into tenths, truncated
+// as the breakpoint tables expect; negative readings count as 0
+inline uint32_t tenthsFromText(const char *text) {
+    Fixed16 v = Fixed16::parse(text);
+    return v > Fixed16() ? (uint32_t)v.truncDecimal(1) : 0;
+}
+
+// True if text is a reading value that is all number: false for
+// nullptr, "" and the "null" a node without that sensor sends
+inline bool isReadingNumber(const char *text) {
+    if (!text || !*text) {
+        return false;
+    }
+    const char *end;
+    Fixed16::parse(text, &end);
+    return *end == '\0' && end != text && end[-1] >= '0' && end[-1] <= '9';
+}
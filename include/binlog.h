@@ -0,0 +1,235 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        binlog.h
+//
+// Description:
+//
+//   Deferred-format logging.  LOG_INFO(category, LOG_X, args...) stores a
+//   fixed 36-byte record (time, format id from log_formats.h, level,
+//   category, up to six 32-bit args) in a lock-free MpscQueue and returns;
+//   no text is formatted and no UART is touched on the caller's path.
+//   Whoever drains the queue formats it later, or ships the raw record
+//   to the host (FRAME_TYPE_LOG) for tools/collector to format.
+//
+//   Filtering happens before anything is stored: a runtime level and
+//   category mask, then a per-call-site rate limit of LOG_RATE_BURST
+//   records per LOG_RATE_WINDOW_MS.  Records a site had to drop are
+//   counted and reported with the next one it gets through.  A full
+//   queue drops the record and counts it too; logging never blocks.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <log_formats.h>
+#include <mpsc_queue.h>
+#include <serial_frame.h>
+
+#define LOG_QUEUE_SIZE      64      // Records; power of two
+#define LOG_MAX_ARGS        6
+#define LOG_RATE_WINDOW_MS  1000
+#define LOG_RATE_BURST      5       // Records per site per window
+#define FRAME_TYPE_LOG      0x02
+#define LOG_WIRE_HEADER     12      // Encoded record without its args
+
+enum LogLevel : uint8_t {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_COUNT
+};
+
+enum LogCategory : uint8_t {
+    LOG_CAT_SYSTEM,
+    LOG_CAT_MESH,
+    LOG_CAT_SENSOR,
+    LOG_CAT_DISPLAY,
+    LOG_CAT_UPLINK,
+    LOG_CAT_COUNT
+};
+
+static const char *const kLogLevelNames[LOG_LEVEL_COUNT] = { "error", "warn", "info", "debug" };
+static const char *const kLogCategoryNames[LOG_CAT_COUNT] = { "system", "mesh", "sensor", "display", "uplink" };
+
+struct LogRecord {
+    uint32_t time;          // millis() when logged
+    uint16_t format;        // LogFormat id
+    uint8_t level;
+    uint8_t category;
+    uint16_t suppressed;    // Records this site dropped just before this one
+    uint8_t argc;
+    uint8_t reserved;
+    uint32_t args[LOG_MAX_ARGS];
+};
+
+// Rate limit state for one LOG_*() call site
+struct LogSite {
+    uint32_t windowStart;
+    uint16_t count;
+    uint16_t suppressed;
+};
+
+class BinLog {
+public:
+    bool enabled(uint8_t level, uint8_t category) const {
+        return level <= m_level && (m_categories & (1u << category));
+    }
+
+    template <typename... Args>
+    void write(LogSite &site, uint32_t now, uint8_t level, uint8_t category, uint16_t format, Args... args) {
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+        if (now - site.windowStart >= LOG_RATE_WINDOW_MS) {
+            site.windowStart = now;
+            site.count = 0;
+        }
+        if (site.count >= LOG_RATE_BURST) {
+            if (site.suppressed < 0xFFFF) {
+                site.suppressed++;
+            }
+            m_rateLimited++;
+            return;
+        }
+        site.count++;
+
+        size_t ticket;
+        LogRecord *r = m_queue.claim(ticket);
+        if (!r) {
+            m_dropped++;
+            return;
+        }
+        const uint32_t values[] = { 0, (uint32_t)args... };  // Leading 0 allows no args
+        r->time = now;
+        r->format = format;
+        r->level = level;
+        r->category = category;
+        r->suppressed = site.suppressed;
+        r->argc = sizeof...(Args);
+        memcpy(r->args, values + 1, sizeof...(Args) * sizeof(uint32_t));
+        m_queue.publish(ticket);
+        site.suppressed = 0;
+    }
+
+    // Consumer side, one task only
+    LogRecord *front() { return m_queue.front(); }
+    void pop() { m_queue.pop(); }
+
+    void setLevel(uint8_t level) { m_level = level; }
+    void setCategories(uint32_t mask) { m_categories = mask; }
+    uint8_t level() const { return m_level; }
+    uint32_t categories() const { return m_categories; }
+    uint32_t dropped() const { return m_dropped; }
+    uint32_t rateLimited() const { return m_rateLimited; }
+
+private:
+    MpscQueue<LogRecord, LOG_QUEUE_SIZE> m_queue;
+    volatile uint8_t m_level = LOG_LEVEL_INFO;
+    volatile uint32_t m_categories = 0xFFFFFFFF;
+    uint32_t m_dropped = 0;         // Races between producers only undercount
+    uint32_t m_rateLimited = 0;
+};
+
+// Formats "<time> <level> <category>: <message>" into out; returns the length
+inline int formatLogRecord(char *out, size_t size, const LogRecord &r) {
+    int len = snprintf(out, size, "%10lu %-5s %-7s ", (unsigned long)r.time,
+                       r.level < LOG_LEVEL_COUNT ? kLogLevelNames[r.level] : "?",
+                       r.category < LOG_CAT_COUNT ? kLogCategoryNames[r.category] : "?");
+    const char *f = r.format < LOG_FORMAT_COUNT ? kLogFormats[r.format] : "unknown format %u";
+    uint32_t unknown[1] = { r.format };
+    const uint32_t *args = r.format < LOG_FORMAT_COUNT ? r.args : unknown;
+    int argc = r.format < LOG_FORMAT_COUNT ? r.argc : 1;
+    int next = 0;
+
+    for (; *f && len < (int)size - 1; f++) {
+        if (*f != '%' || !f[1]) {
+            out[len++] = *f;
+            continue;
+        }
+        char conv = *++f;
+        if (conv == '%') {
+            out[len++] = '%';
+            continue;
+        }
+        uint32_t v = next < argc ? args[next++] : 0;
+        switch (conv) {
+        case 'u': len += snprintf(out + len, size - len, "%lu", (unsigned long)v); break;
+        case 'd': len += snprintf(out + len, size - len, "%ld", (long)(int32_t)v); break;
+        case 'x': len += snprintf(out + len, size - len, "%lx", (unsigned long)v); break;
+        case 'h': {
+            int32_t s = (int32_t)v;
+            uint32_t a = s < 0 ? -(uint32_t)s : s;
+            len += snprintf(out + len, size - len, "%s%lu.%02lu", s < 0 ? "-" : "",
+                            (unsigned long)(a / 100), (unsigned long)(a % 100));
+            break;
+        }
+        default: len += snprintf(out + len, size - len, "%%%c", conv); break;
+        }
+    }
+    if (len > (int)size - 1) {
+        len = size - 1;
+    }
+    if (r.suppressed && len < (int)size - 1) {
+        len += snprintf(out + len, size - len, " (+%u suppressed)", r.suppressed);
+        if (len > (int)size - 1) {
+            len = size - 1;
+        }
+    }
+    out[len] = '\0';
+    return len;
+}
+
+// Record to a FRAME_TYPE_LOG frame, little-endian, args trimmed to argc
+inline size_t encodeLogRecord(const LogRecord &r, uint8_t *out) {
+    uint8_t payload[LOG_WIRE_HEADER + LOG_MAX_ARGS * 4];
+    putLe32(payload, r.time);
+    payload[4] = r.format;
+    payload[5] = r.format >> 8;
+    payload[6] = r.level;
+    payload[7] = r.category;
+    payload[8] = r.suppressed;
+    payload[9] = r.suppressed >> 8;
+    payload[10] = r.argc;
+    payload[11] = 0;
+    for (int i = 0; i < r.argc; i++) {
+        putLe32(payload + LOG_WIRE_HEADER + i * 4, r.args[i]);
+    }
+    return encodeFrame(FRAME_TYPE_LOG, payload, LOG_WIRE_HEADER + r.argc * 4, out);
+}
+
+inline bool decodeLogRecord(const uint8_t *payload, size_t len, LogRecord &r) {
+    if (len < LOG_WIRE_HEADER) {
+        return false;
+    }
+    r.argc = payload[10];
+    if (r.argc > LOG_MAX_ARGS || len != LOG_WIRE_HEADER + r.argc * 4u) {
+        return false;
+    }
+    r.time = getLe32(payload);
+    r.format = payload[4] | (payload[5] << 8);
+    r.level = payload[6];
+    r.category = payload[7];
+    r.suppressed = payload[8] | (payload[9] << 8);
+    r.reserved = 0;
+    for (int i = 0; i < r.argc; i++) {
+        r.args[i] = getLe32(payload + LOG_WIRE_HEADER + i * 4);
+    }
+    return true;
+}
+
+// Call-site macros; each expansion gets its own rate limit
+#define LOG_AT(level, category, format, ...) do { \
+        if (g_Log.enabled(level, category)) { \
+            static LogSite logSite_ = {}; \
+            g_Log.write(logSite_, millis(), level, category, format, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_ERROR(category, format, ...) LOG_AT(LOG_LEVEL_ERROR, LOG_CAT_##category, format, ##__VA_ARGS__)
+#define LOG_WARN(category, format, ...)  LOG_AT(LOG_LEVEL_WARN, LOG_CAT_##category, format, ##__VA_ARGS__)
+#define LOG_INFO(category, format, ...)  LOG_AT(LOG_LEVEL_INFO, LOG_CAT_##category, format, ##__VA_ARGS__)
+#define LOG_DEBUG(category, format, ...) LOG_AT(LOG_LEVEL_DEBUG, LOG_CAT_##category, format, ##__VA_ARGS__)
@@ -0,0 +1,192 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        boot_state.h
+//
+// Description:
+//
+//   What a node needs to be useful straight after a restart, and how long
+//   the restart took.
+//
+//   BootState is the current values plus the most recently heard nodes,
+//   small enough for RTC memory (kept across resets and brownouts, lost
+//   on power-up) and for a flash copy.  A CRC and version guard against
+//   reading back garbage or an older layout.  Ages are kept instead of
+//   millis() stamps, since millis() starts over at boot; a restored node
+//   shows at least as old as it was when saved.
+//
+//   BootTimeline records how long each part of setup() took, and when
+//   the first connection and the first broadcast to it happened.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <node_core.h>
+#include <serial_frame.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define BOOT_STATE_MAGIC    0x53425141  // "AQBS"
+#define BOOT_STATE_VERSION  1
+#define BOOT_STATE_NODES    8           // Most recently heard nodes kept
+
+struct BootNode {
+    uint32_t nodeId;
+    uint32_t ageMs;                     // Since it last reported, at save time
+    char value[NODE_VALUES][NODE_VALUE_LEN];
+};
+
+struct BootState {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t boots;                     // Starts that found a valid state
+    uint32_t savedAtMs;                 // Uptime of the saving boot
+    char value[NODE_VALUES][NODE_VALUE_LEN];
+    uint8_t nodeCount;
+    BootNode nodes[BOOT_STATE_NODES];
+    uint16_t crc;                       // Over everything above
+};
+
+inline uint16_t bootStateCrc(const BootState &s) {
+    return crc16Ccitt((const uint8_t *)&s, offsetof(BootState, crc));
+}
+
+inline bool bootStateValid(const BootState &s) {
+    return s.magic == BOOT_STATE_MAGIC && s.version == BOOT_STATE_VERSION && s.size == sizeof(BootState) &&
+           s.nodeCount <= BOOT_STATE_NODES && s.crc == bootStateCrc(s);
+}
+
+// Fills s from the current values and the BOOT_STATE_NODES entries of
+// table heard from most recently
+inline void bootStateCapture(BootState &s, const NodeCore &core, const NodeTable &table, uint32_t boots,
+                             uint32_t now) {
+    memset(&s, 0, sizeof(s));
+    s.magic = BOOT_STATE_MAGIC;
+    s.version = BOOT_STATE_VERSION;
+    s.size = sizeof(BootState);
+    s.boots = boots;
+    s.savedAtMs = now;
+    for (int i = 0; i < NODE_VALUES; i++) {
+        copyValue(s.value[i], core.value(i));
+    }
+    // Insertion into a list kept youngest first; the table is small
+    // enough on the nodes that save it that this is cheap
+    for (int i = 0; i < table.size(); i++) {
+        const NodeEntry &e = table.at(i);
+        uint32_t age = now - e.lastSeen;
+        int at = s.nodeCount;
+        while (at > 0 && s.nodes[at - 1].ageMs > age) {
+            at--;
+        }
+        if (at >= BOOT_STATE_NODES) {
+            continue;
+        }
+        int last = s.nodeCount < BOOT_STATE_NODES ? s.nodeCount : BOOT_STATE_NODES - 1;
+        memmove(&s.nodes[at + 1], &s.nodes[at], (last - at) * sizeof(BootNode));
+        s.nodes[at].nodeId = e.nodeId;
+        s.nodes[at].ageMs = age;
+        memcpy(s.nodes[at].value, e.value, sizeof(e.value));
+        if (s.nodeCount < BOOT_STATE_NODES) {
+            s.nodeCount++;
+        }
+    }
+    s.crc = bootStateCrc(s);
+}
+
+// Makes s's values current under self and puts its nodes back in the
+// table, aged as they were when saved.  Restored entries count no
+// messages, so they are told apart from ones heard since boot.
+inline void bootStateRestore(const BootState &s, NodeCore &core, uint32_t self, uint32_t now) {
+    Reading r = {};
+    r.node = self;
+    r.time = now;
+    for (int i = 0; i < NODE_VALUES; i++) {
+        copyValue(r.value[i], s.value[i]);
+    }
+    core.apply(r, now)->messages = 0;
+    for (int n = s.nodeCount - 1; n >= 0; n--) {  // Oldest first, so eviction keeps the youngest
+        const BootNode &b = s.nodes[n];
+        if (b.nodeId == self) {
+            continue;
+        }
+        NodeEntry *e = core.table().update(b.nodeId, now - b.ageMs);
+        e->messages = 0;
+        memcpy(e->value, b.value, sizeof(b.value));
+    }
+}
+
+enum BootPhase {
+    BOOT_PRE_SETUP,     // Bootloader and static constructors, as far as micros() saw
+    BOOT_SERIAL,
+    BOOT_MESH,          // mesh.init() and callbacks; joining carries on in the background
+    BOOT_RESTORE,
+    BOOT_DISPLAY,
+    BOOT_LEDS,
+    BOOT_SENSOR,
+    BOOT_UPLINKS,       // Web server and MQTT client setup
+    BOOT_TASKS,         // Scheduler tasks, memory report and core tasks
+    BOOT_PHASE_COUNT
+};
+
+static const char *const kBootPhaseNames[BOOT_PHASE_COUNT] = {
+    "pre_setup", "serial", "mesh_init", "restore", "display", "leds", "sensor", "uplinks", "tasks"
+};
+
+enum BootSource {
+    BOOT_SOURCE_NONE,
+    BOOT_SOURCE_RTC,
+    BOOT_SOURCE_FLASH
+};
+
+static const char *const kBootSourceNames[] = { "none", "rtc", "flash" };
+
+class BootTimeline {
+public:
+    // Call first thing in setup(); everything before counts as BOOT_PRE_SETUP
+    void begin(uint32_t nowUs) {
+        m_phaseUs[BOOT_PRE_SETUP] = nowUs;
+        m_lastUs = nowUs;
+    }
+
+    // Ends phase at nowUs; phases a build skips stay at 0
+    void mark(BootPhase phase, uint32_t nowUs) {
+        m_phaseUs[phase] = nowUs - m_lastUs;
+        m_lastUs = nowUs;
+    }
+
+    // Records the first time each happens; true the first time only
+    bool firstConnection(uint32_t nowMs) { return first(m_connectedMs, nowMs); }
+    bool firstBroadcast(uint32_t nowMs) { return first(m_broadcastMs, nowMs); }
+
+    uint32_t phaseUs(int phase) const { return m_phaseUs[phase]; }
+    uint32_t setupDoneUs() const { return m_lastUs; }
+    uint32_t connectedMs() const { return m_connectedMs; }
+    uint32_t broadcastMs() const { return m_broadcastMs; }
+
+    int format(char *out, size_t size, BootSource source, uint32_t restoredNodes) const {
+        int len = snprintf(out, size, "boot: setup done at %u us, state from %s (%u nodes)\n",
+                           m_lastUs, kBootSourceNames[source], restoredNodes);
+        for (int i = 0; i < BOOT_PHASE_COUNT && len < (int)size; i++) {
+            len += snprintf(out + len, size - len, "  %-10s %8u us\n", kBootPhaseNames[i], m_phaseUs[i]);
+        }
+        return len < (int)size ? len : (int)size - 1;
+    }
+
+private:
+    static bool first(uint32_t &slot, uint32_t nowMs) {
+        if (slot) {
+            return false;
+        }
+        slot = nowMs ? nowMs : 1;
+        return true;
+    }
+
+    uint32_t m_phaseUs[BOOT_PHASE_COUNT] = {};
+    uint32_t m_lastUs = 0;
+    uint32_t m_connectedMs = 0;  // 0 = not yet
+    uint32_t m_broadcastMs = 0;
+};
@@ -0,0 +1,190 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        calibration.h
+//
+// Description:
+//
+//   Corrects a PMS7003's raw concentrations, in Fixed16.  Every model
+//   starts with this device's gain and offset per channel (from a
+//   side-by-side run against a reference), then:
+//
+//     linear   nothing more
+//     epa      the US EPA correction for PMS5003-class sensors (Barkjohn
+//              et al. 2021): pm2.5 = a * pm2.5 - b * RH + c, with a, b, c
+//              = 0.524, 0.0862, 5.75.  pm1.0 and pm10 are left linear;
+//              the fit is for pm2.5 only.
+//     kohler   undoes hygroscopic growth on every channel (kappa-Kohler,
+//              Crilley et al. 2018): pm / (1 + kappa * RH / (100 - RH)),
+//              RH capped at CAL_RH_MAX where the term runs away
+//
+//   The optical count overreads as particles take up water, which is why
+//   the last two need the relative humidity.  The PMS7003 doesn't measure
+//   it, so it comes from the last reading on the mesh whose sender
+//   measured one (humidity()): a number from 0 to 100, never "null" or
+//   any other text.  Without one newer than CAL_HUMIDITY_MAX_AGE_MS the
+//   humidity models fall back to linear and say so in the flags.  A
+//   node built without MESH_RECEIVE never hears one, so main.cpp only
+//   allows linear there.
+//
+//   The coefficients are plain integers (Fixed16 raw) with a magic,
+//   version and CRC, so they can be stored as a blob and sent around.
+//   Results never go below zero.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <aqi.h>              // isReadingNumber()
+#include <fixed_point.h>
+#include <serial_frame.h>
+#include <stddef.h>
+#include <string.h>
+
+#define CAL_MAGIC               0x4C434141  // "AACL"
+#define CAL_VERSION             1
+#define CAL_CHANNELS            3           // pm1.0, pm2.5, pm10.0
+#define CAL_RH_MAX              95          // Percent; growth diverges at 100
+#define CAL_HUMIDITY_MAX_AGE_MS 1800000     // A humidity older than this isn't used
+
+enum CalModel {
+    CAL_LINEAR,
+    CAL_EPA,
+    CAL_KOHLER,
+    CAL_MODEL_COUNT
+};
+
+static const char *const kCalModelNames[CAL_MODEL_COUNT] = { "linear", "epa", "kohler" };
+
+// What apply() did, for the reading's flags
+#define CAL_FLAG_CALIBRATED     0x01
+#define CAL_FLAG_NO_HUMIDITY    0x02        // Humidity model wanted, linear used
+
+struct CalCoefficients {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t model;                          // CalModel
+    int32_t gain[CAL_CHANNELS];             // Fixed16 raw
+    int32_t offset[CAL_CHANNELS];           // ug/m3, Fixed16 raw
+    int32_t epa[3];                         // a, b, c
+    int32_t kappa;
+    uint16_t crc;                           // Over everything above
+};
+
+inline uint16_t calCrc(const CalCoefficients &c) {
+    return crc16Ccitt((const uint8_t *)&c, offsetof(CalCoefficients, crc));
+}
+
+inline bool calValid(const CalCoefficients &c) {
+    return c.magic == CAL_MAGIC && c.version == CAL_VERSION && c.model < CAL_MODEL_COUNT && c.crc == calCrc(c);
+}
+
+inline void calSeal(CalCoefficients &c) {
+    c.crc = calCrc(c);
+}
+
+// Unit gain, no offset, the published EPA and kappa values, model linear:
+// the raw values pass through unchanged
+inline void calDefaults(CalCoefficients &c) {
+    memset(&c, 0, sizeof(c));
+    c.magic = CAL_MAGIC;
+    c.version = CAL_VERSION;
+    c.model = CAL_LINEAR;
+    for (int i = 0; i < CAL_CHANNELS; i++) {
+        c.gain[i] = Fixed16::kOne;
+    }
+    c.epa[0] = Fixed16::fromDecimal(524, 3).raw();
+    c.epa[1] = Fixed16::fromDecimal(862, 4).raw();
+    c.epa[2] = Fixed16::fromDecimal(575, 2).raw();
+    c.kappa = Fixed16::fromDecimal(40, 2).raw();
+    calSeal(c);
+}
+
+struct CalStats {
+    uint32_t applied;
+    uint32_t noHumidity;    // Fell back to linear for want of a humidity
+    uint32_t clamped;       // Values the model took below zero
+};
+
+class Calibrator {
+public:
+    Calibrator() { calDefaults(m_coef); }
+
+    // Takes c if it checks out; false leaves the current ones
+    bool set(const CalCoefficients &c) {
+        if (!calValid(c)) {
+            return false;
+        }
+        m_coef = c;
+        return true;
+    }
+
+    const CalCoefficients &coefficients() const { return m_coef; }
+
+    // The latest relative humidity seen, percent
+    void humidity(Fixed16 rh, uint32_t nowMs) {
+        m_rh = rh < Fixed16() ? Fixed16() : rh > Fixed16::fromInt(100) ? Fixed16::fromInt(100) : rh;
+        m_rhMs = nowMs;
+        m_haveRh = true;
+    }
+
+    // Takes a reading's humidity text if it is all number and from 0 to
+    // 100; returns whether it did
+    bool humidity(const char *text, uint32_t nowMs) {
+        if (!isReadingNumber(text)) {
+            return false;
+        }
+        Fixed16 rh = Fixed16::parse(text);
+        if (rh < Fixed16() || rh > Fixed16::fromInt(100)) {
+            return false;
+        }
+        humidity(rh, nowMs);
+        return true;
+    }
+
+    bool haveHumidity(uint32_t nowMs) const { return m_haveRh && nowMs - m_rhMs < CAL_HUMIDITY_MAX_AGE_MS; }
+
+    // Corrects raw pm1.0, pm2.5 and pm10.0 into out; returns CAL_FLAG_*
+    uint8_t apply(const uint16_t raw[CAL_CHANNELS], uint32_t nowMs, Fixed16 out[CAL_CHANNELS]) {
+        uint8_t flags = CAL_FLAG_CALIBRATED;
+        for (int i = 0; i < CAL_CHANNELS; i++) {
+            out[i] = Fixed16::fromInt(raw[i]) * Fixed16::fromRaw(m_coef.gain[i]) + Fixed16::fromRaw(m_coef.offset[i]);
+        }
+        if (m_coef.model != CAL_LINEAR) {
+            if (!haveHumidity(nowMs)) {
+                flags |= CAL_FLAG_NO_HUMIDITY;
+                m_stats.noHumidity++;
+            } else if (m_coef.model == CAL_EPA) {
+                out[1] = Fixed16::fromRaw(m_coef.epa[0]) * out[1] - Fixed16::fromRaw(m_coef.epa[1]) * m_rh +
+                         Fixed16::fromRaw(m_coef.epa[2]);
+            } else {
+                Fixed16 rh = clampRh(m_rh);
+                Fixed16 growth = Fixed16::fromInt(1) + Fixed16::fromRaw(m_coef.kappa) * rh / (Fixed16::fromInt(100) - rh);
+                for (int i = 0; i < CAL_CHANNELS; i++) {
+                    out[i] = out[i] / growth;
+                }
+            }
+        }
+        for (int i = 0; i < CAL_CHANNELS; i++) {
+            if (out[i] < Fixed16()) {
+                out[i] = Fixed16();
+                m_stats.clamped++;
+            }
+        }
+        m_stats.applied++;
+        return flags;
+    }
+
+    const CalStats &stats() const { return m_stats; }
+
+private:
+    static Fixed16 clampRh(Fixed16 rh) { return rh > Fixed16::fromInt(CAL_RH_MAX) ? Fixed16::fromInt(CAL_RH_MAX) : rh; }
+
+    CalCoefficients m_coef;
+    Fixed16 m_rh;
+    uint32_t m_rhMs = 0;
+    bool m_haveRh = false;
+    CalStats m_stats = {};
+};
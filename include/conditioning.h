@@ -0,0 +1,117 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        conditioning.h
+//
+// Description:
+//
+//   What happens to a sensor node's own pm values between the PMS7003
+//   and everything else: the spike check (include/outlier_filter.h),
+//   the calibration (include/calibration.h) and the smoothing
+//   (include/smoothing.h), in that order, one filter per channel.
+//   processReadings() in main.cpp and SimNode both run it, so the replay
+//   digest covers what the firmware actually sends.
+//
+//   Which stages run is fixed when it is made, from the build flags in
+//   main.cpp; the state for all of them is kept either way, a few hundred
+//   bytes.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <node_core.h>
+#include <framebuffer.h>        // formatUint()
+#include <calibration.h>
+#include <outlier_filter.h>
+#include <smoothing.h>
+
+#define CONDITION_OUTLIERS      0x01    // Flag spikes
+#define CONDITION_REPLACE       0x02    // ... and swap them for the window median
+#define CONDITION_CALIBRATE     0x04
+#define CONDITION_SMOOTH        0x08
+#define CONDITION_ALL           0x0F
+
+static_assert(CAL_FLAG_CALIBRATED == READING_CALIBRATED && CAL_FLAG_NO_HUMIDITY == READING_NO_HUMIDITY,
+              "Calibrator flags go straight into Reading::flags");
+
+class SensorConditioner {
+public:
+    explicit SensorConditioner(uint8_t stages = CONDITION_ALL) : m_stages(stages) {}
+
+    // Replaces r's pm values with conditioned ones worked out from
+    // r.rawPm, and adds the READING_* flags that say what was done.
+    // Returns a bit per channel rejected as a spike.
+    uint8_t apply(Reading &r, uint32_t nowMs) {
+        uint16_t pm[3] = { r.rawPm[0], r.rawPm[1], r.rawPm[2] };
+        uint8_t spikes = rejectSpikes(r, pm);
+        if (!(m_stages & (CONDITION_CALIBRATE | CONDITION_SMOOTH))) {
+            for (int i = 0; i < 3; i++) {
+                formatUint(r.value[i], pm[i]);
+            }
+            return spikes;
+        }
+        Fixed16 value[3];
+        calibrate(r, pm, nowMs, value);
+        smooth(r, value, nowMs);
+        for (int i = 0; i < 3; i++) {
+            char text[FIXED_FORMAT_MAX];
+            value[i].format(text, 1);
+            copyValue(r.value[i], text);
+        }
+        return spikes;
+    }
+
+    // The spike check alone, on pm in place; returns a bit per channel
+    // rejected
+    uint8_t rejectSpikes(Reading &r, uint16_t pm[3]) {
+        if (!(m_stages & CONDITION_OUTLIERS)) {
+            return 0;
+        }
+        uint8_t spikes = 0;
+        for (int i = 0; i < 3; i++) {
+            if (m_outliers[i].push(pm[i])) {
+                spikes |= 1 << i;
+                pm[i] = m_stages & CONDITION_REPLACE ? m_outliers[i].median() : pm[i];
+            }
+        }
+        r.flags |= spikes ? READING_OUTLIER : 0;
+        return spikes;
+    }
+
+    // The calibration alone, from pm into value; the values unchanged
+    // if it is off
+    void calibrate(Reading &r, const uint16_t pm[3], uint32_t nowMs, Fixed16 value[3]) {
+        if (m_stages & CONDITION_CALIBRATE) {
+            r.flags |= m_calibrator.apply(pm, nowMs, value);
+            return;
+        }
+        for (int i = 0; i < 3; i++) {
+            value[i] = Fixed16::fromInt(pm[i]);
+        }
+    }
+
+    // The smoothing alone, on value in place
+    void smooth(Reading &r, Fixed16 value[3], uint32_t nowMs) {
+        if (!(m_stages & CONDITION_SMOOTH)) {
+            return;
+        }
+        for (int i = 0; i < 3; i++) {
+            value[i] = m_smooth[i].update(value[i], nowMs);
+        }
+        r.flags |= READING_SMOOTHED;
+    }
+
+    uint8_t stages() const { return m_stages; }
+    Calibrator &calibrator() { return m_calibrator; }
+    const HampelFilter<OUTLIER_WINDOW> &outliers(int channel) const { return m_outliers[channel]; }
+    const Smoother &smoother(int channel) const { return m_smooth[channel]; }
+
+private:
+    uint8_t m_stages;
+    HampelFilter<OUTLIER_WINDOW> m_outliers[3];  // pm1.0, pm2.5, pm10.0
+    Calibrator m_calibrator;
+    Smoother m_smooth[3];
+};
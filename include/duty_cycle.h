@@ -0,0 +1,373 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        duty_cycle.h
+//
+// Description:
+//
+//   One wake of a battery sensor node that spends most of its time in
+//   deep sleep.  Each wake: the PMS7003 is woken, its fan given time to
+//   settle, a short burst of passive reads taken and the sensor put back
+//   to sleep; then the radio comes up, one message with the burst's mean
+//   goes to the sink and the node sleeps until the next period.
+//
+//   step() is polled and never blocks; it says when the caller must
+//   start the radio and when to go to sleep and for how long.  Deep sleep
+//   ends in a reset, so a DutyCycle only ever sees one wake.  What must
+//   outlive it (sequence number, sink, counters, running statistics and
+//   the charge used so far) is in DutyState, kept in RTC memory with the
+//   same magic, version and CRC guard as BootState.
+//
+//   The charge estimate multiplies the time spent in each phase by a
+//   current for that phase.  The currents are datasheet figures, not
+//   measurements; override them per board.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <hal.h>
+#include <pms7003.h>
+#include <node_core.h>
+#include <fixed_point.h>
+#include <serial_frame.h>
+#include <stddef.h>
+
+#define DUTY_STATE_MAGIC        0x44514141  // "AAQD"
+#define DUTY_STATE_VERSION      1
+
+#define DUTY_PERIOD_MS          300000      // Wake to wake
+#define DUTY_SETTLE_MS          30000       // PMS7003 datasheet: stable 30 s after wake
+#define DUTY_BURST              5           // Reads per wake
+#define DUTY_SAMPLE_MS          1000        // Between reads of a burst
+#define DUTY_READ_TIMEOUT_MS    500
+#define DUTY_JOIN_TIMEOUT_MS    20000       // Radio on to first connection
+#define DUTY_FLUSH_MS           250         // Radio kept up after sending
+#define DUTY_MIN_SLEEP_MS       1000
+#define DUTY_SINK_MISSES        3           // Failed sends before falling back to broadcast
+
+// Supply current in each phase, uA; the PMS7003 draws up to 100 mA with
+// the fan running and 200 uA asleep
+#ifndef DUTY_BOOT_UA
+#define DUTY_BOOT_UA            50000       // CPU at full speed, radio off
+#endif
+#ifndef DUTY_SETTLE_UA
+#define DUTY_SETTLE_UA          101000      // Fan; CPU in light sleep
+#endif
+#ifndef DUTY_SAMPLE_UA
+#define DUTY_SAMPLE_UA          130000      // Fan and CPU
+#endif
+#ifndef DUTY_RADIO_UA
+#define DUTY_RADIO_UA           120200      // WiFi receiving or sending; sensor asleep
+#endif
+#ifndef DUTY_SLEEP_UA
+#define DUTY_SLEEP_UA           260         // ESP32 deep sleep, sensor asleep, regulator
+#endif
+#ifndef DUTY_SUPPLY_MV
+#define DUTY_SUPPLY_MV          3700        // Nominal Li-ion cell
+#endif
+
+enum DutyPhase {
+    DUTY_BOOT,          // Reset to begin()
+    DUTY_SETTLE,
+    DUTY_SAMPLE,
+    DUTY_RADIO,         // Joining, sending and flushing
+    DUTY_SLEEP,
+    DUTY_PHASE_COUNT
+};
+
+static const char *const kDutyPhaseNames[DUTY_PHASE_COUNT] = { "boot", "settle", "sample", "radio", "sleep" };
+
+// What step() wants the caller to do
+enum DutyAction {
+    DUTY_AWAKE,         // Call step() again
+    DUTY_RADIO_ON,      // Start the mesh, call linkUp() on its first connection
+    DUTY_SLEEP_NOW      // Sleep for sleepMs()
+};
+
+struct DutyConfig {
+    uint32_t periodMs = DUTY_PERIOD_MS;
+    uint32_t settleMs = DUTY_SETTLE_MS;
+    uint8_t burst = DUTY_BURST;
+    uint32_t sampleMs = DUTY_SAMPLE_MS;
+    uint32_t joinTimeoutMs = DUTY_JOIN_TIMEOUT_MS;
+    uint32_t flushMs = DUTY_FLUSH_MS;
+    uint32_t phaseUa[DUTY_PHASE_COUNT] = { DUTY_BOOT_UA, DUTY_SETTLE_UA, DUTY_SAMPLE_UA, DUTY_RADIO_UA,
+                                           DUTY_SLEEP_UA };
+};
+
+// Lives in RTC memory across deep sleep, so no constructors
+struct DutyState {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t seq;                       // Of the next message
+    uint32_t cycles;                    // Wakes since power-up
+    uint32_t sent;
+    uint32_t sendFailures;              // Wakes that sent nothing
+    uint32_t emptyBursts;               // Wakes where the sensor never answered
+    uint32_t sinkNode;                  // 0 = broadcast
+    uint8_t sinkMisses;                 // Consecutive failed sends to sinkNode
+    uint32_t readings;                  // Sensor reads over all wakes
+    int64_t pm25Sum;                    // Fixed16 raw, over all reads
+    uint16_t pm25Min;
+    uint16_t pm25Max;
+    uint64_t phaseMs[DUTY_PHASE_COUNT];
+    uint64_t chargeUaMs[DUTY_PHASE_COUNT];
+    uint16_t crc;                       // Over everything above
+};
+
+inline uint16_t dutyStateCrc(const DutyState &s) {
+    return crc16Ccitt((const uint8_t *)&s, offsetof(DutyState, crc));
+}
+
+inline bool dutyStateValid(const DutyState &s) {
+    return s.magic == DUTY_STATE_MAGIC && s.version == DUTY_STATE_VERSION && s.size == sizeof(DutyState) &&
+           s.crc == dutyStateCrc(s);
+}
+
+inline void dutyStateInit(DutyState &s, uint32_t sinkNode) {
+    memset(&s, 0, sizeof(s));
+    s.magic = DUTY_STATE_MAGIC;
+    s.version = DUTY_STATE_VERSION;
+    s.size = sizeof(DutyState);
+    s.sinkNode = sinkNode;
+    s.pm25Min = UINT16_MAX;
+    s.crc = dutyStateCrc(s);
+}
+
+inline uint64_t dutyTotalMs(const DutyState &s) {
+    uint64_t ms = 0;
+    for (int i = 0; i < DUTY_PHASE_COUNT; i++) {
+        ms += s.phaseMs[i];
+    }
+    return ms;
+}
+
+inline uint64_t dutyTotalCharge(const DutyState &s) {
+    uint64_t charge = 0;
+    for (int i = 0; i < DUTY_PHASE_COUNT; i++) {
+        charge += s.chargeUaMs[i];
+    }
+    return charge;
+}
+
+inline uint32_t dutyAverageUa(const DutyState &s) {
+    uint64_t ms = dutyTotalMs(s);
+    return ms ? (uint32_t)(dutyTotalCharge(s) / ms) : 0;
+}
+
+// Energy drawn per message delivered, uJ, at DUTY_SUPPLY_MV
+inline uint32_t dutyEnergyPerReadingUj(const DutyState &s) {
+    return s.sent ? (uint32_t)(dutyTotalCharge(s) * DUTY_SUPPLY_MV / 1000000 / s.sent) : 0;
+}
+
+// Hours a battery of capacityMah lasts at the average current so far
+inline uint32_t dutyBatteryHours(const DutyState &s, uint32_t capacityMah) {
+    uint32_t ua = dutyAverageUa(s);
+    return ua ? (uint32_t)((uint64_t)capacityMah * 1000 / ua) : 0;
+}
+
+class DutyCycle {
+public:
+    DutyCycle(Pms7003 &pms, HalMesh &mesh, DutyState &state, const DutyConfig &config = DutyConfig())
+        : m_pms(pms), m_mesh(mesh), m_state(state), m_config(config) {}
+
+    // Starts the wake.  nowMs is the time since reset, booked as boot.
+    // State that doesn't check out (first power-up, new layout) starts
+    // over with sinkNode as the sink.
+    void begin(uint32_t nowMs, uint32_t sinkNode) {
+        if (!dutyStateValid(m_state)) {
+            dutyStateInit(m_state, sinkNode);
+        }
+        m_state.cycles++;
+        m_phase = DUTY_BOOT;
+        m_phaseStart = 0;
+        enter(DUTY_SETTLE, nowMs);
+        m_pms.sleep(false);
+        m_pms.setPassive(true);
+    }
+
+    DutyAction step(uint32_t nowMs) {
+        switch (m_phase) {
+        case DUTY_SETTLE:
+            m_pms.poll();  // Acks, and active-mode frames after a power-up
+            if (nowMs - m_phaseStart >= m_config.settleMs) {
+                enter(DUTY_SAMPLE, nowMs);
+                m_nextRead = nowMs;
+            }
+            return DUTY_AWAKE;
+        case DUTY_SAMPLE:
+            return sample(nowMs);
+        case DUTY_RADIO:
+            return radio(nowMs);
+        default:
+            return DUTY_SLEEP_NOW;
+        }
+    }
+
+    // The mesh has a connection; call from its connection callback
+    void linkUp() { m_linked = true; }
+
+    // How long until step() has anything to do, for light sleep between
+    // reads and while the fan settles
+    uint32_t msUntilNext(uint32_t nowMs) const {
+        switch (m_phase) {
+        case DUTY_SETTLE:
+            return m_phaseStart + m_config.settleMs - nowMs;
+        case DUTY_SAMPLE:
+            return m_waiting || (int32_t)(m_nextRead - nowMs) <= 0 ? 0 : m_nextRead - nowMs;
+        default:
+            return 0;
+        }
+    }
+
+    // Books the coming sleep and seals the state; call once step() has
+    // returned DUTY_SLEEP_NOW, just before sleeping.  The next wake
+    // keeps to the period however long this one took.
+    uint32_t sleepMs(uint32_t nowMs) {
+        if (m_phase != DUTY_SLEEP) {
+            enter(DUTY_SLEEP, nowMs);
+        }
+        uint32_t ms = nowMs + DUTY_MIN_SLEEP_MS < m_config.periodMs ? m_config.periodMs - nowMs : DUTY_MIN_SLEEP_MS;
+        book(DUTY_SLEEP, ms);
+        m_state.crc = dutyStateCrc(m_state);
+        return ms;
+    }
+
+    DutyPhase phase() const { return m_phase; }
+    uint8_t samples() const { return m_count; }
+    bool delivered() const { return m_delivered; }
+    const DutyState &state() const { return m_state; }
+
+private:
+    DutyAction sample(uint32_t nowMs) {
+        if (m_pms.poll() && m_waiting) {
+            m_waiting = false;
+            addSample(m_pms.reading());
+        }
+        if (m_waiting && nowMs - m_requestMs >= DUTY_READ_TIMEOUT_MS) {
+            m_waiting = false;
+        }
+        if (m_waiting) {
+            return DUTY_AWAKE;
+        }
+        // A sensor that stops answering gets twice the burst in tries
+        if (m_count >= m_config.burst || m_tries >= 2 * m_config.burst) {
+            m_pms.sleep(true);
+            if (!m_count) {
+                m_state.emptyBursts++;
+                enter(DUTY_SLEEP, nowMs);
+                return DUTY_SLEEP_NOW;
+            }
+            enter(DUTY_RADIO, nowMs);
+            m_linked = false;
+            return DUTY_RADIO_ON;
+        }
+        if ((int32_t)(nowMs - m_nextRead) >= 0) {
+            m_pms.requestRead();
+            m_waiting = true;
+            m_requestMs = nowMs;
+            m_nextRead = nowMs + m_config.sampleMs;
+            m_tries++;
+        }
+        return DUTY_AWAKE;
+    }
+
+    void addSample(const PmsReading &pm) {
+        m_mean[0].add(Fixed16::fromInt(pm.pm1_0));
+        m_mean[1].add(Fixed16::fromInt(pm.pm2_5));
+        m_mean[2].add(Fixed16::fromInt(pm.pm10_0));
+        m_burstMax = pm.pm2_5 > m_burstMax ? pm.pm2_5 : m_burstMax;
+        m_count++;
+        m_state.readings++;
+        m_state.pm25Sum += Fixed16::fromInt(pm.pm2_5).raw();
+        m_state.pm25Min = pm.pm2_5 < m_state.pm25Min ? pm.pm2_5 : m_state.pm25Min;
+        m_state.pm25Max = pm.pm2_5 > m_state.pm25Max ? pm.pm2_5 : m_state.pm25Max;
+    }
+
+    DutyAction radio(uint32_t nowMs) {
+        m_mesh.update();
+        if (m_sentMs) {
+            if (nowMs - m_sentMs < m_config.flushMs) {
+                return DUTY_AWAKE;
+            }
+        } else if (m_linked) {
+            send();
+            m_sentMs = nowMs ? nowMs : 1;
+            return DUTY_AWAKE;
+        } else if (nowMs - m_phaseStart < m_config.joinTimeoutMs) {
+            return DUTY_AWAKE;
+        } else {
+            m_state.sendFailures++;
+        }
+        enter(DUTY_SLEEP, nowMs);
+        return DUTY_SLEEP_NOW;
+    }
+
+    // The burst mean under the usual reading keys, so any receiver files
+    // it as it would a full node's broadcast, plus the sequence number,
+    // read count and burst maximum
+    void send() {
+        Reading r = {};
+        for (int i = 0; i < 3; i++) {
+            m_mean[i].mean().format(r.value[i], 1);
+        }
+        readingToJson(m_json, r);
+        m_json["seq"] = m_state.seq;
+        m_json["n"] = m_count;
+        m_json["max"] = m_burstMax;
+        char msg[160];
+        serializeJson(m_json, msg, sizeof(msg));
+
+        bool ok = false;
+        if (m_state.sinkNode) {
+            ok = m_mesh.sendTo(m_state.sinkNode, msg);
+            m_state.sinkMisses = ok ? 0 : m_state.sinkMisses + 1;
+            if (m_state.sinkMisses >= DUTY_SINK_MISSES) {
+                m_state.sinkNode = 0;  // Broadcast until the next power-up
+            }
+        }
+        if (!ok) {
+            ok = m_mesh.broadcast(msg);
+        }
+        m_delivered = ok;
+        m_state.seq++;
+        if (ok) {
+            m_state.sent++;
+        } else {
+            m_state.sendFailures++;
+        }
+    }
+
+    void enter(DutyPhase phase, uint32_t nowMs) {
+        book(m_phase, nowMs - m_phaseStart);
+        m_phase = phase;
+        m_phaseStart = nowMs;
+    }
+
+    void book(DutyPhase phase, uint32_t ms) {
+        m_state.phaseMs[phase] += ms;
+        m_state.chargeUaMs[phase] += (uint64_t)ms * m_config.phaseUa[phase];
+    }
+
+    Pms7003 &m_pms;
+    HalMesh &m_mesh;
+    DutyState &m_state;
+    DutyConfig m_config;
+    JsonDocument m_json;
+    DutyPhase m_phase = DUTY_BOOT;
+    uint32_t m_phaseStart = 0;
+    uint32_t m_nextRead = 0;
+    uint32_t m_requestMs = 0;
+    uint32_t m_sentMs = 0;
+    bool m_waiting = false;
+    bool m_linked = false;
+    bool m_delivered = false;
+    uint8_t m_count = 0;
+    uint8_t m_tries = 0;
+    uint16_t m_burstMax = 0;
+    FixedMean<16> m_mean[3];
+};
@@ -0,0 +1,234 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        event_stream.h
+//
+// Description:
+//
+//   Server-Sent Events hub for the web dashboard.  Readings are published
+//   into a small ring of pre-formatted events; each subscriber keeps its
+//   own cursor into the ring and is written to with non-blocking sends.
+//   A subscriber that falls more than a ring's worth behind skips the
+//   events it missed instead of stalling everyone else; it is sent the
+//   rows from setResync() again, as they are now, so nothing it shows is
+//   left stale.  New subscribers start from the same rows.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <lwip/sockets.h>
+
+#define SSE_MAX_CLIENTS     4       // Concurrent /events subscribers
+#define SSE_RING_EVENTS     8       // Events buffered for slow subscribers
+#define SSE_EVENT_SIZE      192     // Max bytes of one formatted event
+#define SSE_KEEPALIVE_MS    15000   // Comment ping so dead sockets get noticed
+
+struct SseEvent {
+    uint32_t seq;
+    uint16_t len;
+    char data[SSE_EVENT_SIZE];
+};
+
+struct SseClient {
+    WiFiClient client;
+    bool active = false;
+    uint32_t cursor = 0;            // Next event sequence number to send
+    char out[SSE_EVENT_SIZE];       // Event currently in flight
+    uint16_t outLen = 0;
+    uint16_t outPos = 0;
+    int resync = -1;                // Next row to resend, or -1 if none
+    uint32_t dropped = 0;           // Events skipped because the client was slow
+};
+
+class SseHub {
+public:
+    // Writes the data of row index into data and returns true, or returns
+    // false once index is past the last row
+    typedef bool (*Row)(int index, char *data, size_t size);
+
+    // Rows sent, as events of this kind, to a new subscriber and to one
+    // that fell behind.  Without them a new subscriber is sent what is
+    // still in the ring and one that fell behind only the newest event.
+    void setResync(const char *event, Row row) {
+        m_rowEvent = event;
+        m_row = row;
+    }
+
+    // Takes over the socket of the current HTTP request.  Returns false if
+    // every subscriber slot is in use so the caller can answer 503.
+    bool attach(WiFiClient &client) {
+        for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+            SseClient &c = m_clients[i];
+            if (c.active && !c.client.connected()) {
+                release(c);
+            }
+            if (!c.active) {
+                static const char header[] =
+                    "HTTP/1.1 200 OK\r\n"
+                    "Content-Type: text/event-stream\r\n"
+                    "Cache-Control: no-cache\r\n"
+                    "Connection: keep-alive\r\n"
+                    "Access-Control-Allow-Origin: *\r\n\r\n"
+                    "retry: 3000\n\n";
+                c.client = client;
+                c.client.setNoDelay(true);
+                c.client.write((const uint8_t *)header, sizeof(header) - 1);
+                c.active = true;
+                c.outLen = c.outPos = 0;
+                c.dropped = 0;
+                // Send every row, or else what is still buffered, so a new
+                // page fills in at once
+                c.resync = m_row ? 0 : -1;
+                c.cursor = m_row ? m_nextSeq : m_nextSeq > SSE_RING_EVENTS ? m_nextSeq - SSE_RING_EVENTS : 0;
+                m_subscribers++;
+                return true;
+            }
+        }
+        m_rejected++;
+        return false;
+    }
+
+    // Formats one event into the ring.  Never touches a socket, so it is
+    // safe to call from the mesh receive callback.
+    void publish(const char *event, const char *data) {
+        SseEvent &e = m_ring[m_nextSeq % SSE_RING_EVENTS];
+        int n = format(e.data, event, data);
+        if (n < 0) {
+            return;
+        }
+        e.len = n;
+        e.seq = m_nextSeq++;
+    }
+
+    // Moves buffered events onto the sockets without blocking.  Call from loop().
+    void pump() {
+        unsigned long now = millis();
+        bool ping = now - m_lastPing >= SSE_KEEPALIVE_MS;
+        if (ping) {
+            m_lastPing = now;
+        }
+
+        for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+            SseClient &c = m_clients[i];
+            if (!c.active) {
+                continue;
+            }
+            if (!c.client.connected()) {
+                release(c);
+                continue;
+            }
+            if (ping && c.outPos >= c.outLen && c.cursor >= m_nextSeq && c.resync < 0) {
+                stage(c, ": ping\n\n", 8);
+            }
+            drain(c);
+        }
+    }
+
+    int subscribers() const { return m_subscribers; }
+    uint32_t rejected() const { return m_rejected; }
+    uint32_t published() const { return m_nextSeq; }
+
+    uint32_t dropped() const {
+        uint32_t total = m_droppedClosed;
+        for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+            total += m_clients[i].dropped;
+        }
+        return total;
+    }
+
+private:
+    // "event: <event>\ndata: <data>\n\n" into out; its length, or -1 if
+    // it doesn't fit
+    int format(char (&out)[SSE_EVENT_SIZE], const char *event, const char *data) {
+        int n = snprintf(out, sizeof(out), "event: %s\ndata: %s\n\n", event, data);
+        if (n < 0 || n >= (int)sizeof(out)) {
+            m_oversize++;
+            return -1;
+        }
+        return n;
+    }
+
+    void stage(SseClient &c, const char *data, uint16_t len) {
+        memcpy(c.out, data, len);
+        c.outLen = len;
+        c.outPos = 0;
+    }
+
+    void drain(SseClient &c) {
+        while (true) {
+            if (c.outPos >= c.outLen && !stageRow(c)) {
+                if (c.cursor >= m_nextSeq) {
+                    return;  // Up to date
+                }
+                if (m_nextSeq - c.cursor > SSE_RING_EVENTS) {
+                    // Too slow: the events it missed are gone.  Resend every
+                    // row instead, or jump to the latest if there are none.
+                    uint32_t resume = m_row ? m_nextSeq : m_nextSeq - 1;
+                    c.dropped += resume - c.cursor;
+                    c.cursor = resume;
+                    if (m_row) {
+                        c.resync = 0;
+                        continue;
+                    }
+                }
+                const SseEvent &e = m_ring[c.cursor % SSE_RING_EVENTS];
+                stage(c, e.data, e.len);
+                c.cursor++;
+            }
+
+            int sent = send(c.client.fd(), c.out + c.outPos, c.outLen - c.outPos, MSG_DONTWAIT);
+            if (sent < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    release(c);
+                }
+                return;  // Socket buffer full, try again next pump
+            }
+            c.outPos += sent;
+            if (c.outPos < c.outLen) {
+                return;
+            }
+        }
+    }
+
+    // Stages the next row c is owed, if any
+    bool stageRow(SseClient &c) {
+        if (c.resync < 0) {
+            return false;
+        }
+        char data[SSE_EVENT_SIZE - 32];  // Leaves room for the event and data lines
+        while (m_row(c.resync++, data, sizeof(data))) {
+            int n = format(c.out, m_rowEvent, data);
+            if (n >= 0) {
+                c.outLen = n;
+                c.outPos = 0;
+                return true;
+            }
+        }
+        c.resync = -1;
+        return false;
+    }
+
+    void release(SseClient &c) {
+        c.client.stop();
+        c.active = false;
+        m_droppedClosed += c.dropped;
+        c.dropped = 0;
+        m_subscribers--;
+    }
+
+    SseEvent m_ring[SSE_RING_EVENTS];
+    SseClient m_clients[SSE_MAX_CLIENTS];
+    const char *m_rowEvent = nullptr;
+    Row m_row = nullptr;
+    uint32_t m_nextSeq = 0;
+    uint32_t m_rejected = 0;
+    uint32_t m_oversize = 0;
+    uint32_t m_droppedClosed = 0;
+    unsigned long m_lastPing = 0;
+    int m_subscribers = 0;
+};
@@ -0,0 +1,208 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        fixed_point.h
+//
+// Description:
+//
+//   Signed fixed-point numbers in a 32-bit word with FRAC fraction bits,
+//   for readings and the values derived from them.  Fixed16 (Q15.16)
+//   holds +/-32767 in steps of 1/65536, enough for any concentration,
+//   temperature or humidity the sensors report.
+//
+//   Everything is integer arithmetic with 64-bit intermediates, so the
+//   same inputs give the same bits on the ESP32 and on a host.  Results
+//   that do not fit saturate at maxValue() or minValue() instead of
+//   wrapping, and rounding is always half away from zero.  Construction,
+//   arithmetic and comparison are C++11 constexpr; parse() and format()
+//   work on caller buffers and never allocate.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+#define FIXED_FORMAT_MAX 24     // Buffer for format(): sign, digits, point, NUL
+
+constexpr int64_t fixedPow10(int n) {
+    return n > 0 ? 10 * fixedPow10(n - 1) : 1;
+}
+
+constexpr int32_t fixedSaturate(int64_t v) {
+    return v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (int32_t)v;
+}
+
+// n / d rounded half away from zero; d must be positive
+constexpr int64_t fixedDivRound(int64_t n, int64_t d) {
+    return n >= 0 ? (n + d / 2) / d : -((-n + d / 2) / d);
+}
+
+// Same, for a divisor of either sign
+constexpr int64_t fixedDivRoundSigned(int64_t n, int64_t d) {
+    return d < 0 ? fixedDivRound(-n, -d) : fixedDivRound(n, d);
+}
+
+template <int FRAC>
+class Fixed {
+    static_assert(FRAC > 0 && FRAC < 31, "Fraction bits must leave room for the sign");
+
+public:
+    static constexpr int32_t kOne = (int32_t)1 << FRAC;
+
+    constexpr Fixed() : m_raw(0) {}
+
+    static constexpr Fixed fromRaw(int32_t raw) { return Fixed(raw, 0); }
+    static constexpr Fixed fromInt(int32_t v) { return Fixed(fixedSaturate((int64_t)v * kOne), 0); }
+
+    // value / 10^decimals, e.g. fromDecimal(-35, 1) is -3.5
+    static constexpr Fixed fromDecimal(int32_t value, int decimals) {
+        return Fixed(fixedSaturate(fixedDivRound((int64_t)value * kOne, fixedPow10(decimals))), 0);
+    }
+
+    static constexpr Fixed maxValue() { return Fixed(INT32_MAX, 0); }
+    static constexpr Fixed minValue() { return Fixed(INT32_MIN, 0); }
+
+    constexpr int32_t raw() const { return m_raw; }
+
+    // Whole part, truncated toward zero
+    constexpr int32_t toInt() const { return m_raw >= 0 ? m_raw / kOne : -(int32_t)(-(int64_t)m_raw / kOne); }
+
+    // Value in units of 10^-decimals, rounded: toDecimal(1) of 12.36 is 124
+    constexpr int64_t toDecimal(int decimals) const {
+        return fixedDivRound((int64_t)m_raw * fixedPow10(decimals), kOne);
+    }
+
+    // Same, truncated toward zero as the EPA tables expect.  Half a step
+    // of slack keeps 0.7, stored as 0.69999, from truncating to 0.6.
+    constexpr int64_t truncDecimal(int decimals) const {
+        return m_raw >= 0 ? ((int64_t)m_raw * fixedPow10(decimals) + fixedPow10(decimals) / 2) / kOne
+                          : -((-(int64_t)m_raw * fixedPow10(decimals) + fixedPow10(decimals) / 2) / kOne);
+    }
+
+    constexpr Fixed operator-() const { return Fixed(fixedSaturate(-(int64_t)m_raw), 0); }
+
+    friend constexpr Fixed operator+(Fixed a, Fixed b) { return Fixed(fixedSaturate((int64_t)a.m_raw + b.m_raw), 0); }
+    friend constexpr Fixed operator-(Fixed a, Fixed b) { return Fixed(fixedSaturate((int64_t)a.m_raw - b.m_raw), 0); }
+    friend constexpr Fixed operator*(Fixed a, Fixed b) {
+        return Fixed(fixedSaturate(fixedDivRound((int64_t)a.m_raw * b.m_raw, kOne)), 0);
+    }
+    // Dividing by zero saturates toward the sign of the dividend
+    friend constexpr Fixed operator/(Fixed a, Fixed b) {
+        return b.m_raw == 0 ? (a.m_raw >= 0 ? maxValue() : minValue())
+                            : Fixed(fixedSaturate(fixedDivRoundSigned((int64_t)a.m_raw * kOne, b.m_raw)), 0);
+    }
+    friend constexpr Fixed operator*(Fixed a, int32_t k) { return Fixed(fixedSaturate((int64_t)a.m_raw * k), 0); }
+    friend constexpr Fixed operator/(Fixed a, int32_t k) {
+        return k == 0 ? (a.m_raw >= 0 ? maxValue() : minValue()) : Fixed(fixedSaturate(fixedDivRoundSigned(a.m_raw, k)), 0);
+    }
+
+    Fixed &operator+=(Fixed b) { return *this = *this + b; }
+    Fixed &operator-=(Fixed b) { return *this = *this - b; }
+    Fixed &operator*=(Fixed b) { return *this = *this * b; }
+    Fixed &operator/=(Fixed b) { return *this = *this / b; }
+
+    friend constexpr bool operator==(Fixed a, Fixed b) { return a.m_raw == b.m_raw; }
+    friend constexpr bool operator!=(Fixed a, Fixed b) { return a.m_raw != b.m_raw; }
+    friend constexpr bool operator<(Fixed a, Fixed b) { return a.m_raw < b.m_raw; }
+    friend constexpr bool operator>(Fixed a, Fixed b) { return a.m_raw > b.m_raw; }
+    friend constexpr bool operator<=(Fixed a, Fixed b) { return a.m_raw <= b.m_raw; }
+    friend constexpr bool operator>=(Fixed a, Fixed b) { return a.m_raw >= b.m_raw; }
+
+    // Reads "12", "-3.5" or "45.678"; digits past the ninth decimal are
+    // skipped.  Stops at the first character that does not fit, which
+    // *end points to if given; no digits at all gives 0.
+    static Fixed parse(const char *text, const char **end = nullptr) {
+        bool negative = *text == '-';
+        if (negative || *text == '+') {
+            text++;
+        }
+        int64_t whole = 0;
+        while (*text >= '0' && *text <= '9') {
+            if (whole <= INT32_MAX) {
+                whole = whole * 10 + (*text - '0');
+            }
+            text++;
+        }
+        int64_t frac = 0;
+        int digits = 0;
+        if (*text == '.') {
+            text++;
+            for (; *text >= '0' && *text <= '9'; text++) {
+                if (digits < 9) {
+                    frac = frac * 10 + (*text - '0');
+                    digits++;
+                }
+            }
+        }
+        if (end) {
+            *end = text;
+        }
+        int64_t raw = whole * kOne + fixedDivRound(frac * kOne, fixedPow10(digits));
+        return Fixed(fixedSaturate(negative ? -raw : raw), 0);
+    }
+
+    // Writes the value rounded to the given number of decimals (0 to 9)
+    // and a NUL; returns the length.  out needs FIXED_FORMAT_MAX bytes.
+    int format(char *out, int decimals) const {
+        int64_t v = toDecimal(decimals);
+        int n = 0;
+        if (v < 0) {
+            out[n++] = '-';
+            v = -v;
+        }
+        char tmp[20];
+        int len = 0;
+        do {
+            tmp[len++] = '0' + v % 10;
+            v /= 10;
+        } while (v || len <= decimals);  // At least one digit before the point
+        while (len > 0) {
+            if (len == decimals) {
+                out[n++] = '.';
+            }
+            out[n++] = tmp[--len];
+        }
+        out[n] = '\0';
+        return n;
+    }
+
+private:
+    constexpr Fixed(int32_t raw, int) : m_raw(raw) {}
+
+    int32_t m_raw;
+};
+
+typedef Fixed<16> Fixed16;  // Q15.16, for readings
+
+// Running mean of fixed-point samples; the sum is kept in 64 bits so it
+// cannot saturate before the mean does
+template <int FRAC>
+class FixedMean {
+public:
+    void add(Fixed<FRAC> v) {
+        m_sum += v.raw();
+        m_count++;
+    }
+
+    Fixed<FRAC> mean() const {
+        return m_count ? Fixed<FRAC>::fromRaw(fixedSaturate(fixedDivRound(m_sum, m_count))) : Fixed<FRAC>();
+    }
+
+    void reset() {
+        m_sum = 0;
+        m_count = 0;
+    }
+
+    uint32_t count() const { return m_count; }
+
+private:
+    int64_t m_sum = 0;
+    uint32_t m_count = 0;
+};
+
+static_assert(Fixed16::fromDecimal(-35, 1).toDecimal(2) == -350, "Fixed16 decimal round trip");
+static_assert((Fixed16::fromInt(3) / Fixed16::fromInt(2)).toDecimal(1) == 15, "Fixed16 division");
+static_assert((Fixed16::fromInt(30000) * Fixed16::fromInt(2)) == Fixed16::maxValue(), "Fixed16 saturates");
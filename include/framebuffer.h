@@ -0,0 +1,143 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        framebuffer.h
+//
+// Description:
+//
+//   Drawing onto a 128x64 monochrome buffer in the SSD1306 page layout:
+//   byte (row * 128 + x) holds pixels x, row*8 .. row*8+7, LSB on top.
+//   That is the layout of U8g2's full buffer, so on the device this
+//   draws straight into g_OLED.getBufferPtr(); on a host it draws into a
+//   plain array, giving byte-identical frames for snapshot comparisons.
+//
+//   Text uses a fixed 5x7 font on a 6 px grid, 21 columns by 8 rows, with
+//   every text row sitting on a tile row.  A glyph is therefore five byte
+//   copies, and layouts can be precomputed as (column, row) cells.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#define FB_WIDTH        128
+#define FB_HEIGHT       64
+#define FB_ROWS         (FB_HEIGHT / 8)
+#define FB_BYTES        (FB_WIDTH * FB_ROWS)
+#define FB_GLYPH_W      6       // 5 px glyph + 1 px spacing
+#define FB_COLS         (FB_WIDTH / FB_GLYPH_W)
+
+// ASCII 0x20..0x7E, five columns each, bit 0 at the top
+static const uint8_t kFont5x7[95][5] = {
+    {0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, {0x14,0x7F,0x14,0x7F,0x14},
+    {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, {0x36,0x49,0x56,0x20,0x50}, {0x00,0x08,0x07,0x03,0x00},
+    {0x00,0x1C,0x22,0x41,0x00}, {0x00,0x41,0x22,0x1C,0x00}, {0x2A,0x1C,0x7F,0x1C,0x2A}, {0x08,0x08,0x3E,0x08,0x08},
+    {0x00,0x80,0x70,0x30,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x00,0x60,0x60,0x00}, {0x20,0x10,0x08,0x04,0x02},
+    {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, {0x72,0x49,0x49,0x49,0x46}, {0x21,0x41,0x49,0x4D,0x33},
+    {0x18,0x14,0x12,0x7F,0x10}, {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x31}, {0x41,0x21,0x11,0x09,0x07},
+    {0x36,0x49,0x49,0x49,0x36}, {0x46,0x49,0x49,0x29,0x1E}, {0x00,0x00,0x14,0x00,0x00}, {0x00,0x40,0x34,0x00,0x00},
+    {0x00,0x08,0x14,0x22,0x41}, {0x14,0x14,0x14,0x14,0x14}, {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x59,0x09,0x06},
+    {0x3E,0x41,0x5D,0x59,0x4E}, {0x7C,0x12,0x11,0x12,0x7C}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22},
+    {0x7F,0x41,0x41,0x41,0x3E}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, {0x3E,0x41,0x41,0x51,0x73},
+    {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41},
+    {0x7F,0x40,0x40,0x40,0x40}, {0x7F,0x02,0x1C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E},
+    {0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, {0x26,0x49,0x49,0x49,0x32},
+    {0x03,0x01,0x7F,0x01,0x03}, {0x3F,0x40,0x40,0x40,0x3F}, {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F},
+    {0x63,0x14,0x08,0x14,0x63}, {0x03,0x04,0x78,0x04,0x03}, {0x61,0x59,0x49,0x4D,0x43}, {0x00,0x7F,0x41,0x41,0x41},
+    {0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x41,0x7F}, {0x04,0x02,0x01,0x02,0x04}, {0x40,0x40,0x40,0x40,0x40},
+    {0x00,0x03,0x07,0x08,0x00}, {0x20,0x54,0x54,0x78,0x40}, {0x7F,0x28,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x28},
+    {0x38,0x44,0x44,0x28,0x7F}, {0x38,0x54,0x54,0x54,0x18}, {0x00,0x08,0x7E,0x09,0x02}, {0x18,0xA4,0xA4,0x9C,0x78},
+    {0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x40,0x3D,0x00}, {0x7F,0x10,0x28,0x44,0x00},
+    {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x78,0x04,0x78}, {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38},
+    {0xFC,0x18,0x24,0x24,0x18}, {0x18,0x24,0x24,0x18,0xFC}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x24},
+    {0x04,0x04,0x3F,0x44,0x24}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C}, {0x3C,0x40,0x30,0x40,0x3C},
+    {0x44,0x28,0x10,0x28,0x44}, {0x4C,0x90,0x90,0x90,0x7C}, {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00},
+    {0x00,0x00,0x77,0x00,0x00}, {0x00,0x41,0x36,0x08,0x00}, {0x02,0x01,0x02,0x04,0x02},
+};
+
+class FrameBuffer {
+public:
+    explicit FrameBuffer(uint8_t *buffer) : m_buf(buffer) {}
+
+    void clear() { memset(m_buf, 0, FB_BYTES); }
+
+    // Writes text at a character cell; returns the column after the last glyph
+    int text(int col, int row, const char *s, bool inverse = false) {
+        if (row < 0 || row >= FB_ROWS) {
+            return col;
+        }
+        uint8_t *p = m_buf + row * FB_WIDTH + col * FB_GLYPH_W;
+        uint8_t mask = inverse ? 0xFF : 0x00;
+        for (; *s && col < FB_COLS; s++, col++) {
+            uint8_t c = (uint8_t)*s;
+            const uint8_t *g = kFont5x7[(c >= 0x20 && c <= 0x7E) ? c - 0x20 : '?' - 0x20];
+            for (int i = 0; i < 5; i++) {
+                *p++ = g[i] ^ mask;
+            }
+            *p++ = mask;
+        }
+        return col;
+    }
+
+    // Text right-aligned so its last glyph ends at column endCol - 1; text
+    // too long for that starts at column 0 instead
+    void textRight(int endCol, int row, const char *s) {
+        int col = endCol - (int)strlen(s);
+        text(col < 0 ? 0 : col, row, s);
+    }
+
+    void pixel(int x, int y) {
+        if (x >= 0 && x < FB_WIDTH && y >= 0 && y < FB_HEIGHT) {
+            m_buf[(y >> 3) * FB_WIDTH + x] |= 1 << (y & 7);
+        }
+    }
+
+    // Vertical line from y0 to y1 inclusive, in either order
+    void vline(int x, int y0, int y1) {
+        if (y0 > y1) {
+            int t = y0; y0 = y1; y1 = t;
+        }
+        for (int y = y0; y <= y1; y++) {
+            pixel(x, y);
+        }
+    }
+
+    void hline(int x0, int x1, int y) {
+        for (int x = x0; x <= x1; x++) {
+            pixel(x, y);
+        }
+    }
+
+    const uint8_t *data() const { return m_buf; }
+
+private:
+    uint8_t *m_buf;
+};
+
+// Integer to text without printf; returns the length written
+inline int formatUint(char *out, uint32_t v) {
+    char tmp[10];
+    int n = 0;
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    for (int i = 0; i < n; i++) {
+        out[i] = tmp[n - 1 - i];
+    }
+    out[n] = '\0';
+    return n;
+}
+
+// Tenths to "12.3"; returns the length written
+inline int formatTenths(char *out, uint32_t tenths) {
+    int n = formatUint(out, tenths / 10);
+    out[n++] = '.';
+    out[n++] = '0' + tenths % 10;
+    out[n] = '\0';
+    return n;
+}
@@ -0,0 +1,96 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        hal.h
+//
+// Description:
+//
+//   The hardware the node logic touches, as small interfaces: a clock, a
+//   serial byte stream, the OLED's tile buffer, the LED strip, the mesh
+//   and a key/value store.  hal_esp32.h implements them over the Arduino
+//   libraries; hal_native.h has fakes so the same modules build and run
+//   in the [env:native] target.
+//
+//   Only what the modules need is here.  Mesh setup, WiFi and the web
+//   server stay in main.cpp and are ESP32 only.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct LedColor {
+    uint8_t r, g, b;
+};
+
+class HalClock {
+public:
+    virtual uint32_t millis() = 0;
+    virtual uint32_t micros() = 0;
+
+protected:
+    ~HalClock() = default;
+};
+
+// A UART as a byte stream; reads and writes never block
+class HalSerial {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;     // -1 when nothing is buffered
+    virtual size_t write(const uint8_t *data, size_t len) = 0;
+
+protected:
+    ~HalSerial() = default;
+};
+
+// A 128x64 monochrome panel behind a full frame buffer in U8g2's tile
+// layout (see framebuffer.h).  updateArea() sends a block of 8x8 tiles.
+class HalDisplay {
+public:
+    virtual uint8_t *buffer() = 0;
+    virtual void clearBuffer() = 0;
+    virtual void updateArea(int tileX, int tileY, int tileWidth, int tileHeight) = 0;
+
+protected:
+    ~HalDisplay() = default;
+};
+
+class HalLeds {
+public:
+    virtual void show(const LedColor *pixels, int count) = 0;
+
+protected:
+    ~HalLeds() = default;
+};
+
+// Transport between nodes.  Received messages are handed to the
+// callback, with the context it was registered with, from update() on
+// the task that calls it.  sendTo() fails when there is no route to the
+// node.
+class HalMesh {
+public:
+    typedef void (*Receiver)(void *context, uint32_t from, const char *msg, size_t len);
+
+    virtual uint32_t nodeId() = 0;
+    virtual bool broadcast(const char *msg) = 0;     // NUL-terminated
+    virtual bool sendTo(uint32_t node, const char *msg) = 0;
+    virtual void onReceive(Receiver receiver, void *context) = 0;
+    virtual void update() = 0;
+
+protected:
+    ~HalMesh() = default;
+};
+
+// Small blobs kept across reboots, by short key
+class HalStorage {
+public:
+    virtual bool load(const char *key, void *data, size_t size) = 0;
+    virtual bool save(const char *key, const void *data, size_t size) = 0;
+
+protected:
+    ~HalStorage() = default;
+};
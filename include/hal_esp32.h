@@ -0,0 +1,150 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        hal_esp32.h
+//
+// Description:
+//
+//   hal.h over the Arduino libraries the firmware already uses: millis(),
+//   any Stream, U8g2's full buffer, FastLED, painlessMesh and NVS through
+//   Preferences.  Each wrapper holds a reference to an object main.cpp
+//   owns and configures.  The OLED and LED wrappers, and their
+//   libraries, are only built for roles that have them (node_role.h).
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <node_role.h>
+#include <Arduino.h>
+#if OLED_DISPLAY
+#include <U8g2lib.h>
+#endif
+#if STATUS_LEDS
+#include <FastLED.h>
+#endif
+#include <painlessMesh.h>
+#include <Preferences.h>
+#include <hal.h>
+
+#define HAL_STORAGE_NAMESPACE "aq"
+
+class Esp32Clock : public HalClock {
+public:
+    uint32_t millis() override { return ::millis(); }
+    uint32_t micros() override { return ::micros(); }
+};
+
+class StreamSerial : public HalSerial {
+public:
+    explicit StreamSerial(Stream &stream) : m_stream(stream) {}
+
+    int available() override { return m_stream.available(); }
+    int read() override { return m_stream.read(); }
+    size_t write(const uint8_t *data, size_t len) override { return m_stream.write(data, len); }
+
+private:
+    Stream &m_stream;
+};
+
+#if OLED_DISPLAY
+class U8g2Display : public HalDisplay {
+public:
+    explicit U8g2Display(U8G2 &oled) : m_oled(oled) {}
+
+    uint8_t *buffer() override { return m_oled.getBufferPtr(); }
+    void clearBuffer() override { m_oled.clearBuffer(); }
+    void updateArea(int tileX, int tileY, int tileWidth, int tileHeight) override {
+        m_oled.updateDisplayArea(tileX, tileY, tileWidth, tileHeight);
+    }
+
+private:
+    U8G2 &m_oled;
+};
+#endif
+
+#if STATUS_LEDS
+// Copies into the CRGB array FastLED drives, then pushes it out
+class FastLedStrip : public HalLeds {
+public:
+    explicit FastLedStrip(CRGB *leds) : m_leds(leds) {}
+
+    void show(const LedColor *pixels, int count) override {
+        for (int i = 0; i < count; i++) {
+            m_leds[i] = CRGB(pixels[i].r, pixels[i].g, pixels[i].b);
+        }
+        FastLED.show();
+    }
+
+private:
+    CRGB *m_leds;
+};
+#endif
+
+// painlessMesh after init(); connection callbacks stay with the caller.
+// Only one instance can receive, as painlessMesh has a single callback.
+class PainlessMeshLink : public HalMesh {
+public:
+    explicit PainlessMeshLink(painlessMesh &mesh) : m_mesh(mesh) {}
+
+    uint32_t nodeId() override { return m_mesh.getNodeId(); }
+
+    bool broadcast(const char *msg) override {
+        String text(msg);
+        return m_mesh.sendBroadcast(text);
+    }
+
+    bool sendTo(uint32_t node, const char *msg) override {
+        String text(msg);
+        return m_mesh.sendSingle(node, text);
+    }
+
+    void onReceive(Receiver receiver, void *context) override {
+        target().receiver = receiver;
+        target().context = context;
+        m_mesh.onReceive([](uint32_t from, String &msg) {
+            target().receiver(target().context, from, msg.c_str(), msg.length());
+        });
+    }
+
+    void update() override { m_mesh.update(); }
+
+private:
+    struct Target {
+        Receiver receiver;
+        void *context;
+    };
+
+    static Target &target() {
+        static Target t = {};
+        return t;
+    }
+
+    painlessMesh &m_mesh;
+};
+
+// One NVS namespace; each key is a blob
+class NvsStorage : public HalStorage {
+public:
+    bool load(const char *key, void *data, size_t size) override {
+        Preferences prefs;
+        if (!prefs.begin(HAL_STORAGE_NAMESPACE, true)) {
+            return false;
+        }
+        bool ok = prefs.getBytesLength(key) == size && prefs.getBytes(key, data, size) == size;
+        prefs.end();
+        return ok;
+    }
+
+    bool save(const char *key, const void *data, size_t size) override {
+        Preferences prefs;
+        if (!prefs.begin(HAL_STORAGE_NAMESPACE, false)) {
+            return false;
+        }
+        bool ok = prefs.putBytes(key, data, size) == size;
+        prefs.end();
+        return ok;
+    }
+};
@@ -0,0 +1,239 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        hal_native.h
+//
+// Description:
+//
+//   hal.h fakes for a Linux host.  Time only moves when the owner of a
+//   FakeClock advances it, and FakeMeshBus delivers broadcasts in the
+//   order they were sent, so a simulation gives the same result on every
+//   run.  Each fake keeps what the code under it did (bytes written,
+//   tile rows sent, LED frames, messages) for the caller to inspect.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <hal.h>
+#include <framebuffer.h>
+
+#include <deque>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+class FakeClock : public HalClock {
+public:
+    uint32_t millis() override { return (uint32_t)(m_us / 1000); }
+    uint32_t micros() override { return (uint32_t)m_us; }
+
+    void advanceUs(uint64_t us) { m_us += us; }
+    void advanceMs(uint32_t ms) { m_us += (uint64_t)ms * 1000; }
+    uint64_t nowUs() const { return m_us; }
+
+private:
+    uint64_t m_us = 0;
+};
+
+// Both directions of a UART.  inject() queues bytes for the device side
+// to read; whatever it writes collects in written().
+class FakeSerial : public HalSerial {
+public:
+    int available() override { return (int)m_rx.size(); }
+
+    int read() override {
+        if (m_rx.empty()) {
+            return -1;
+        }
+        uint8_t b = m_rx.front();
+        m_rx.pop_front();
+        return b;
+    }
+
+    size_t write(const uint8_t *data, size_t len) override {
+        m_tx.insert(m_tx.end(), data, data + len);
+        return len;
+    }
+
+    void inject(const uint8_t *data, size_t len) { m_rx.insert(m_rx.end(), data, data + len); }
+    std::vector<uint8_t> &written() { return m_tx; }
+
+private:
+    std::deque<uint8_t> m_rx;
+    std::vector<uint8_t> m_tx;
+};
+
+// Frame buffer plus a copy of what the "panel" shows, updated only by
+// the tile rows actually sent
+class FakeDisplay : public HalDisplay {
+public:
+    uint8_t *buffer() override { return m_buffer; }
+    void clearBuffer() override { memset(m_buffer, 0, sizeof(m_buffer)); }
+
+    void updateArea(int tileX, int tileY, int tileWidth, int tileHeight) override {
+        for (int row = tileY; row < tileY + tileHeight; row++) {
+            memcpy(m_panel + row * FB_WIDTH + tileX * 8, m_buffer + row * FB_WIDTH + tileX * 8, tileWidth * 8);
+        }
+        m_updates++;
+        m_tileRows += tileHeight;
+    }
+
+    const uint8_t *panel() const { return m_panel; }
+    uint32_t updates() const { return m_updates; }
+    uint32_t tileRows() const { return m_tileRows; }
+
+    // The panel as text, one character per pixel
+    void print(FILE *out) const {
+        for (int y = 0; y < FB_HEIGHT; y++) {
+            for (int x = 0; x < FB_WIDTH; x++) {
+                fputc(m_panel[(y / 8) * FB_WIDTH + x] & (1 << (y & 7)) ? '#' : '.', out);
+            }
+            fputc('\n', out);
+        }
+    }
+
+private:
+    uint8_t m_buffer[FB_BYTES] = {};
+    uint8_t m_panel[FB_BYTES] = {};
+    uint32_t m_updates = 0;
+    uint32_t m_tileRows = 0;
+};
+
+class FakeLeds : public HalLeds {
+public:
+    void show(const LedColor *pixels, int count) override {
+        m_pixels.assign(pixels, pixels + count);
+        m_shows++;
+    }
+
+    const std::vector<LedColor> &pixels() const { return m_pixels; }
+    uint32_t shows() const { return m_shows; }
+
+private:
+    std::vector<LedColor> m_pixels;
+    uint32_t m_shows = 0;
+};
+
+class FakeMesh;
+
+// Connects FakeMesh nodes.  A broadcast is queued for every other node
+// and handed over on that node's next update(); a message to one node
+// only for that node, and fails if it is not attached.
+class FakeMeshBus {
+public:
+    void attach(FakeMesh *node) { m_nodes.push_back(node); }
+    inline void broadcast(uint32_t from, const char *msg);
+    inline bool sendTo(uint32_t from, uint32_t to, const char *msg);
+    uint32_t messages() const { return m_messages; }
+
+private:
+    std::vector<FakeMesh *> m_nodes;
+    uint32_t m_messages = 0;
+};
+
+class FakeMesh : public HalMesh {
+public:
+    FakeMesh(FakeMeshBus &bus, uint32_t nodeId) : m_bus(bus), m_nodeId(nodeId) { bus.attach(this); }
+
+    uint32_t nodeId() override { return m_nodeId; }
+
+    bool broadcast(const char *msg) override {
+        m_bus.broadcast(m_nodeId, msg);
+        m_sent++;
+        return true;
+    }
+
+    bool sendTo(uint32_t node, const char *msg) override {
+        if (!m_bus.sendTo(m_nodeId, node, msg)) {
+            return false;
+        }
+        m_sent++;
+        return true;
+    }
+
+    void onReceive(Receiver receiver, void *context) override {
+        m_receiver = receiver;
+        m_context = context;
+    }
+
+    void update() override {
+        while (!m_inbox.empty()) {
+            Message m = m_inbox.front();
+            m_inbox.pop_front();
+            if (m_receiver) {
+                m_receiver(m_context, m.from, m.text.c_str(), m.text.size());
+            }
+        }
+    }
+
+    void deliver(uint32_t from, const char *msg) { m_inbox.push_back({ from, msg }); }
+    bool pending() const { return !m_inbox.empty(); }
+    uint32_t sent() const { return m_sent; }
+
+private:
+    struct Message {
+        uint32_t from;
+        std::string text;
+    };
+
+    FakeMeshBus &m_bus;
+    uint32_t m_nodeId;
+    Receiver m_receiver = nullptr;
+    void *m_context = nullptr;
+    std::deque<Message> m_inbox;
+    uint32_t m_sent = 0;
+};
+
+inline void FakeMeshBus::broadcast(uint32_t from, const char *msg) {
+    for (FakeMesh *node : m_nodes) {
+        if (node->nodeId() != from) {
+            node->deliver(from, msg);
+        }
+    }
+    m_messages++;
+}
+
+inline bool FakeMeshBus::sendTo(uint32_t from, uint32_t to, const char *msg) {
+    for (FakeMesh *node : m_nodes) {
+        if (node->nodeId() == to && to != from) {
+            node->deliver(from, msg);
+            m_messages++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// One file per key under a directory, which must exist
+class FileStorage : public HalStorage {
+public:
+    explicit FileStorage(const char *dir) : m_dir(dir) {}
+
+    bool load(const char *key, void *data, size_t size) override {
+        FILE *f = fopen(path(key).c_str(), "rb");
+        if (!f) {
+            return false;
+        }
+        bool ok = fread(data, 1, size, f) == size && fgetc(f) == EOF;
+        fclose(f);
+        return ok;
+    }
+
+    bool save(const char *key, const void *data, size_t size) override {
+        FILE *f = fopen(path(key).c_str(), "wb");
+        if (!f) {
+            return false;
+        }
+        bool ok = fwrite(data, 1, size, f) == size;
+        return fclose(f) == 0 && ok;
+    }
+
+private:
+    std::string path(const char *key) const { return m_dir + "/" + key; }
+
+    std::string m_dir;
+};
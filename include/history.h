@@ -0,0 +1,75 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        history.h
+//
+// Description:
+//
+//   Fixed-size ring of recent samples for trend pages, plus decimation of
+//   that ring to a given number of sparkline columns.  Decimation steps
+//   through the samples with a 16.16 fixed-point stride and keeps the
+//   maximum of each bucket, so short spikes stay visible.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+#define HISTORY_SAMPLES 120
+
+class History {
+public:
+    void push(uint16_t v) {
+        m_samples[m_head] = v;
+        m_head = (m_head + 1) % HISTORY_SAMPLES;
+        if (m_count < HISTORY_SAMPLES) {
+            m_count++;
+        }
+    }
+
+    int count() const { return m_count; }
+
+    // i = 0 is the oldest sample still held
+    uint16_t at(int i) const {
+        int start = (m_head + HISTORY_SAMPLES - m_count) % HISTORY_SAMPLES;
+        return m_samples[(start + i) % HISTORY_SAMPLES];
+    }
+
+    // Reduces the samples to at most `columns` bucket maxima, oldest first.
+    // Returns the number of columns filled (fewer when samples < columns).
+    int decimate(uint16_t *out, int columns, uint16_t *lo, uint16_t *hi) const {
+        *lo = 0xFFFF;
+        *hi = 0;
+        if (m_count == 0) {
+            return 0;
+        }
+        int used = m_count < columns ? m_count : columns;
+        uint32_t stride = ((uint32_t)m_count << 16) / used;
+        uint32_t pos = 0;
+        for (int c = 0; c < used; c++) {
+            int first = pos >> 16;
+            pos += stride;
+            int last = (pos >> 16) - 1;
+            if (last < first) {
+                last = first;
+            }
+            uint16_t peak = 0;
+            for (int i = first; i <= last && i < m_count; i++) {
+                uint16_t v = at(i);
+                peak = v > peak ? v : peak;
+            }
+            out[c] = peak;
+            *lo = peak < *lo ? peak : *lo;
+            *hi = peak > *hi ? peak : *hi;
+        }
+        return used;
+    }
+
+private:
+    uint16_t m_samples[HISTORY_SAMPLES];
+    int m_head = 0;
+    int m_count = 0;
+};
@@ -0,0 +1,175 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        led_status.h
+//
+// Description:
+//
+//   Status LEDs: one WS2812B per reading, coloured by how bad that reading
+//   is.  Levels pick a colour from a fixed palette (the EPA AQI colours);
+//   a change of level fades to the new colour over LED_FADE_MS, one step
+//   per tick(), and alert LEDs blink off on alternate LED_BLINK_MS phases
+//   of millis().  Colours are mixed in palette space and then put through
+//   a gamma table built at compile time, so fades look even to the eye.
+//
+//   tick() updates pixels() and returns true only when one of them
+//   changed, so the caller only pays for a HalLeds::show() on real changes.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <aqi.h>
+#include <hal.h>          // LedColor
+
+#define LED_FADE_MS     600     // Time to fade from one level's colour to the next
+#define LED_BLINK_MS    500     // Alert blink half-period
+#define LED_LEVELS      6       // Good .. hazardous
+#define LED_ALERT_LEVEL 4       // PM levels from here up blink
+
+// Gamma 2.5 as a constant expression (C++11 rules: one return each)
+constexpr double ledSqrt(double x, double g, int n) {
+    return n == 0 ? g : ledSqrt(x, 0.5 * (g + x / g), n - 1);
+}
+constexpr uint8_t ledGamma(int i) {
+    return i == 0 ? 0 : (uint8_t)(255.0 * (i / 255.0) * (i / 255.0) * ledSqrt(i / 255.0, 1.0, 8) + 0.5);
+}
+
+#define LED_G4(i)   ledGamma(i), ledGamma(i + 1), ledGamma(i + 2), ledGamma(i + 3)
+#define LED_G16(i)  LED_G4(i), LED_G4(i + 4), LED_G4(i + 8), LED_G4(i + 12)
+#define LED_G64(i)  LED_G16(i), LED_G16(i + 16), LED_G16(i + 32), LED_G16(i + 48)
+
+static constexpr uint8_t kLedGamma[256] = { LED_G64(0), LED_G64(64), LED_G64(128), LED_G64(192) };
+
+static_assert(kLedGamma[0] == 0 && kLedGamma[255] == 255, "gamma table endpoints");
+static_assert(kLedGamma[128] < 64, "gamma table should darken mid-tones");
+
+#undef LED_G4
+#undef LED_G16
+#undef LED_G64
+
+// EPA AQI category colours, before gamma
+static constexpr LedColor kLedPalette[LED_LEVELS] = {
+    {   0, 228,   0 },  // Good
+    { 255, 255,   0 },  // Moderate
+    { 255, 126,   0 },  // Unhealthy for sensitive groups
+    { 255,   0,   0 },  // Unhealthy
+    { 143,  63, 151 },  // Very unhealthy
+    { 126,   0,  35 },  // Hazardous
+};
+
+// AQI to palette level
+inline int ledLevelFromAqi(uint16_t aqi) {
+    return aqi <= 50 ? 0 : aqi <= 100 ? 1 : aqi <= 150 ? 2 : aqi <= 200 ? 3 : aqi <= 300 ? 4 : 5;
+}
+
+// Level from how far a value sits outside a comfortable range.  steps[]
+// are the distances at which each further level starts.
+inline int ledLevelFromRange(int32_t v, int32_t lo, int32_t hi, const int32_t steps[4]) {
+    int32_t d = v < lo ? lo - v : v > hi ? v - hi : 0;
+    int level = 0;
+    while (level < 4 && d > steps[level]) {
+        level++;
+    }
+    return level;
+}
+
+template <int N>
+class LedStatus {
+public:
+    LedStatus() {}
+
+    // Sets the level an LED should show; -1 turns it off
+    void setLevel(int led, int level, bool alert = false) {
+        Pixel &p = m_pixels[led];
+        p.alert = alert;
+        if (level == p.level) {
+            return;
+        }
+        p.from = current(p);  // Fade on from wherever it is now
+        p.to = level < 0 ? LedColor{0, 0, 0} : kLedPalette[level < LED_LEVELS ? level : LED_LEVELS - 1];
+        p.level = level;
+        p.progress = 0;
+    }
+
+    // Advances fades by the time since the last tick and updates pixels().
+    // Returns true if any pixel changed.
+    bool tick(uint32_t now) {
+        uint32_t elapsed = m_lastTick ? now - m_lastTick : 0;
+        m_lastTick = now;
+        uint32_t step = elapsed * 256 / LED_FADE_MS;
+        bool blinkOff = (now / LED_BLINK_MS) & 1;
+
+        bool changed = false;
+        for (int i = 0; i < N; i++) {
+            Pixel &p = m_pixels[i];
+            p.progress = p.progress + step > 256 ? 256 : p.progress + step;
+            LedColor c = current(p);
+            LedColor out = (p.alert && blinkOff) ? LedColor{0, 0, 0} : LedColor{kLedGamma[c.r], kLedGamma[c.g], kLedGamma[c.b]};
+            if (out.r != m_leds[i].r || out.g != m_leds[i].g || out.b != m_leds[i].b) {
+                m_leds[i] = out;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // Gamma-corrected colours as of the last tick()
+    const LedColor *pixels() const { return m_leds; }
+
+    // True while a fade or blink still needs ticks
+    bool animating() const {
+        for (int i = 0; i < N; i++) {
+            if (m_pixels[i].progress < 256 || m_pixels[i].alert) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Pixel {
+        LedColor from = {0, 0, 0};
+        LedColor to = {0, 0, 0};
+        uint16_t progress = 256;    // 0..256 through the fade
+        int8_t level = -1;
+        bool alert = false;
+    };
+
+    static uint8_t mix(uint8_t a, uint8_t b, uint16_t t) {
+        return a + (((int)b - a) * t >> 8);
+    }
+
+    static LedColor current(const Pixel &p) {
+        return { mix(p.from.r, p.to.r, p.progress), mix(p.from.g, p.to.g, p.progress), mix(p.from.b, p.to.b, p.progress) };
+    }
+
+    LedColor m_leds[N] = {};
+    Pixel m_pixels[N];
+    uint32_t m_lastTick = 0;
+};
+
+// Points one LED per reading value (pm1.0, pm2.5, pm10.0, temp, hum) at
+// the level that value has reached.  A value that is unknown (nullptr,
+// or not a number, like "null") turns its LED off.
+template <int N>
+void ledShowReadings(LedStatus<N> &leds, const char *const values[5]) {
+    static_assert(N >= 5, "One LED per reading value");
+    static const int32_t tempSteps[4] = { 30, 80, 150, 250 };   // Tenths of a degree F
+    static const int32_t humSteps[4] = { 50, 100, 200, 300 };   // Tenths of a percent
+
+    bool known[5];
+    for (int i = 0; i < 5; i++) {
+        known[i] = isReadingNumber(values[i]);
+    }
+    int pm1 = known[0] ? ledLevelFromAqi(aqiPm25(tenthsFromText(values[0]))) : -1;  // No PM1 scale; use PM2.5's
+    int pm25 = known[1] ? ledLevelFromAqi(aqiPm25(tenthsFromText(values[1]))) : -1;
+    int pm10 = known[2] ? ledLevelFromAqi(aqiPm10(tenthsFromText(values[2]))) : -1;
+    leds.setLevel(0, pm1, pm1 >= LED_ALERT_LEVEL);
+    leds.setLevel(1, pm25, pm25 >= LED_ALERT_LEVEL);
+    leds.setLevel(2, pm10, pm10 >= LED_ALERT_LEVEL);
+    leds.setLevel(3, known[3] ? ledLevelFromRange(tenthsFromText(values[3]), 640, 790, tempSteps) : -1);
+    leds.setLevel(4, known[4] ? ledLevelFromRange(tenthsFromText(values[4]), 300, 600, humSteps) : -1);
+}
@@ -0,0 +1,60 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        log_formats.h
+//
+// Description:
+//
+//   Every binary log message, as (id, format).  Records carry only the
+//   id and raw arguments; the firmware's log drain and the host decoder
+//   both format them from this table, so the two must be built from the
+//   same revision.  Append new entries at the end to keep old ids valid.
+//
+//   Conversions: %u unsigned, %d signed, %x hex, %h signed hundredths
+//   (-350 prints as -3.50), %% a literal percent.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#define LOG_FORMAT_LIST(X) \
+    X(LOG_BOOT,             "boot node=%u") \
+    X(LOG_MESH_RX,          "rx from=%u bytes=%u") \
+    X(LOG_MESH_READING,     "reading node=%u pm1.0=%h pm2.5=%h pm10=%h temp=%h hum=%h") \
+    X(LOG_MESH_PARSE_ERROR, "bad json from=%u error=%u") \
+    X(LOG_MESH_CONNECTED,   "new connection node=%u") \
+    X(LOG_MESH_CHANGED,     "connections changed, %u nodes") \
+    X(LOG_MESH_TIME,        "time adjusted to %u, offset %d") \
+    X(LOG_QUEUE_FULL,       "reading dropped, queue full (source %u)") \
+    X(LOG_SENSOR_READING,   "sensor pm1.0=%u pm2.5=%u pm10=%u") \
+    X(LOG_HEAP_ALERT,       "heap low or fragmented: free=%u largest=%u frag=%u%%") \
+    X(LOG_HEAP_RECOVERED,   "heap recovered: free=%u largest=%u frag=%u%%") \
+    X(LOG_MEM_OVER_BUDGET,  "budget entry %u over: %u of %u bytes") \
+    X(LOG_ROLE,             "role %u features %x") \
+    X(LOG_BOOT_RESET,       "reset reason %u") \
+    X(LOG_BOOT_RESTORED,    "state restored from source %u: %u nodes, saved at %u s uptime, boot %u") \
+    X(LOG_BOOT_PHASE,       "boot phase %u took %u us") \
+    X(LOG_BOOT_JOINED,      "first mesh connection %u ms after start") \
+    X(LOG_BOOT_FIRST_TX,    "first broadcast to the mesh %u ms after start") \
+    X(LOG_BOOT_SAVE_FAILED, "saving %u bytes of boot state to flash failed") \
+    X(LOG_DUTY_WAKE,        "wake %u: %u reads, delivered %u, awake %u ms") \
+    X(LOG_DUTY_ENERGY,      "average %u uA, %u uJ per reading, sleeping %u ms") \
+    X(LOG_RATE_TIER,        "rate tier %u: sample every %u ms, report every %u ms (pm2.5 %u)") \
+    X(LOG_CAL_LOADED,       "calibration model %u loaded from flash") \
+    X(LOG_CAL_SET,          "calibration model %u set, saved %u") \
+    X(LOG_OUTLIER,          "value %u: %u rejected as a spike, window median %u")
+
+#define LOG_FORMAT_ID(id, fmt) id,
+enum LogFormat {
+    LOG_FORMAT_LIST(LOG_FORMAT_ID)
+    LOG_FORMAT_COUNT
+};
+#undef LOG_FORMAT_ID
+
+#define LOG_FORMAT_TEXT(id, fmt) fmt,
+static const char *const kLogFormats[LOG_FORMAT_COUNT] = {
+    LOG_FORMAT_LIST(LOG_FORMAT_TEXT)
+};
+#undef LOG_FORMAT_TEXT
@@ -0,0 +1,178 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        mem_telemetry.h
+//
+// Description:
+//
+//   Heap health and per-subsystem allocation counts.
+//
+//   readHeap() samples the byte-addressable heap malloc() draws from: free
+//   bytes, the minimum it has ever been and the largest single free
+//   block.  Fragmentation is how far that block has fallen short of what
+//   the heap allows: a node with 60 KB free but nothing over 4 KB
+//   contiguous will fail the next large allocation, even though "free
+//   heap" looks fine.
+//
+//   The ESP32 heap is several memory regions that were never contiguous,
+//   so even at boot the largest block is well under half the free bytes.
+//   Counted against total free, that read as 60-70% "fragmented" on a
+//   fresh node and kept the alert on.  markHeapBaseline() records the
+//   largest-block share once in setup(); fragPct is the loss of share
+//   since, so a fresh node is at 0% and one whose largest block has
+//   shrunk to a third of its boot share is at 67%.
+//
+//   TaggedJsonAllocator plugs into a JsonDocument so its heap use is
+//   counted against a MemTag.  Each block gets a small size header so
+//   frees can be subtracted exactly.  A tag is meant to be used from one
+//   task, so the counters are plain integers.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#endif
+
+#define MEM_FRAG_ALERT_PCT  60      // Alert above this fragmentation
+#define MEM_LOW_HEAP_BYTES  24000   // Alert below this much free heap
+
+enum MemTag {
+    MEM_TAG_JSON_MESH,      // jsonReadings: broadcasts and received messages
+    MEM_TAG_JSON_WEB,       // Documents built for HTTP responses
+    MEM_TAG_COUNT
+};
+
+static const char *const kMemTagNames[MEM_TAG_COUNT] = { "json_mesh", "json_web" };
+
+struct MemTagStats {
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+    uint32_t bytesLive;
+    uint32_t bytesPeak;
+};
+
+struct HeapSnapshot {
+    uint32_t size;
+    uint32_t free;
+    uint32_t minFree;       // Low-water mark since boot
+    uint32_t largest;       // Largest block malloc() could return now
+    uint8_t fragPct;
+};
+
+struct HeapBaseline {
+    uint32_t free;          // 0 until marked: fragPct is then against total free
+    uint32_t largest;
+};
+
+inline HeapBaseline &heapBaseline() {
+    static HeapBaseline base = {};
+    return base;
+}
+
+// Percent of the baseline's largest-block share of free memory that is
+// gone now; 0 if the share is the same or better
+inline uint8_t heapFragPct(uint32_t free, uint32_t largest, const HeapBaseline &base) {
+    if (!free) {
+        return 0;
+    }
+    // largest / free against base.largest / base.free, cross-multiplied
+    uint64_t now = (uint64_t)largest * (base.free ? base.free : 1);
+    uint64_t then = (uint64_t)(base.free ? base.largest : 1) * free;
+    return now >= then ? 0 : (uint8_t)(100 - now * 100 / then);
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+inline HeapSnapshot readHeap() {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+    HeapSnapshot h;
+    h.size = heap_caps_get_total_size(MALLOC_CAP_8BIT);
+    h.free = info.total_free_bytes;
+    h.minFree = info.minimum_free_bytes;
+    h.largest = info.largest_free_block;
+    h.fragPct = heapFragPct(h.free, h.largest, heapBaseline());
+    return h;
+}
+
+// Takes the heap as it is now as unfragmented.  Call once in setup(),
+// after the big allocations and before other tasks start.
+inline void markHeapBaseline() {
+    HeapSnapshot h = readHeap();
+    heapBaseline() = { h.free, h.largest };
+}
+#endif
+
+inline bool heapAlert(const HeapSnapshot &h) {
+    return h.fragPct > MEM_FRAG_ALERT_PCT || h.free < MEM_LOW_HEAP_BYTES;
+}
+
+class TaggedJsonAllocator : public ArduinoJson::Allocator {
+public:
+    explicit TaggedJsonAllocator(MemTagStats &stats) : m_stats(stats) {}
+
+    void *allocate(size_t size) override {
+        Header *h = (Header *)malloc(sizeof(Header) + size);
+        if (!h) {
+            m_stats.failures++;
+            return nullptr;
+        }
+        h->size = size;
+        m_stats.allocs++;
+        grow(size);
+        return h + 1;
+    }
+
+    void deallocate(void *ptr) override {
+        if (!ptr) {
+            return;
+        }
+        Header *h = (Header *)ptr - 1;
+        m_stats.frees++;
+        m_stats.bytesLive -= h->size;
+        free(h);
+    }
+
+    void *reallocate(void *ptr, size_t size) override {
+        if (!ptr) {
+            return allocate(size);
+        }
+        Header *old = (Header *)ptr - 1;
+        size_t oldSize = old->size;
+        Header *h = (Header *)realloc(old, sizeof(Header) + size);
+        if (!h) {
+            m_stats.failures++;
+            return nullptr;  // The old block is still valid
+        }
+        h->size = size;
+        m_stats.bytesLive -= oldSize;
+        grow(size);
+        return h + 1;
+    }
+
+private:
+    // Keeps the payload aligned as malloc() would
+    union Header {
+        size_t size;
+        max_align_t align;
+    };
+
+    void grow(size_t size) {
+        m_stats.bytesLive += size;
+        if (m_stats.bytesLive > m_stats.bytesPeak) {
+            m_stats.bytesPeak = m_stats.bytesLive;
+        }
+    }
+
+    MemTagStats &m_stats;
+};
@@ -0,0 +1,111 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        mpsc_queue.h
+//
+// Description:
+//
+//   Bounded lock-free queue for any number of producers and one consumer.
+//   Every slot carries a sequence number (Vyukov's bounded queue):
+//   producers reserve a position with a compare-and-swap on the head and
+//   mark the slot published by advancing its sequence; the consumer reads
+//   slots in order and hands each back by advancing the sequence a lap.
+//
+//     producer:  size_t t; T *slot = q.claim(t);   fill *slot;   q.publish(t);
+//     consumer:  T *item = q.front();               use *item;    q.pop();
+//
+//   As with SpscQueue, slots are owned by whoever claimed them until they
+//   are published or popped.  Items come out in reservation order, so a
+//   producer should publish promptly after claiming; the consumer sees
+//   the queue as empty until the oldest claimed slot is published.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <spsc_queue.h>         // QUEUE_CACHE_LINE
+
+template <typename T, size_t N>
+class MpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "MpscQueue size must be a power of two");
+
+public:
+    MpscQueue() {
+        for (size_t i = 0; i < N; i++) {
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Producer side; safe from any number of threads
+    T *claim(size_t &ticket) {
+        size_t pos = m_head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = m_cells[pos & (N - 1)];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+            if (diff == 0) {
+                if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    ticket = pos;
+                    return &cell.item;
+                }
+            } else if (diff < 0) {
+                return nullptr;  // Full: the consumer hasn't freed this slot yet
+            } else {
+                pos = m_head.load(std::memory_order_relaxed);  // Another producer won
+            }
+        }
+    }
+
+    void publish(size_t ticket) {
+        m_cells[ticket & (N - 1)].seq.store(ticket + 1, std::memory_order_release);
+    }
+
+    bool push(const T &item) {
+        size_t ticket;
+        T *slot = claim(ticket);
+        if (!slot) {
+            return false;
+        }
+        *slot = item;
+        publish(ticket);
+        return true;
+    }
+
+    // Consumer side; one thread only
+    T *front() {
+        Cell &cell = m_cells[m_tail & (N - 1)];
+        if (cell.seq.load(std::memory_order_acquire) != m_tail + 1) {
+            return nullptr;
+        }
+        return &cell.item;
+    }
+
+    void pop() {
+        m_cells[m_tail & (N - 1)].seq.store(m_tail + N, std::memory_order_release);
+        m_tail++;
+    }
+
+    bool tryPop(T &out) {
+        T *item = front();
+        if (!item) {
+            return false;
+        }
+        out = *item;
+        pop();
+        return true;
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T item;
+    };
+
+    Cell m_cells[N];
+    alignas(QUEUE_CACHE_LINE) std::atomic<size_t> m_head{0};    // Shared by producers
+    alignas(QUEUE_CACHE_LINE) size_t m_tail = 0;                // Consumer only
+};
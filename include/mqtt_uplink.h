@@ -0,0 +1,380 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        mqtt_uplink.h
+//
+// Description:
+//
+//   MQTT 3.1.1 publisher for gateway nodes.  Readings are queued in a
+//   bounded RAM ring and published QoS 1 to <prefix>/<nodeId>, with up to
+//   MQTT_INFLIGHT publishes awaiting PUBACK at once.  Each publish takes
+//   the oldest waiting reading and up to MQTT_BATCH - 1 more of the same
+//   node's from anywhere in the queue, as one JSON array, so readings
+//   from interleaved nodes still batch; that is what drains the backlog
+//   quickly after the broker comes back.  A node's readings keep their
+//   order.
+//
+//   Only the packets a QoS 1 publisher needs are implemented: CONNECT,
+//   PUBLISH, PUBACK and PINGREQ.  Runs over any Arduino Client; the only
+//   blocking calls are the TCP connect and packet writes.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+#include <node_table.h>
+
+#define MQTT_QUEUE_SIZE     64      // Readings buffered while offline
+#define MQTT_INFLIGHT       4       // Unacknowledged publishes allowed
+#define MQTT_BATCH          8       // Max readings in one publish
+#define MQTT_PACKET_SIZE    1024    // Largest packet we build
+#define MQTT_KEEPALIVE_S    30
+#define MQTT_ACK_TIMEOUT_MS 10000   // No PUBACK by then: reconnect and resend
+#define MQTT_BACKOFF_MIN_MS 1000
+#define MQTT_BACKOFF_MAX_MS 60000
+
+struct UplinkRecord {
+    uint32_t node;
+    uint32_t takenAt;           // millis() when the reading was queued
+    uint16_t packetId;          // The publish carrying it, while sent
+    uint8_t state;              // UPLINK_*
+    char value[NODE_VALUES][NODE_VALUE_LEN];
+};
+
+#define UPLINK_WAITING      0
+#define UPLINK_SENT         1   // In a publish awaiting PUBACK
+#define UPLINK_ACKED        2   // Done; leaves once everything older has
+
+struct MqttStats {
+    uint32_t queued;            // Readings accepted into the queue
+    uint32_t dropped;           // Readings overwritten while offline
+    uint32_t publishes;         // PUBLISH packets sent, resends included
+    uint32_t acked;             // Readings confirmed by the broker
+    uint32_t connects;          // Successful CONNACKs
+    uint32_t failures;          // Failed connects, timeouts and protocol errors
+};
+
+class MqttUplink {
+public:
+    MqttUplink(Client &client, const char *host, uint16_t port, const char *clientId, const char *prefix)
+        : m_client(client), m_host(host), m_port(port), m_clientId(clientId), m_prefix(prefix) {}
+
+    // Copies a reading into the queue; drops the oldest reading when full
+    void enqueue(const NodeEntry &entry) {
+        if (m_tail - m_head == MQTT_QUEUE_SIZE) {
+            m_head++;
+            popAcked();
+            m_stats.dropped++;
+        }
+        UplinkRecord &r = m_queue[m_tail % MQTT_QUEUE_SIZE];
+        r.node = entry.nodeId;
+        r.takenAt = millis();
+        r.packetId = 0;
+        r.state = UPLINK_WAITING;
+        memcpy(r.value, entry.value, sizeof(r.value));
+        m_tail++;
+        m_stats.queued++;
+    }
+
+    // Drives the connection, publishes and acks.  Call from loop().
+    void update() {
+        unsigned long now = millis();
+
+        switch (m_state) {
+        case Disconnected:
+            if (now - m_lastAttempt >= m_backoff) {
+                m_lastAttempt = now;
+                if (!m_client.connect(m_host, m_port)) {
+                    fail();
+                } else if (sendConnect()) {  // A failed write has already called fail()
+                    m_state = AwaitConnack;
+                    m_lastRx = now;
+                }
+            }
+            return;
+
+        case AwaitConnack:
+            if (!m_client.connected() || now - m_lastRx > MQTT_ACK_TIMEOUT_MS) {
+                fail();
+                return;
+            }
+            receive();
+            if (m_state == Connected) {
+                sendPending(now);
+            }
+            return;
+
+        case Connected:
+            if (!m_client.connected()) {
+                fail();
+                return;
+            }
+            receive();
+            if (m_state != Connected) {
+                return;
+            }
+            if (m_inflightCount && now - m_inflight[m_inflightFirst].sentAt > MQTT_ACK_TIMEOUT_MS) {
+                fail();
+                return;
+            }
+            sendPending(now);
+            return;
+        }
+    }
+
+    bool connected() const { return m_state == Connected; }
+    uint32_t backlog() const { return m_tail - m_head; }
+    int inflight() const { return m_inflightCount; }
+    const MqttStats &stats() const { return m_stats; }
+
+private:
+    enum State { Disconnected, AwaitConnack, Connected };
+
+    struct Inflight {
+        uint16_t packetId;
+        uint32_t sentAt;
+    };
+
+    // Fills the in-flight window, or pings if there is nothing to send
+    void sendPending(unsigned long now) {
+        while (m_inflightCount < MQTT_INFLIGHT && m_send != m_tail) {
+            if (!publishNext()) {
+                return;
+            }
+        }
+        if (now - m_lastTx > MQTT_KEEPALIVE_S * 1000UL / 2) {
+            static const uint8_t ping[] = { 0xC0, 0x00 };
+            writePacket(ping, sizeof(ping));
+        }
+    }
+
+    // Tears the session down; everything unacknowledged is sent again
+    void fail() {
+        m_client.stop();
+        m_state = Disconnected;
+        m_inflightCount = 0;
+        for (uint32_t seq = m_head; seq != m_tail; seq++) {
+            UplinkRecord &r = m_queue[seq % MQTT_QUEUE_SIZE];
+            r.state = r.state == UPLINK_SENT ? UPLINK_WAITING : r.state;
+        }
+        m_send = m_head;
+        m_rxLen = 0;
+        m_stats.failures++;
+        m_backoff = min(m_backoff * 2, (unsigned long)MQTT_BACKOFF_MAX_MS);
+    }
+
+    static size_t putString(uint8_t *p, const char *s) {
+        size_t len = strlen(s);
+        p[0] = len >> 8;
+        p[1] = len & 0xFF;
+        memcpy(p + 2, s, len);
+        return len + 2;
+    }
+
+    // Variable-length "remaining length"; returns bytes used
+    static size_t putLength(uint8_t *p, size_t len) {
+        size_t n = 0;
+        do {
+            uint8_t b = len % 128;
+            len /= 128;
+            p[n++] = len ? (b | 0x80) : b;
+        } while (len);
+        return n;
+    }
+
+    // Writes fixed header + body where the body already sits at m_tx + 5
+    bool finishPacket(uint8_t type, size_t bodyLen) {
+        uint8_t header[5];
+        header[0] = type;
+        size_t h = 1 + putLength(header + 1, bodyLen);
+        uint8_t *start = m_tx + 5 - h;
+        memcpy(start, header, h);
+        return writePacket(start, h + bodyLen);
+    }
+
+    // Tears the session down itself if the write fails, so callers only
+    // stop on false
+    bool writePacket(const uint8_t *data, size_t len) {
+        if (m_client.write(data, len) != len) {
+            fail();
+            return false;
+        }
+        m_lastTx = millis();
+        return true;
+    }
+
+    bool sendConnect() {
+        uint8_t *p = m_tx + 5;
+        size_t n = putString(p, "MQTT");
+        p[n++] = 4;                     // Protocol level 3.1.1
+        p[n++] = 0x02;                  // Clean session; unacked readings are resent from our queue
+        p[n++] = MQTT_KEEPALIVE_S >> 8;
+        p[n++] = MQTT_KEEPALIVE_S & 0xFF;
+        n += putString(p + n, m_clientId);
+        return finishPacket(0x10, n);
+    }
+
+    // Drops acknowledged readings off the front, and keeps m_send on the
+    // oldest waiting one
+    void popAcked() {
+        while (m_head != m_tail && m_queue[m_head % MQTT_QUEUE_SIZE].state == UPLINK_ACKED) {
+            m_head++;
+        }
+        if ((int32_t)(m_send - m_head) < 0) {
+            m_send = m_head;
+        }
+        while (m_send != m_tail && m_queue[m_send % MQTT_QUEUE_SIZE].state != UPLINK_WAITING) {
+            m_send++;
+        }
+    }
+
+    // Publishes the oldest waiting reading with the same node's next
+    // waiting ones
+    bool publishNext() {
+        const UplinkRecord &first = m_queue[m_send % MQTT_QUEUE_SIZE];
+        uint8_t *body = m_tx + 5;
+        uint8_t *limit = m_tx + sizeof(m_tx);
+        unsigned long now = millis();
+
+        char topic[64];
+        snprintf(topic, sizeof(topic), "%s/%u", m_prefix, (unsigned)first.node);
+        size_t n = putString(body, topic);
+        uint16_t packetId = nextPacketId();
+        body[n++] = packetId >> 8;
+        body[n++] = packetId & 0xFF;
+
+        // Payload: [{"age":ms,"v":[pm1.0,pm2.5,pm10.0,temp,hum]}, ...]
+        char *json = (char *)body + n;
+        size_t room = limit - (uint8_t *)json;
+        size_t len = 0;
+        uint32_t taken[MQTT_BATCH];
+        int count = 0;
+        json[len++] = '[';
+        for (uint32_t seq = m_send; seq != m_tail && count < MQTT_BATCH; seq++) {
+            const UplinkRecord &r = m_queue[seq % MQTT_QUEUE_SIZE];
+            if (r.state != UPLINK_WAITING || r.node != first.node) {
+                continue;
+            }
+            char item[128];
+            int w = snprintf(item, sizeof(item), "%s{\"age\":%lu,\"v\":[\"%s\",\"%s\",\"%s\",\"%s\",\"%s\"]}",
+                             count ? "," : "", now - r.takenAt,
+                             r.value[0], r.value[1], r.value[2], r.value[3], r.value[4]);
+            if (w <= 0 || len + w + 1 >= room) {
+                break;
+            }
+            memcpy(json + len, item, w);
+            len += w;
+            taken[count++] = seq;
+        }
+        json[len++] = ']';
+
+        if (!finishPacket(0x32, n + len)) {    // PUBLISH, QoS 1
+            return false;
+        }
+
+        for (int i = 0; i < count; i++) {
+            UplinkRecord &r = m_queue[taken[i] % MQTT_QUEUE_SIZE];
+            r.state = UPLINK_SENT;
+            r.packetId = packetId;
+        }
+        Inflight &f = m_inflight[(m_inflightFirst + m_inflightCount) % MQTT_INFLIGHT];
+        f.packetId = packetId;
+        f.sentAt = now;
+        m_inflightCount++;
+        popAcked();
+        m_stats.publishes++;
+        return true;
+    }
+
+    uint16_t nextPacketId() {
+        if (++m_packetId == 0) {
+            m_packetId = 1;
+        }
+        return m_packetId;
+    }
+
+    // Reads whatever has arrived and handles complete packets
+    void receive() {
+        while (m_client.available() && m_rxLen < sizeof(m_rx)) {
+            m_rx[m_rxLen++] = m_client.read();
+
+            // Every packet we expect is two bytes of header plus at most two of body
+            if (m_rxLen < 2 || m_rxLen < 2u + m_rx[1]) {
+                continue;
+            }
+            m_lastRx = millis();
+            handlePacket(m_rx[0] & 0xF0, m_rx + 2, m_rx[1]);
+            m_rxLen = 0;
+            if (m_state == Disconnected) {
+                return;
+            }
+        }
+        if (m_rxLen == sizeof(m_rx)) {
+            fail();  // Something we never asked for
+        }
+    }
+
+    void handlePacket(uint8_t type, const uint8_t *body, uint8_t len) {
+        if (type == 0x20 && len == 2) {             // CONNACK
+            if (body[1] != 0) {
+                fail();
+                return;
+            }
+            m_state = Connected;
+            m_backoff = MQTT_BACKOFF_MIN_MS;
+            m_stats.connects++;
+        } else if (type == 0x40 && len == 2) {      // PUBACK
+            uint16_t id = (body[0] << 8) | body[1];
+            // Brokers acknowledge QoS 1 in the order they were published
+            if (!m_inflightCount || m_inflight[m_inflightFirst].packetId != id) {
+                fail();
+                return;
+            }
+            // Readings dropped from the queue while in flight aren't counted
+            for (uint32_t seq = m_head; seq != m_tail; seq++) {
+                UplinkRecord &r = m_queue[seq % MQTT_QUEUE_SIZE];
+                if (r.state == UPLINK_SENT && r.packetId == id) {
+                    r.state = UPLINK_ACKED;
+                    m_stats.acked++;
+                }
+            }
+            popAcked();
+            m_inflightFirst = (m_inflightFirst + 1) % MQTT_INFLIGHT;
+            m_inflightCount--;
+        }
+        // PINGRESP and anything else carries nothing we need
+    }
+
+    Client &m_client;
+    const char *m_host;
+    uint16_t m_port;
+    const char *m_clientId;
+    const char *m_prefix;
+
+    // Queue positions are free-running sequence numbers: [m_head, m_tail)
+    // is queued, and m_send is the oldest reading still waiting
+    UplinkRecord m_queue[MQTT_QUEUE_SIZE];
+    uint32_t m_head = 0;
+    uint32_t m_send = 0;
+    uint32_t m_tail = 0;
+
+    Inflight m_inflight[MQTT_INFLIGHT];
+    int m_inflightFirst = 0;
+    int m_inflightCount = 0;
+    uint16_t m_packetId = 0;
+
+    uint8_t m_tx[MQTT_PACKET_SIZE];
+    uint8_t m_rx[8];
+    size_t m_rxLen = 0;
+
+    State m_state = Disconnected;
+    unsigned long m_lastAttempt = 0;
+    unsigned long m_lastTx = 0;
+    unsigned long m_lastRx = 0;
+    unsigned long m_backoff = MQTT_BACKOFF_MIN_MS;
+    MqttStats m_stats = {};
+};
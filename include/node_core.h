@@ -0,0 +1,177 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        node_core.h
+//
+// Description:
+//
+//   The part of a node that decides what it knows: the current values,
+//   the table of every node's last reading, and the JSON messages that
+//   carry readings over the mesh.  Nothing here touches hardware, so
+//   main.cpp and the native simulation run the same code.
+//
+//   A Reading is one set of values on its way between tasks.  An empty
+//   value means the producer had nothing for that field (the PMS7003 has
+//   no temperature, say), and the current value is kept.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <ArduinoJson.h>
+#include <string.h>
+#include <node_table.h>
+
+// Mesh message keys, in value order
+static const char *const kReadingKeys[NODE_VALUES] = {
+    "PM 1.0", "PM 2.5", "PM 10.0", "Temperature", "Humidity"
+};
+
+struct Reading {
+    uint32_t node;
+    uint32_t time;  // millis() when produced
+    char value[NODE_VALUES][NODE_VALUE_LEN];
+    uint32_t heapFree;  // Sender's health fields; 0 if it sent none
+    uint32_t heapMin;
+    uint8_t heapFragPct;
+    uint32_t reportMs;  // Sender's time since its previous report; 0 if it sent none
+    uint32_t sampleMs;  // Sender's sensor period; 0 without a sensor
+    uint8_t flags;      // READING_*
+    uint16_t rawPm[3];  // What the sensor said, with READING_HAS_RAW
+};
+
+#define READING_CALIBRATED      0x01    // value[0..2] are corrected; rawPm holds the sensor's
+#define READING_NO_HUMIDITY     0x02    // Humidity model wanted but no humidity known
+#define READING_OUTLIER         0x04    // A value was a spike; see OUTLIER_REPLACE in main.cpp
+#define READING_SMOOTHED        0x08    // value[0..2] are smoothed; rawPm holds the sensor's
+#define READING_HAS_RAW         (READING_CALIBRATED | READING_OUTLIER | READING_SMOOTHED)
+
+static const char *const kRawKeys[3] = { "raw1", "raw25", "raw10" };
+
+// Copies text into a Reading field, truncating like NodeTable::setValue()
+inline void copyValue(char *field, const char *text) {
+    size_t len = strnlen(text, NODE_VALUE_LEN - 1);
+    memcpy(field, text, len);
+    field[len] = '\0';
+}
+
+// Fills doc with the message a node broadcasts: its values, then its
+// health fields if it has them
+inline void readingToJson(JsonDocument &doc, const Reading &r) {
+    doc.clear();
+    for (int i = 0; i < NODE_VALUES; i++) {
+        doc[kReadingKeys[i]] = r.value[i];
+    }
+    if (r.heapFree) {
+        doc["heap"] = r.heapFree;
+        doc["heapMin"] = r.heapMin;
+        doc["frag"] = r.heapFragPct;
+    }
+    if (r.reportMs) {
+        doc["report"] = r.reportMs;
+        doc["sample"] = r.sampleMs;
+    }
+    if (r.flags) {
+        doc["flags"] = r.flags;
+    }
+    if (r.flags & READING_HAS_RAW) {
+        for (int i = 0; i < 3; i++) {
+            doc[kRawKeys[i]] = r.rawPm[i];
+        }
+    }
+}
+
+// Reads a message parsed into doc.  Missing values come out as "null",
+// numbers as their JSON text.
+inline void readingFromJson(JsonDocument &doc, uint32_t from, uint32_t now, Reading &r) {
+    r.node = from;
+    r.time = now;
+    for (int i = 0; i < NODE_VALUES; i++) {
+        JsonVariant v = doc[kReadingKeys[i]];
+        if (v.is<const char *>()) {
+            copyValue(r.value[i], v.as<const char *>());
+        } else {
+            serializeJson(v, r.value[i], NODE_VALUE_LEN);
+        }
+    }
+    r.heapFree = doc["heap"].as<uint32_t>();  // 0 from nodes without health fields
+    r.heapMin = doc["heapMin"].as<uint32_t>();
+    r.heapFragPct = doc["frag"].as<uint8_t>();
+    r.reportMs = doc["report"].as<uint32_t>();
+    r.sampleMs = doc["sample"].as<uint32_t>();
+    r.flags = doc["flags"].as<uint8_t>();
+    for (int i = 0; i < 3; i++) {
+        r.rawPm[i] = doc[kRawKeys[i]].as<uint16_t>();
+    }
+}
+
+class NodeCore {
+public:
+    explicit NodeCore(NodeTable &table) : m_table(table) {
+        for (int i = 0; i < NODE_VALUES; i++) {
+            copyValue(m_values[i], "2");  // Placeholder until the first reading
+        }
+    }
+
+    // Takes the non-empty values of r as current and files them in the
+    // node table under r.node, with its health if it reported any.  The
+    // entry keeps the node's own earlier value where r has none, or
+    // "null" if it never sent one, never another node's.
+    NodeEntry *apply(const Reading &r, uint32_t now) {
+        NodeEntry *entry = m_table.update(r.node, now);
+        for (int i = 0; i < NODE_VALUES; i++) {
+            if (r.value[i][0]) {
+                copyValue(m_values[i], r.value[i]);
+                m_received |= 1u << i;
+                NodeTable::setValue(entry, i, r.value[i]);
+            } else if (!entry->value[i][0]) {
+                NodeTable::setValue(entry, i, "null");
+            }
+        }
+        if (r.heapFree) {
+            entry->heapFree = r.heapFree;
+            entry->heapFragPct = r.heapFragPct;
+        }
+        if (r.reportMs) {
+            entry->reportDs = rateTenths(r.reportMs);
+            entry->sampleDs = rateTenths(r.sampleMs);
+        }
+        entry->flags = r.flags;
+        memcpy(entry->rawPm, r.rawPm, sizeof(entry->rawPm));
+        return entry;
+    }
+
+    // node's own values as it broadcasts them, without health, rate or
+    // calibration fields: what its table entry holds, and "null" for a
+    // value it never measured, or all of them if it has no sensor.
+    // Other nodes' values stay in the table; sent under node they would
+    // credit it with their air.
+    void snapshot(uint32_t node, uint32_t now, Reading &out) const {
+        out.node = node;
+        out.time = now;
+        const NodeEntry *own = m_table.find(node);
+        for (int i = 0; i < NODE_VALUES; i++) {
+            copyValue(out.value[i], own && own->value[i][0] ? own->value[i] : "null");
+        }
+        out.heapFree = 0;
+        out.heapMin = 0;
+        out.heapFragPct = 0;
+        out.reportMs = 0;
+        out.sampleMs = 0;
+        out.flags = 0;
+        memset(out.rawPm, 0, sizeof(out.rawPm));
+    }
+
+    const char *value(int i) const { return m_values[i]; }
+
+    // The current value, or nullptr while value i is still the placeholder
+    const char *received(int i) const { return m_received & (1u << i) ? m_values[i] : nullptr; }
+    NodeTable &table() { return m_table; }
+
+private:
+    NodeTable &m_table;
+    char m_values[NODE_VALUES][NODE_VALUE_LEN];
+    uint8_t m_received = 0;     // Bit i once any reading has set value i
+};
@@ -0,0 +1,108 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        node_role.h
+//
+// Description:
+//
+//   What a node is built to do.  NODE_ROLE picks a set of features and
+//   everything else is compiled out, libraries included:
+//
+//     ROLE_FULL     the original build: OLED, LEDs, mesh; sensor and
+//                   uplinks off unless their flags are set
+//     ROLE_SENSOR   headless PMS7003 node: samples and broadcasts, keeps
+//                   no table of other nodes, no OLED or LEDs
+//     ROLE_DISPLAY  OLED and LEDs showing the mesh, no sensor
+//     ROLE_GATEWAY  collects the mesh for the web dashboard and MQTT,
+//                   no sensor, OLED or LEDs
+//
+//   Each feature flag can still be set on its own from build_flags; the
+//   role only supplies defaults.  Include this before anything that
+//   tests the flags (hal_esp32.h, node_table.h).
+//
+//   The flags are macros because whole libraries hang off them.  The
+//   kHas* constants carry the same values for code that compiles either
+//   way, where a plain if on a constant is enough.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+#define ROLE_FULL       0
+#define ROLE_SENSOR     1
+#define ROLE_DISPLAY    2
+#define ROLE_GATEWAY    3
+
+#ifndef NODE_ROLE
+#define NODE_ROLE ROLE_FULL
+#endif
+
+//                      sensor  oled  leds  receive  web  mqtt
+#if NODE_ROLE == ROLE_FULL
+#define ROLE_FEATURES(X)  X(0,  1,    1,    1,       0,   0)
+#elif NODE_ROLE == ROLE_SENSOR
+#define ROLE_FEATURES(X)  X(1,  0,    0,    0,       0,   0)
+#elif NODE_ROLE == ROLE_DISPLAY
+#define ROLE_FEATURES(X)  X(0,  1,    1,    1,       0,   0)
+#elif NODE_ROLE == ROLE_GATEWAY
+#define ROLE_FEATURES(X)  X(0,  0,    0,    1,       1,   1)
+#else
+#error "NODE_ROLE must be ROLE_FULL, ROLE_SENSOR, ROLE_DISPLAY or ROLE_GATEWAY"
+#endif
+
+#define ROLE_PICK_SENSOR(s, o, l, r, w, m)  s
+#define ROLE_PICK_OLED(s, o, l, r, w, m)    o
+#define ROLE_PICK_LEDS(s, o, l, r, w, m)    l
+#define ROLE_PICK_RECEIVE(s, o, l, r, w, m) r
+#define ROLE_PICK_WEB(s, o, l, r, w, m)     w
+#define ROLE_PICK_MQTT(s, o, l, r, w, m)    m
+
+// PMS7003 on Serial2, sampled by acquireTask
+#ifndef PMS_SENSOR
+#define PMS_SENSOR ROLE_FEATURES(ROLE_PICK_SENSOR)
+#endif
+// SSD1306 through U8g2: the pages, trend history and PRG button
+#ifndef OLED_DISPLAY
+#define OLED_DISPLAY ROLE_FEATURES(ROLE_PICK_OLED)
+#endif
+// WS2812B status strip through FastLED
+#ifndef STATUS_LEDS
+#define STATUS_LEDS ROLE_FEATURES(ROLE_PICK_LEDS)
+#endif
+// Parse other nodes' readings into the node table.  Without it the
+// node still broadcasts, and the table only ever holds itself.
+#ifndef MESH_RECEIVE
+#define MESH_RECEIVE ROLE_FEATURES(ROLE_PICK_RECEIVE)
+#endif
+#ifndef WEB_DASHBOARD
+#define WEB_DASHBOARD ROLE_FEATURES(ROLE_PICK_WEB)
+#endif
+#ifndef MQTT_UPLINK
+#define MQTT_UPLINK ROLE_FEATURES(ROLE_PICK_MQTT)
+#endif
+
+// A node that keeps nobody else's readings needs a table of one
+#if !MESH_RECEIVE && !defined(NODE_TABLE_SIZE)
+#define NODE_TABLE_SIZE 1
+#endif
+
+constexpr int kNodeRole = NODE_ROLE;
+constexpr bool kHasSensor = PMS_SENSOR;
+constexpr bool kHasOled = OLED_DISPLAY;
+constexpr bool kHasLeds = STATUS_LEDS;
+constexpr bool kMeshReceive = MESH_RECEIVE;
+constexpr bool kHasWeb = WEB_DASHBOARD;
+constexpr bool kHasMqtt = MQTT_UPLINK;
+
+static const char *const kRoleNames[] = { "full", "sensor", "display", "gateway" };
+
+// Bit per feature, in the order above, for the boot log and /metrics
+constexpr uint32_t kRoleFeatureMask = (kHasSensor ? 1u : 0) | (kHasOled ? 2u : 0) | (kHasLeds ? 4u : 0) |
+                                      (kMeshReceive ? 8u : 0) | (kHasWeb ? 16u : 0) | (kHasMqtt ? 32u : 0);
+
+static_assert(kNodeRole != ROLE_SENSOR || kHasSensor, "A sensor node without PMS_SENSOR has nothing to send");
+static_assert(!kHasWeb || kMeshReceive, "The dashboard shows the node table, which needs MESH_RECEIVE");
@@ -0,0 +1,99 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        node_table.h
+//
+// Description:
+//
+//   Fixed-size table of the latest reading from every node heard on the
+//   mesh.  Entries live in a static array so looking up or walking the
+//   table never allocates; when it is full the node heard from least
+//   recently is replaced.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef NODE_TABLE_SIZE
+#define NODE_TABLE_SIZE 200     // Nodes tracked at once
+#endif
+#define NODE_VALUE_LEN  12      // Chars kept per reading value, including NUL
+#define NODE_VALUES     5       // pm1.0, pm2.5, pm10.0, temp, hum
+
+struct NodeEntry {
+    uint32_t nodeId;
+    uint32_t lastSeen;          // millis() of the last update
+    uint32_t messages;          // Readings received from this node
+    uint32_t heapFree;          // From the node's health fields; 0 if it sends none
+    uint16_t reportDs;          // The node's report interval and sensor period as
+    uint16_t sampleDs;          // it last sent them, tenths of a second; 0 if none
+    uint16_t rawPm[3];          // The sensor's own pm1.0, pm2.5, pm10.0, with READING_HAS_RAW
+    uint8_t heapFragPct;
+    uint8_t flags;              // READING_* of its last reading
+    char value[NODE_VALUES][NODE_VALUE_LEN];
+};
+
+// A rate in ms as NodeEntry keeps it: tenths of a second, rounded, up to
+// about 109 minutes
+inline uint16_t rateTenths(uint32_t ms) {
+    uint32_t ds = ms / 100 + (ms % 100 >= 50);
+    return ds > UINT16_MAX ? UINT16_MAX : ds;
+}
+
+class NodeTable {
+public:
+    // Returns the entry for nodeId, claiming a slot for it if it is new
+    NodeEntry *update(uint32_t nodeId, uint32_t now) {
+        NodeEntry *entry = find(nodeId);
+        if (!entry) {
+            if (m_count < NODE_TABLE_SIZE) {
+                entry = &m_entries[m_count++];
+            } else {
+                entry = &m_entries[0];
+                for (int i = 1; i < m_count; i++) {
+                    if ((int32_t)(m_entries[i].lastSeen - entry->lastSeen) < 0) {
+                        entry = &m_entries[i];
+                    }
+                }
+                m_evictions++;
+            }
+            memset(entry, 0, sizeof(*entry));
+            entry->nodeId = nodeId;
+        }
+        entry->lastSeen = now;
+        entry->messages++;
+        return entry;
+    }
+
+    // Copies one value into the entry, truncating if it is too long
+    static void setValue(NodeEntry *entry, int index, const char *text) {
+        size_t len = strnlen(text, NODE_VALUE_LEN - 1);
+        memcpy(entry->value[index], text, len);
+        entry->value[index][len] = '\0';
+    }
+
+    NodeEntry *find(uint32_t nodeId) {
+        for (int i = 0; i < m_count; i++) {
+            if (m_entries[i].nodeId == nodeId) {
+                return &m_entries[i];
+            }
+        }
+        return nullptr;
+    }
+
+    const NodeEntry *find(uint32_t nodeId) const { return const_cast<NodeTable *>(this)->find(nodeId); }
+
+    int size() const { return m_count; }
+    const NodeEntry &at(int i) const { return m_entries[i]; }
+    uint32_t evictions() const { return m_evictions; }
+
+private:
+    NodeEntry m_entries[NODE_TABLE_SIZE];
+    int m_count = 0;
+    uint32_t m_evictions = 0;
+};
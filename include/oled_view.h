@@ -0,0 +1,92 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        oled_view.h
+//
+// Description:
+//
+//   Sends frames drawn in U8g2's full buffer to the OLED, but only the
+//   8-pixel tile rows that differ from what the panel already shows.  A
+//   shadow copy of the last frame sent is compared row by row and each
+//   run of changed rows goes out with one updateDisplayArea(), instead
+//   of resending the whole 1 KB frame with sendBuffer().  The panel is
+//   reached through HalDisplay, so the same code runs against a fake.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <string.h>
+#include <framebuffer.h>
+#include <hal.h>
+
+struct DisplayStats {
+    uint32_t renders;           // present() calls that sent anything
+    uint32_t skipped;           // present() calls with nothing changed
+    uint32_t bytesLast;         // Bytes pushed over I2C by the last render
+    uint64_t bytesTotal;
+    uint32_t usLast;            // Time spent in the last render
+    uint32_t usMax;
+    uint64_t usTotal;
+};
+
+class OledView {
+public:
+    OledView(HalDisplay &display, HalClock &clock) : m_display(display), m_clock(clock) {}
+
+    // Call after the panel is initialised; the first present() sends every row
+    void begin() {
+        m_display.clearBuffer();
+        memset(m_shown, 0xFF, sizeof(m_shown));
+    }
+
+    // The buffer pages draw into
+    FrameBuffer frame() { return FrameBuffer(m_display.buffer()); }
+
+    // Starts timing a frame; call before drawing into frame()
+    void beginFrame() { m_start = m_clock.micros(); }
+
+    // Sends the tile rows that changed since the last present()
+    void present() {
+        const uint8_t *buf = m_display.buffer();
+        uint32_t bytes = 0;
+        for (int r = 0; r < FB_ROWS;) {
+            if (memcmp(buf + r * FB_WIDTH, m_shown + r * FB_WIDTH, FB_WIDTH) == 0) {
+                r++;
+                continue;
+            }
+            int first = r;
+            while (r < FB_ROWS && memcmp(buf + r * FB_WIDTH, m_shown + r * FB_WIDTH, FB_WIDTH) != 0) {
+                r++;
+            }
+            m_display.updateArea(0, first, FB_WIDTH / 8, r - first);
+            memcpy(m_shown + first * FB_WIDTH, buf + first * FB_WIDTH, (r - first) * FB_WIDTH);
+            bytes += (r - first) * FB_WIDTH;
+        }
+
+        uint32_t elapsed = m_clock.micros() - m_start;
+        if (!bytes) {
+            m_stats.skipped++;
+            return;
+        }
+        m_stats.renders++;
+        m_stats.bytesLast = bytes;
+        m_stats.bytesTotal += bytes;
+        m_stats.usLast = elapsed;
+        m_stats.usTotal += elapsed;
+        if (elapsed > m_stats.usMax) {
+            m_stats.usMax = elapsed;
+        }
+    }
+
+    const DisplayStats &stats() const { return m_stats; }
+
+private:
+    HalDisplay &m_display;
+    HalClock &m_clock;
+    uint8_t m_shown[FB_BYTES];  // What the panel currently shows
+    uint32_t m_start = 0;
+    DisplayStats m_stats = {};
+};
@@ -0,0 +1,136 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        openmetrics.h
+//
+// Description:
+//
+//   Writer for the OpenMetrics text exposition format.  Lines are built
+//   in one fixed buffer and handed to a sink whenever it fills, so a
+//   scrape of any size costs no heap.  Has no Arduino dependencies.
+//
+//   Label values and help text are escaped as the format requires:
+//   backslash, double quote (label values only) and newline.  Label
+//   values and help text longer than their buffers are cut short.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define OPENMETRICS_BUFFER 512
+#define OPENMETRICS_LABEL_MAX 64    // Escaped label value, with the NUL
+#define OPENMETRICS_HELP_MAX 128    // Escaped help text, with the NUL
+#define OPENMETRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+class MetricsWriter {
+public:
+    typedef void (*Sink)(const char *data, size_t len);
+
+    explicit MetricsWriter(Sink sink) : m_sink(sink) {}
+
+    // Starts a metric family; type is "gauge", "counter", "histogram" or "info"
+    void family(const char *name, const char *type, const char *help) {
+        char escaped[OPENMETRICS_HELP_MAX];
+        escape(help, escaped, sizeof(escaped), false);
+        line("# TYPE %s %s\n", name, type);
+        line("# HELP %s %s\n", name, escaped);
+    }
+
+    // Unlabelled sample.  Counters pass "_total" as the suffix.
+    void sample(const char *name, const char *suffix, double value) {
+        line("%s%s %.10g\n", name, suffix, value);
+    }
+
+    // Sample with a single node="<id>" label
+    void nodeSample(const char *name, uint32_t node, double value) {
+        line("%s{node=\"%u\"} %.10g\n", name, (unsigned)node, value);
+    }
+
+    // Sample with one string-valued label
+    void labelSample(const char *name, const char *label, const char *value, double sample) {
+        char escaped[OPENMETRICS_LABEL_MAX];
+        escape(value, escaped, sizeof(escaped), true);
+        line("%s{%s=\"%s\"} %.10g\n", name, label, escaped, sample);
+    }
+
+    // One cumulative histogram bucket: the samples at or below le, under
+    // one string-valued label.  le < 0 is the +Inf bucket.
+    void bucket(const char *name, const char *label, const char *value, double le, uint64_t cumulative) {
+        char escaped[OPENMETRICS_LABEL_MAX];
+        escape(value, escaped, sizeof(escaped), true);
+        if (le < 0) {
+            line("%s_bucket{%s=\"%s\",le=\"+Inf\"} %llu\n", name, label, escaped, (unsigned long long)cumulative);
+        } else {
+            line("%s_bucket{%s=\"%s\",le=\"%.6g\"} %llu\n", name, label, escaped, le, (unsigned long long)cumulative);
+        }
+    }
+
+    // Closes a labelled histogram after its buckets: the +Inf bucket,
+    // _count and _sum
+    void histogramEnd(const char *name, const char *label, const char *value, uint64_t count, double sum) {
+        char escaped[OPENMETRICS_LABEL_MAX];
+        escape(value, escaped, sizeof(escaped), true);
+        bucket(name, label, value, -1, count);
+        line("%s_count{%s=\"%s\"} %llu\n", name, label, escaped, (unsigned long long)count);
+        line("%s_sum{%s=\"%s\"} %.9g\n", name, label, escaped, sum);
+    }
+
+    // Writes a preformatted sample line for shapes the helpers don't cover
+    template <typename... Args>
+    void line(const char *format, Args... args) {
+        int n = snprintf(m_buffer + m_len, sizeof(m_buffer) - m_len, format, args...);
+        if (n >= (int)(sizeof(m_buffer) - m_len)) {
+            flush();
+            n = snprintf(m_buffer, sizeof(m_buffer), format, args...);
+            if (n >= (int)sizeof(m_buffer)) {
+                n = 0;  // A single line longer than the buffer is dropped
+            }
+        }
+        if (n > 0) {
+            m_len += n;
+        }
+    }
+
+    // Terminates the exposition and pushes out whatever is buffered
+    void finish() {
+        line("# EOF\n");
+        flush();
+    }
+
+    // Copies text into out with \\, \n and, for label values, \" escaped;
+    // stops early rather than split an escape or overrun out
+    static void escape(const char *text, char *out, size_t size, bool quotes) {
+        size_t n = 0;
+        for (; *text; text++) {
+            char c = *text;
+            bool special = c == '\\' || c == '\n' || (quotes && c == '"');
+            if (n + (special ? 2 : 1) >= size) {
+                break;
+            }
+            if (special) {
+                out[n++] = '\\';
+                c = c == '\n' ? 'n' : c;
+            }
+            out[n++] = c;
+        }
+        out[n] = '\0';
+    }
+
+private:
+    void flush() {
+        if (m_len) {
+            m_sink(m_buffer, m_len);
+            m_len = 0;
+        }
+    }
+
+    Sink m_sink;
+    char m_buffer[OPENMETRICS_BUFFER];
+    size_t m_len = 0;
+};
@@ -0,0 +1,129 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        outlier_filter.h
+//
+// Description:
+//
+//   A streaming Hampel identifier for one sensor channel.  Each sample
+//   joins a window of the last W; it is an outlier if it lies further
+//   from the window's median than threshold x sigma, with sigma
+//   estimated robustly from the window's interquartile range (IQR /
+//   1.349 for normal noise, the same estimate 1.4826 x MAD gives).  In
+//   clean, flat air the spread can be zero, so the limit never drops
+//   below minDev.
+//
+//   The window is kept twice: in arrival order, to know which sample
+//   leaves, and sorted, so the median and quartiles are plain lookups.
+//   Binary search finds where a sample goes and where the leaving one
+//   is, but keeping the array sorted costs two memmoves of up to W
+//   values per sample, so a push is O(W).  For the small windows this
+//   is meant for (7 by default, at most 255) that is a few dozen bytes
+//   moved, cheaper than a tree or skip list and their per-slot links.
+//   Memory is fixed at 4 bytes per window slot.
+//
+//   Outliers stay in the window, so a real step (smoke arriving) is
+//   accepted once it reaches the upper quartile, W / 4 + 1 samples in
+//   (two, for 7); until then its samples are flagged, which is the price
+//   of rejecting single glitches.  No sample is flagged until the window
+//   is full.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef OUTLIER_WINDOW
+#define OUTLIER_WINDOW      7       // Samples; odd
+#endif
+#ifndef OUTLIER_THRESHOLD
+#define OUTLIER_THRESHOLD   30      // Tenths of sigma
+#endif
+#ifndef OUTLIER_MIN_DEV
+#define OUTLIER_MIN_DEV     5       // ug/m3
+#endif
+
+template <int W>
+class HampelFilter {
+    static_assert(W >= 3 && W % 2 == 1 && W < 256, "The window needs an odd number of samples, up to 255");
+
+public:
+    explicit HampelFilter(uint16_t thresholdTenths = OUTLIER_THRESHOLD, uint16_t minDev = OUTLIER_MIN_DEV)
+        : m_threshold(thresholdTenths), m_minDev(minDev) {}
+
+    // Adds v to the window; true if it is an outlier against it
+    bool push(uint16_t v) {
+        if (m_count == W) {
+            remove(m_ring[m_head]);
+        } else {
+            m_count++;
+        }
+        m_ring[m_head] = v;
+        m_head = m_head + 1 < W ? m_head + 1 : 0;
+        insert(v);
+        m_samples++;
+        if (m_count < W) {
+            return false;
+        }
+        uint16_t med = median();
+        uint32_t dev = v > med ? v - med : med - v;
+        uint32_t iqr = m_sorted[3 * W / 4] - m_sorted[W / 4];
+        // threshold / 10 x IQR / 1.349, in 64 bits: 32 overflow for a
+        // wide window spread once the threshold is past about 6.5 sigma
+        uint64_t limit = (uint64_t)iqr * m_threshold * 1000 / 13490;
+        if (dev <= (limit > m_minDev ? limit : m_minDev)) {
+            return false;
+        }
+        m_rejected++;
+        return true;
+    }
+
+    // Of the window as it stands; what an outlier is replaced with
+    uint16_t median() const { return m_sorted[m_count / 2]; }
+
+    bool full() const { return m_count == W; }
+    uint32_t samples() const { return m_samples; }
+    uint32_t rejected() const { return m_rejected; }
+
+private:
+    // First slot of m_sorted not below v
+    int lowerBound(uint16_t v) const {
+        int lo = 0, hi = m_sortedCount;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (m_sorted[mid] < v) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    void insert(uint16_t v) {
+        int at = lowerBound(v);
+        memmove(&m_sorted[at + 1], &m_sorted[at], (m_sortedCount - at) * sizeof(m_sorted[0]));
+        m_sorted[at] = v;
+        m_sortedCount++;
+    }
+
+    void remove(uint16_t v) {
+        int at = lowerBound(v);  // Any copy of v will do
+        memmove(&m_sorted[at], &m_sorted[at + 1], (m_sortedCount - at - 1) * sizeof(m_sorted[0]));
+        m_sortedCount--;
+    }
+
+    uint16_t m_ring[W];
+    uint16_t m_sorted[W];
+    uint8_t m_head = 0;
+    uint8_t m_count = 0;
+    uint8_t m_sortedCount = 0;
+    uint16_t m_threshold;
+    uint16_t m_minDev;
+    uint32_t m_samples = 0;
+    uint32_t m_rejected = 0;
+};
@@ -0,0 +1,121 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        pms7003.h
+//
+// Description:
+//
+//   Plantower PMS7003 over a UART, without blocking.  Commands are
+//   7 bytes: 42 4D cmd dataH dataL sumH sumL.  The sensor answers with
+//   frames of 42 4D lenH lenL, then len bytes ending in a 16-bit sum of
+//   everything before it: len 28 for readings, len 4 for command acks.
+//
+//   In passive mode the sensor only sends a reading when asked with
+//   requestRead(), so the host decides the sample rate.  poll() consumes
+//   whatever bytes have arrived, resynchronising on the 42 4D header,
+//   and returns true once a whole reading has been checked.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <hal.h>
+
+#define PMS_CMD_READ        0xE2    // Passive mode: send one reading
+#define PMS_CMD_MODE        0xE1    // data 0 = passive, 1 = active
+#define PMS_CMD_SLEEP       0xE4    // data 0 = sleep, 1 = wake
+#define PMS_FRAME_MAX       32      // Header, length and 28 bytes of reading
+#define PMS_READING_LEN     28
+
+struct PmsReading {
+    uint16_t pm1_0;     // Atmospheric environment, ug/m3
+    uint16_t pm2_5;
+    uint16_t pm10_0;
+};
+
+class Pms7003 {
+public:
+    explicit Pms7003(HalSerial &port) : m_port(port) {}
+
+    void setPassive(bool passive) { command(PMS_CMD_MODE, passive ? 0 : 1); }
+    void requestRead() { command(PMS_CMD_READ, 0); }
+    void sleep(bool asleep) { command(PMS_CMD_SLEEP, asleep ? 0 : 1); }
+
+    // Consumes buffered bytes; true when a valid reading was completed
+    bool poll() {
+        while (m_port.available() > 0) {
+            uint8_t b = m_port.read();
+            if (m_len == 0 && b != 0x42) {
+                continue;  // Hunting for the first header byte
+            }
+            if (m_len == 1 && b != 0x4D) {
+                m_len = b == 0x42 ? 1 : 0;
+                continue;
+            }
+            m_frame[m_len++] = b;
+            if (m_len == 4) {
+                uint16_t len = (m_frame[2] << 8) | m_frame[3];
+                if (len < 4 || len > PMS_FRAME_MAX - 4) {
+                    m_badFrames++;
+                    m_len = 0;
+                    continue;
+                }
+                m_expect = 4 + len;
+            }
+            if (m_len >= 4 && m_len == m_expect) {
+                m_len = 0;
+                if (finishFrame()) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    const PmsReading &reading() const { return m_reading; }
+    uint32_t frames() const { return m_frames; }
+    uint32_t badFrames() const { return m_badFrames; }
+
+private:
+    void command(uint8_t cmd, uint16_t data) {
+        uint8_t out[7] = { 0x42, 0x4D, cmd, (uint8_t)(data >> 8), (uint8_t)data, 0, 0 };
+        uint16_t sum = 0;
+        for (int i = 0; i < 5; i++) {
+            sum += out[i];
+        }
+        out[5] = sum >> 8;
+        out[6] = sum;
+        m_port.write(out, sizeof(out));
+    }
+
+    // Checks the sum; only readings count as frames, acks are dropped
+    bool finishFrame() {
+        uint16_t sum = 0;
+        for (int i = 0; i < m_expect - 2; i++) {
+            sum += m_frame[i];
+        }
+        uint16_t frameSum = (m_frame[m_expect - 2] << 8) | m_frame[m_expect - 1];
+        if (sum != frameSum) {
+            m_badFrames++;
+            return false;
+        }
+        if (m_expect != 4 + PMS_READING_LEN) {
+            return false;
+        }
+        m_reading.pm1_0 = (m_frame[10] << 8) | m_frame[11];
+        m_reading.pm2_5 = (m_frame[12] << 8) | m_frame[13];
+        m_reading.pm10_0 = (m_frame[14] << 8) | m_frame[15];
+        m_frames++;
+        return true;
+    }
+
+    HalSerial &m_port;
+    uint8_t m_frame[PMS_FRAME_MAX];
+    int m_len = 0;
+    int m_expect = 0;
+    PmsReading m_reading = {};
+    uint32_t m_frames = 0;
+    uint32_t m_badFrames = 0;
+};
@@ -0,0 +1,186 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        serial_frame.h
+//
+// Description:
+//
+//   Binary framing for the gateway -> collector serial bridge.  Each frame
+//   is COBS encoded and delimited by 0x00 on both sides, so a reader can
+//   pick up mid-stream or skip stray debug text and still lock onto the
+//   next frame.  Inside the COBS block:
+//
+//     type (1) | payload (n) | CRC16-CCITT of type+payload (2, LE)
+//
+//   Shared by the firmware and tools/collector; no Arduino dependencies.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <fixed_point.h>
+
+#define FRAME_TYPE_READING  0x01
+#define FRAME_MAX_PAYLOAD   48
+#define FRAME_MAX_RAW       (1 + FRAME_MAX_PAYLOAD + 2)
+#define FRAME_MAX_ENCODED   (FRAME_MAX_RAW + FRAME_MAX_RAW / 254 + 1 + 2)
+
+// One mesh reading on the wire: values are fixed point, hundredths
+struct WireReading {
+    uint32_t node;
+    uint32_t time;              // Sender's millis() or mesh time
+    int32_t value[5];           // pm1.0, pm2.5, pm10.0, temp, hum
+};
+#define WIRE_READING_SIZE 28
+
+inline uint16_t crc16Ccitt(const uint8_t *data, size_t len, uint16_t crc = 0xFFFF) {
+    static const uint16_t nibble[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    };
+    for (size_t i = 0; i < len; i++) {
+        crc = (crc << 4) ^ nibble[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ nibble[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+inline void putLe32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+inline uint32_t getLe32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Parses "12", "-3.5" or "45.678" into hundredths, rounded, without floats
+inline int32_t hundredthsFromText(const char *text) {
+    return fixedSaturate(Fixed16::parse(text).toDecimal(2));
+}
+
+// Encodes type+payload into out, delimiters included.  Returns bytes written.
+inline size_t encodeFrame(uint8_t type, const uint8_t *payload, size_t len, uint8_t *out) {
+    uint8_t raw[FRAME_MAX_RAW];
+    raw[0] = type;
+    memcpy(raw + 1, payload, len);
+    uint16_t crc = crc16Ccitt(raw, len + 1);
+    raw[len + 1] = crc & 0xFF;
+    raw[len + 2] = crc >> 8;
+    size_t rawLen = len + 3;
+
+    size_t o = 0;
+    out[o++] = 0x00;
+    size_t code = o++;
+    uint8_t run = 1;
+    for (size_t i = 0; i < rawLen; i++) {
+        if (raw[i] == 0) {
+            out[code] = run;
+            code = o++;
+            run = 1;
+        } else {
+            out[o++] = raw[i];
+            if (++run == 0xFF) {
+                out[code] = run;
+                code = o++;
+                run = 1;
+            }
+        }
+    }
+    out[code] = run;
+    out[o++] = 0x00;
+    return o;
+}
+
+inline size_t encodeReading(const WireReading &r, uint8_t *out) {
+    uint8_t payload[WIRE_READING_SIZE];
+    putLe32(payload, r.node);
+    putLe32(payload + 4, r.time);
+    for (int i = 0; i < 5; i++) {
+        putLe32(payload + 8 + 4 * i, (uint32_t)r.value[i]);
+    }
+    return encodeFrame(FRAME_TYPE_READING, payload, sizeof(payload), out);
+}
+
+inline bool decodeReading(const uint8_t *payload, size_t len, WireReading &r) {
+    if (len != WIRE_READING_SIZE) {
+        return false;
+    }
+    r.node = getLe32(payload);
+    r.time = getLe32(payload + 4);
+    for (int i = 0; i < 5; i++) {
+        r.value[i] = (int32_t)getLe32(payload + 8 + 4 * i);
+    }
+    return true;
+}
+
+// Byte-at-a-time frame decoder with fixed memory
+class FrameDecoder {
+public:
+    // Feeds one byte; returns true when a complete, valid frame is ready
+    bool feed(uint8_t b) {
+        if (b != 0x00) {
+            if (m_len < sizeof(m_buf)) {
+                m_buf[m_len++] = b;
+            } else {
+                m_overflow = true;
+            }
+            return false;
+        }
+        size_t len = m_len;
+        bool overflow = m_overflow;
+        m_len = 0;
+        m_overflow = false;
+        if (len == 0) {
+            return false;  // Back-to-back delimiters
+        }
+        if (overflow || !unstuff(len)) {
+            m_errors++;
+            return false;
+        }
+        return true;
+    }
+
+    uint8_t type() const { return m_raw[0]; }
+    const uint8_t *payload() const { return m_raw + 1; }
+    size_t payloadLen() const { return m_rawLen - 3; }
+    uint32_t errors() const { return m_errors; }
+
+private:
+    bool unstuff(size_t len) {
+        size_t o = 0;
+        size_t i = 0;
+        while (i < len) {
+            uint8_t code = m_buf[i++];
+            if (code == 0 || i + code - 1 > len) {
+                return false;
+            }
+            for (uint8_t k = 1; k < code; k++) {
+                m_raw[o++] = m_buf[i++];
+            }
+            if (code < 0xFF && i < len) {
+                m_raw[o++] = 0x00;
+            }
+        }
+        if (o < 3) {
+            return false;
+        }
+        uint16_t crc = m_raw[o - 2] | (m_raw[o - 1] << 8);
+        if (crc16Ccitt(m_raw, o - 2) != crc) {
+            return false;
+        }
+        m_rawLen = o;
+        return true;
+    }
+
+    uint8_t m_buf[FRAME_MAX_ENCODED];
+    uint8_t m_raw[FRAME_MAX_ENCODED];
+    size_t m_len = 0;
+    size_t m_rawLen = 0;
+    bool m_overflow = false;
+    uint32_t m_errors = 0;
+};
@@ -0,0 +1,228 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        sim_node.h
+//
+// Description:
+//
+//   One node of a host simulation, on the hal_native.h fakes.  It runs
+//   the firmware's pipeline: Acquisition polls a VirtualPms7003, the
+//   node's own values are checked for spikes, calibrated and smoothed
+//   (include/conditioning.h, every stage on as in a default build), each
+//   reading goes through NodeCore to the LEDs and the OLED pages, and
+//   the current values go out as JSON on the mesh every 10 s, as
+//   processReadings(), taskRenderDisplay and taskSendMessage do in
+//   main.cpp.  Messages from other nodes are parsed and filed the same
+//   way receivedCallback() does.
+//
+//   digest() folds every broadcast, every frame sent to the panel and
+//   every LED update into one FNV-1a hash, so two runs can be compared
+//   by a single number.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <hal_native.h>
+#include <virtual_pms.h>
+#include <node_core.h>
+#include <acquisition.h>
+#include <conditioning.h>
+#include <oled_view.h>
+#include <ui_pages.h>
+#include <led_status.h>
+
+#include <algorithm>
+#include <stdio.h>
+
+#define SIM_STEP_MS         10
+#define SIM_BROADCAST_MS    10000   // As taskSendMessage
+#define SIM_RENDER_MS       200     // As taskRenderDisplay
+#define SIM_SAMPLE_MS       2000
+#define SIM_PAGE_MS         5000    // As UI_PAGE_MS
+#define SIM_TREND_MS        10000   // As the trend history push
+#define SIM_NODE_BASE       1000    // Node ids are SIM_NODE_BASE + 1, 2, ...
+
+class SimNode {
+public:
+    SimNode(FakeMeshBus &bus, FakeClock &clock, uint32_t id, PmsProfile &profile,
+            const VirtualPmsConfig &sensorConfig = VirtualPmsConfig())
+        : m_clock(clock), m_mesh(bus, id), m_sensor(clock, profile, sensorConfig), m_core(m_table),
+          m_pms(m_sensor), m_acquisition(m_pms, SIM_SAMPLE_MS), m_view(m_display, clock) {}
+
+    void begin() {
+        m_mesh.onReceive(onMessage, this);
+        m_view.begin();
+        m_acquisition.begin(m_clock.millis());
+    }
+
+    // Broadcasts are also written to log, one line each, if it is set
+    void setLog(FILE *log) { m_log = log; }
+
+    void step(uint32_t nowMs) {
+        if (m_acquisition.step(nowMs, m_clock.micros())) {
+            const PmsReading &pm = m_acquisition.reading();
+            Reading r = {};
+            r.node = m_mesh.nodeId();
+            r.time = nowMs;
+            r.rawPm[0] = pm.pm1_0;
+            r.rawPm[1] = pm.pm2_5;
+            r.rawPm[2] = pm.pm10_0;
+            m_conditioner.apply(r, nowMs);
+            apply(r, nowMs);
+        }
+
+        m_mesh.update();
+
+        if (nowMs - m_lastBroadcast >= SIM_BROADCAST_MS) {
+            m_lastBroadcast = nowMs;
+            Reading out;
+            m_core.snapshot(m_mesh.nodeId(), nowMs, out);
+            readingToJson(m_json, out);
+            char msg[256];
+            size_t len = serializeJson(m_json, msg, sizeof(msg));
+            m_mesh.broadcast(msg);
+            mix(msg, len);
+            if (m_log) {
+                fprintf(m_log, "%u %u %s\n", nowMs, m_mesh.nodeId(), msg);
+            }
+        }
+
+        if (m_leds.tick(nowMs)) {
+            m_strip.show(m_leds.pixels(), NODE_VALUES);
+            mix(m_leds.pixels(), NODE_VALUES * sizeof(LedColor));
+        }
+        if (nowMs % SIM_TREND_MS == 0) {
+            sampleTrend();
+        }
+        if (m_dirty && nowMs - m_lastRender >= SIM_RENDER_MS) {
+            m_dirty = false;
+            m_lastRender = nowMs;
+            render(nowMs);
+        }
+    }
+
+    // How long until step() has anything to do, like the firmware's
+    // scheduler sleeping between tasks.  Runs that skip ahead by this
+    // instead of stepping every SIM_STEP_MS give the same readings with
+    // far fewer steps.
+    uint32_t msUntilNext(uint32_t nowMs) const {
+        if (m_mesh.pending() || m_leds.animating()) {
+            return 0;
+        }
+        uint32_t wait = m_acquisition.msUntilNext(nowMs);
+        wait = std::min(wait, m_lastBroadcast + SIM_BROADCAST_MS - nowMs);
+        wait = std::min(wait, SIM_TREND_MS - nowMs % SIM_TREND_MS);
+        if (m_dirty) {
+            uint32_t since = nowMs - m_lastRender;
+            wait = std::min(wait, since >= SIM_RENDER_MS ? 0 : SIM_RENDER_MS - since);
+        }
+        return wait;
+    }
+
+    uint32_t nodeId() { return m_mesh.nodeId(); }
+    const NodeTable &table() const { return m_table; }
+    const NodeCore &core() const { return m_core; }
+    const SampleStats &sampleStats() const { return m_acquisition.stats(); }
+    const Pms7003 &pms() const { return m_pms; }
+    const VirtualPms7003 &sensor() const { return m_sensor; }
+    const DisplayStats &displayStats() const { return m_view.stats(); }
+    const FakeDisplay &display() const { return m_display; }
+    uint32_t sent() const { return m_mesh.sent(); }
+    uint32_t received() const { return m_received; }
+    uint32_t parseErrors() const { return m_parseErrors; }
+    uint32_t ledShows() const { return m_strip.shows(); }
+    uint32_t digest() const { return m_digest; }
+
+private:
+    // Everything processReadings() does after a reading lands, minus uplinks
+    void apply(const Reading &r, uint32_t nowMs) {
+        m_core.apply(r, nowMs);
+        const char *values[NODE_VALUES];
+        for (int i = 0; i < NODE_VALUES; i++) {
+            values[i] = m_core.received(i);
+        }
+        ledShowReadings(m_leds, values);
+        m_dirty = true;
+    }
+
+    // As sampleHistory(): the trend is this node's own readings
+    void sampleTrend() {
+        const NodeEntry *e = m_table.find(m_mesh.nodeId());
+        if (!e) {
+            return;
+        }
+        for (int i = 0; i < 3; i++) {
+            m_trend[i].push(tenthsFromText(e->value[i]));
+        }
+    }
+
+    static void onMessage(void *context, uint32_t from, const char *msg, size_t len) {
+        SimNode &node = *(SimNode *)context;
+        uint32_t now = node.m_clock.millis();
+        if (deserializeJson(node.m_json, msg, len)) {
+            node.m_parseErrors++;
+            return;
+        }
+        Reading r;
+        readingFromJson(node.m_json, from, now, r);
+        node.m_conditioner.calibrator().humidity(r.value[4], now);  // As processReadings()
+        node.apply(r, now);
+        node.m_received++;
+    }
+
+    void render(uint32_t nowMs) {
+        UiModel model;
+        model.nowMs = nowMs;
+        model.selfId = m_mesh.nodeId();
+        model.meshNodes = m_table.size() - 1;
+        model.received = m_received;
+        model.parseErrors = m_parseErrors;
+        for (int i = 0; i < NODE_VALUES; i++) {
+            model.keys[i] = kUiLabels[i];
+            model.suffix[i] = kUiSuffix[i];
+            model.values[i] = m_core.value(i);
+        }
+        model.nodes = &m_table;
+        model.nodeIndex = nowMs / SIM_PAGE_MS;
+        for (int i = 0; i < 3; i++) {
+            model.trend[i] = &m_trend[i];
+        }
+        m_view.beginFrame();
+        FrameBuffer fb = m_view.frame();
+        renderPage(fb, model, (nowMs / SIM_PAGE_MS) % PAGE_COUNT);
+        m_view.present();
+        mix(m_display.panel(), FB_BYTES);
+    }
+
+    void mix(const void *data, size_t len) {
+        const uint8_t *p = (const uint8_t *)data;
+        for (size_t i = 0; i < len; i++) {
+            m_digest = (m_digest ^ p[i]) * 16777619u;
+        }
+    }
+
+    FakeClock &m_clock;
+    FakeMesh m_mesh;
+    VirtualPms7003 m_sensor;
+    NodeTable m_table;
+    NodeCore m_core;
+    Pms7003 m_pms;
+    Acquisition m_acquisition;
+    SensorConditioner m_conditioner;
+    FakeDisplay m_display;
+    OledView m_view;
+    FakeLeds m_strip;
+    LedStatus<NODE_VALUES> m_leds;
+    JsonDocument m_json;
+    History m_trend[3];
+    FILE *m_log = nullptr;
+    uint32_t m_received = 0;
+    uint32_t m_parseErrors = 0;
+    uint32_t m_lastBroadcast = 0;
+    uint32_t m_lastRender = 0;
+    bool m_dirty = true;
+    uint32_t m_digest = 2166136261u;
+};
@@ -0,0 +1,153 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        smoothing.h
+//
+// Description:
+//
+//   Smooths one sensor channel, in Fixed16, so the values shown and sent
+//   don't jitter from one reading to the next.  Two filters:
+//
+//     ema      exponential moving average, x += a * (z - x)
+//     kalman   scalar Kalman filter on a random walk, with measurement
+//              noise that grows with the level, as the PMS7003's does
+//
+//   Both are set by one number, the latency: the time constant of a
+//   step, i.e. about how long until a change is 63% of the way through.
+//   Readings come at whatever rate the sensor runs, so the gain follows
+//   the time since the last one, a = dt / (latency + dt).  The Kalman
+//   filter's process noise is chosen so its steady-state gain is that
+//   same a; what it adds is a fast start (the gain is high after a
+//   start and settles to a) and a gate: SMOOTH_CONFIRM readings in a
+//   row more than SMOOTH_GATE sigma off on the same side restart it at
+//   the reading, so a real step shows within a few samples however long
+//   the latency.  Spikes should be gone before this
+//   (include/conditioning.h); the confirmation stops the odd one left
+//   restarting it.
+//
+//   State is a few words per channel; an update is a handful of Fixed16
+//   multiplies and at most one divide.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <fixed_point.h>
+
+#ifndef SMOOTH_MODE
+#define SMOOTH_MODE         SMOOTH_KALMAN
+#endif
+#ifndef SMOOTH_LATENCY_MS
+#define SMOOTH_LATENCY_MS   15000   // Time constant of a step
+#endif
+#ifndef SMOOTH_GATE
+#define SMOOTH_GATE         4       // Sigma; 0 = never restart
+#endif
+#define SMOOTH_CONFIRM      2       // Readings past the gate before a restart
+#define SMOOTH_NOISE_MIN    2       // Measurement sigma, ug/m3, in clean air ...
+#define SMOOTH_NOISE_PCT    10      // ... or this share of the level, if more
+#define SMOOTH_NOISE_MAX    100     // Keeps the variance well inside Fixed16
+
+enum SmoothMode {
+    SMOOTH_OFF,
+    SMOOTH_EMA,
+    SMOOTH_KALMAN,
+    SMOOTH_MODE_COUNT
+};
+
+static const char *const kSmoothModeNames[SMOOTH_MODE_COUNT] = { "off", "ema", "kalman" };
+
+struct SmoothConfig {
+    uint8_t mode;           // SmoothMode
+    uint32_t latencyMs;     // 0 passes readings through
+    uint8_t gate;           // Kalman only
+};
+
+static const SmoothConfig kSmoothDefaults = { SMOOTH_MODE, SMOOTH_LATENCY_MS, SMOOTH_GATE };
+
+class Smoother {
+public:
+    explicit Smoother(const SmoothConfig &config = kSmoothDefaults) : m_config(config) {}
+
+    // Takes effect from the next reading, without losing the estimate
+    void configure(const SmoothConfig &config) { m_config = config; }
+    const SmoothConfig &config() const { return m_config; }
+
+    // Takes reading z at nowMs; returns the smoothed value
+    Fixed16 update(Fixed16 z, uint32_t nowMs) {
+        uint32_t dt = nowMs - m_lastMs;
+        m_lastMs = nowMs;
+        if (!m_started || m_config.mode == SMOOTH_OFF || !m_config.latencyMs) {
+            return restart(z);
+        }
+        Fixed16 a = ratio(dt, m_config.latencyMs + dt);
+        if (m_config.mode == SMOOTH_EMA) {
+            m_x += a * (z - m_x);
+            return m_x;
+        }
+
+        Fixed16 r = noise(m_x);
+        m_p += r * a * ratio(dt, m_config.latencyMs);  // q, for a steady-state gain of a
+        Fixed16 innovation = z - m_x;
+        if (outsideGate(innovation, m_p + r)) {
+            int8_t side = innovation > Fixed16() ? 1 : -1;
+            m_beyond = m_beyond * side > 0 ? m_beyond + side : side;
+            if (m_beyond * side >= SMOOTH_CONFIRM) {
+                m_resets++;
+                return restart(z);
+            }
+        } else {
+            m_beyond = 0;
+        }
+        Fixed16 k = m_p / (m_p + r);
+        m_x += k * innovation;
+        m_p = (Fixed16::fromInt(1) - k) * m_p;
+        return m_x;
+    }
+
+    Fixed16 value() const { return m_x; }
+    uint32_t resets() const { return m_resets; }
+
+private:
+    // num / den as a fraction, num and den in the same unit
+    static Fixed16 ratio(uint32_t num, uint32_t den) {
+        return Fixed16::fromRaw(fixedSaturate(((int64_t)num << 16) / den));
+    }
+
+    // Measurement variance at level x
+    static Fixed16 noise(Fixed16 x) {
+        Fixed16 sigma = x * SMOOTH_NOISE_PCT / 100;
+        sigma = sigma < Fixed16::fromInt(SMOOTH_NOISE_MIN) ? Fixed16::fromInt(SMOOTH_NOISE_MIN)
+              : sigma > Fixed16::fromInt(SMOOTH_NOISE_MAX) ? Fixed16::fromInt(SMOOTH_NOISE_MAX)
+              : sigma;
+        return sigma * sigma;
+    }
+
+    // |innovation| > gate x sqrt(variance), squared to stay in integers
+    bool outsideGate(Fixed16 innovation, Fixed16 variance) const {
+        if (!m_config.gate) {
+            return false;
+        }
+        int64_t d = innovation.raw();
+        return d * d > (int64_t)m_config.gate * m_config.gate * variance.raw() * Fixed16::kOne;
+    }
+
+    // Starts over at z; the first estimate is as uncertain as one reading
+    Fixed16 restart(Fixed16 z) {
+        m_started = true;
+        m_x = z;
+        m_p = noise(z);
+        m_beyond = 0;
+        return m_x;
+    }
+
+    SmoothConfig m_config;
+    bool m_started = false;
+    uint32_t m_lastMs = 0;
+    Fixed16 m_x;            // Estimate
+    Fixed16 m_p;            // Its variance, Kalman only
+    int8_t m_beyond = 0;    // Readings past the gate in a row, signed by side
+    uint32_t m_resets = 0;
+};
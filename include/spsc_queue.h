@@ -0,0 +1,106 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        spsc_queue.h
+//
+// Description:
+//
+//   Bounded lock-free queue for exactly one producer and one consumer,
+//   e.g. between tasks pinned to different cores.  Items live in the
+//   queue's own slots and ownership moves with explicit calls:
+//
+//     producer:  T *slot = q.claim();   fill *slot;   q.publish();
+//     consumer:  T *item = q.front();   use *item;    q.pop();
+//
+//   Between claim() and publish() the slot belongs to the producer, and
+//   between front() and pop() to the consumer, so a reading is written
+//   in place once and never copied through the queue.  claim() returns
+//   nullptr when full and front() when empty; neither ever blocks.
+//
+//   Each side keeps a cached copy of the other's index and only reloads
+//   it (an acquire load) when the cache says full/empty.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+#ifndef QUEUE_CACHE_LINE
+#define QUEUE_CACHE_LINE 64     // Keeps producer and consumer indices apart
+#endif
+
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    // Producer side
+    T *claim() {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tailCache == N) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head - m_tailCache == N) {
+                return nullptr;
+            }
+        }
+        return &m_slots[head & (N - 1)];
+    }
+
+    void publish() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T &item) {
+        T *slot = claim();
+        if (!slot) {
+            return false;
+        }
+        *slot = item;
+        publish();
+        return true;
+    }
+
+    // Consumer side
+    T *front() {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_headCache) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail == m_headCache) {
+                return nullptr;
+            }
+        }
+        return &m_slots[tail & (N - 1)];
+    }
+
+    void pop() {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool tryPop(T &out) {
+        T *item = front();
+        if (!item) {
+            return false;
+        }
+        out = *item;
+        pop();
+        return true;
+    }
+
+    // Approximate when called while the other side is running
+    size_t size() const {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T m_slots[N];
+    alignas(QUEUE_CACHE_LINE) std::atomic<size_t> m_head{0};    // Written by the producer
+    size_t m_tailCache = 0;                                     // Producer's view of m_tail
+    alignas(QUEUE_CACHE_LINE) std::atomic<size_t> m_tail{0};    // Written by the consumer
+    size_t m_headCache = 0;                                     // Consumer's view of m_head
+};
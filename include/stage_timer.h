@@ -0,0 +1,151 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        stage_timer.h
+//
+// Description:
+//
+//   Latency histograms for pipeline stages.  STAGE_TIMER(hist) at the top
+//   of a block times it from there to the closing brace.  Times are taken
+//   in ticks, which are CPU cycles on the ESP32 (the CCOUNT register, one
+//   instruction to read) and nanoseconds on a host.
+//
+//   Each histogram has 64 log-scale buckets: two per power of two, so any
+//   recorded value lands in a bucket no more than 50% wider than itself.
+//   Recording is a count-leading-zeros, a shift and a few adds, with no
+//   division and no locking.  Every stage is written by a single task.  A
+//   reader on another core can see a histogram mid-update; that is fine
+//   for monitoring.
+//
+//   With STAGE_TIMING 0, STAGE_TIMER() expands to nothing and the probes
+//   cost nothing.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stdint.h>
+
+#ifndef STAGE_TIMING
+#define STAGE_TIMING 1
+#endif
+
+#define STAGE_BUCKETS 64
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Arduino.h>
+inline uint32_t stageTicks() { return ESP.getCycleCount(); }
+inline uint32_t stageTicksPerUs() { return getCpuFrequencyMhz(); }
+#else
+#include <time.h>
+inline uint32_t stageTicks() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+}
+inline uint32_t stageTicksPerUs() { return 1000; }
+#endif
+
+class LatencyHistogram {
+public:
+    // 0 and 1 get their own buckets; above that, 2 per power of two
+    static int bucketIndex(uint32_t ticks) {
+        if (ticks < 2) {
+            return ticks;
+        }
+        int msb = 31 - __builtin_clz(ticks);
+        return 2 * msb + ((ticks >> (msb - 1)) & 1);
+    }
+
+    // Smallest value that lands in bucket i
+    static uint64_t bucketLow(int i) {
+        if (i < 2) {
+            return i;
+        }
+        int msb = i / 2;
+        return (1ull << msb) + (uint64_t)(i & 1) * (1ull << (msb - 1));
+    }
+
+    // One past the largest value that lands in bucket i
+    static uint64_t bucketHigh(int i) {
+        return i + 1 < STAGE_BUCKETS ? bucketLow(i + 1) : 1ull << 32;
+    }
+
+    // Largest value that lands in bucket i: its inclusive upper bound, as
+    // an OpenMetrics "le" needs
+    static uint32_t bucketMax(int i) { return (uint32_t)(bucketHigh(i) - 1); }
+
+    void record(uint32_t ticks) {
+        m_buckets[bucketIndex(ticks)]++;
+        m_count++;
+        m_sum += ticks;
+        if (ticks > m_max) {
+            m_max = ticks;
+        }
+    }
+
+    // Upper bound of the bucket holding the given fraction of samples,
+    // capped at the largest value seen; 0 when empty
+    uint32_t percentile(double fraction) const {
+        if (!m_count) {
+            return 0;
+        }
+        uint64_t rank = (uint64_t)(fraction * m_count + 0.5);
+        rank = rank < 1 ? 1 : rank > m_count ? m_count : rank;
+        uint64_t seen = 0;
+        for (int i = 0; i < STAGE_BUCKETS; i++) {
+            seen += m_buckets[i];
+            if (seen >= rank) {
+                return bucketMax(i) < m_max ? bucketMax(i) : m_max;
+            }
+        }
+        return m_max;
+    }
+
+    // Adds other's samples, as if they had been recorded here too
+    void merge(const LatencyHistogram &other) {
+        for (int i = 0; i < STAGE_BUCKETS; i++) {
+            m_buckets[i] += other.m_buckets[i];
+        }
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+        if (other.m_max > m_max) {
+            m_max = other.m_max;
+        }
+    }
+
+    void reset() { *this = LatencyHistogram(); }
+
+    uint32_t count() const { return m_count; }
+    uint64_t sum() const { return m_sum; }
+    uint32_t max() const { return m_max; }
+    uint32_t bucket(int i) const { return m_buckets[i]; }
+
+private:
+    uint32_t m_buckets[STAGE_BUCKETS] = {};
+    uint32_t m_count = 0;
+    uint64_t m_sum = 0;
+    uint32_t m_max = 0;
+};
+
+// Records the time from construction to the end of the enclosing scope
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(LatencyHistogram &hist) : m_hist(hist), m_start(stageTicks()) {}
+    ~ScopedStageTimer() { m_hist.record(stageTicks() - m_start); }
+
+private:
+    LatencyHistogram &m_hist;
+    uint32_t m_start;
+};
+
+#define STAGE_CONCAT2(a, b) a##b
+#define STAGE_CONCAT(a, b) STAGE_CONCAT2(a, b)
+
+#if STAGE_TIMING
+#define STAGE_TIMER(hist) ScopedStageTimer STAGE_CONCAT(stageTimer_, __LINE__)(hist)
+#else
+#define STAGE_TIMER(hist)
+#endif
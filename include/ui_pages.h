@@ -0,0 +1,209 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        ui_pages.h
+//
+// Description:
+//
+//   Pages of the OLED UI, drawn into a FrameBuffer from a UiModel.  The
+//   model is plain data filled in by the firmware (or a host tool), so
+//   every page can be rendered and compared off the device.
+//
+//     PAGE_READINGS   the five values last shown (the original screen)
+//     PAGE_SUMMARY    mesh totals and the worst AQI seen
+//     PAGE_NODE       one node table entry; the carousel steps through them
+//     PAGE_TREND_*    sparkline of recent PM history
+//
+//   Layouts are fixed character cells on the 21x8 text grid, and the only
+//   number formatting is formatUint/formatTenths, so each page costs a
+//   bounded amount of work whatever the data.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <framebuffer.h>
+#include <history.h>
+#include <node_table.h>
+#include <aqi.h>
+
+enum UiPage {
+    PAGE_READINGS,
+    PAGE_SUMMARY,
+    PAGE_NODE,
+    PAGE_TREND_PM1_0,
+    PAGE_TREND_PM2_5,
+    PAGE_TREND_PM10_0,
+    PAGE_COUNT
+};
+
+struct UiModel {
+    uint32_t nowMs;
+    uint32_t selfId;
+    int meshNodes;
+    uint32_t received;
+    uint32_t parseErrors;
+    const char *keys[NODE_VALUES];
+    const char *suffix[NODE_VALUES];
+    const char *values[NODE_VALUES];    // What PAGE_READINGS shows
+    const NodeTable *nodes;
+    int nodeIndex;                      // Carousel position in the node table
+    const History *trend[3];            // pm1.0, pm2.5, pm10.0 in tenths
+};
+
+// Cell layout shared by the label/value pages
+#define UI_LABEL_COL    0
+#define UI_VALUE_END    16      // Values are right-aligned to end here ...
+#define UI_SUFFIX_COL   17      // ... and units start here, unless a long
+                                // label or value pushes them right
+#define UI_FIRST_ROW    2
+
+// What the readings and node pages call each value, short enough that a
+// value of up to seven characters fits after it, and its unit
+static const char *const kUiLabels[NODE_VALUES] = { "PM 1.0", "PM 2.5", "PM 10.0", "Temp", "Humidity" };
+static const char *const kUiSuffix[NODE_VALUES] = { "ppm", "ppm", "ppm", "F", "%" };
+
+// Sparkline area: rows 1..6 of the text grid
+#define UI_SPARK_X      4
+#define UI_SPARK_W      120
+#define UI_SPARK_TOP    10
+#define UI_SPARK_BOTTOM 53
+
+static const char *const kTrendTitles[3] = { "PM 1.0 TREND", "PM 2.5 TREND", "PM 10.0 TREND" };
+
+// Inverse title bar with the page number on the right
+inline void uiTitle(FrameBuffer &fb, const char *title, int page) {
+    char bar[FB_COLS + 1];
+    memset(bar, ' ', FB_COLS);
+    bar[FB_COLS] = '\0';
+    size_t len = strlen(title);
+    memcpy(bar + 1, title, len < FB_COLS - 5 ? len : FB_COLS - 5);
+    bar[FB_COLS - 4] = '0' + (page + 1);
+    bar[FB_COLS - 3] = '/';
+    bar[FB_COLS - 2] = '0' + PAGE_COUNT;
+    fb.text(0, 0, bar, true);
+}
+
+// A label, its value right-aligned at UI_VALUE_END and its unit.  A
+// value that would reach the label starts one cell after it instead,
+// and the unit follows it; the row is cut at the edge, never overwritten.
+inline void uiRow(FrameBuffer &fb, int row, const char *label, const char *value, const char *suffix) {
+    int labelEnd = fb.text(UI_LABEL_COL, row, label);
+    int valueCol = UI_VALUE_END - (int)strlen(value);
+    int valueEnd = fb.text(valueCol > labelEnd ? valueCol : labelEnd + 1, row, value);
+    if (suffix) {
+        fb.text(valueEnd < UI_SUFFIX_COL ? UI_SUFFIX_COL : valueEnd + 1, row, suffix);
+    }
+}
+
+inline void uiReadings(FrameBuffer &fb, const UiModel &m) {
+    uiTitle(fb, "READINGS", PAGE_READINGS);
+    for (int i = 0; i < NODE_VALUES; i++) {
+        uiRow(fb, UI_FIRST_ROW + i, m.keys[i], m.values[i], m.suffix[i]);
+    }
+}
+
+inline void uiSummary(FrameBuffer &fb, const UiModel &m) {
+    char num[12];
+    uiTitle(fb, "MESH", PAGE_SUMMARY);
+
+    formatUint(num, m.meshNodes);
+    uiRow(fb, 2, "Reachable", num, nullptr);
+    formatUint(num, m.nodes->size());
+    uiRow(fb, 3, "Reporting", num, nullptr);
+    formatUint(num, m.received);
+    uiRow(fb, 4, "Received", num, nullptr);
+    formatUint(num, m.parseErrors);
+    uiRow(fb, 5, "Errors", num, nullptr);
+
+    // Worst AQI across the node table: one pass, no allocation
+    uint16_t worst = 0;
+    uint32_t worstNode = 0;
+    for (int i = 0; i < m.nodes->size(); i++) {
+        const NodeEntry &e = m.nodes->at(i);
+        uint16_t aqi = aqiOverall(tenthsFromText(e.value[1]), tenthsFromText(e.value[2]));
+        if (aqi >= worst) {
+            worst = aqi;
+            worstNode = e.nodeId;
+        }
+    }
+    formatUint(num, worst);
+    uiRow(fb, 6, "Worst AQI", num, nullptr);
+    if (m.nodes->size()) {
+        formatUint(num, worstNode);
+        fb.textRight(FB_COLS, 7, num);
+    }
+}
+
+inline void uiNode(FrameBuffer &fb, const UiModel &m) {
+    char title[FB_COLS];
+    int n = m.nodes->size();
+    if (n == 0) {
+        uiTitle(fb, "NODE", PAGE_NODE);
+        fb.text(0, 3, "No nodes heard yet");
+        return;
+    }
+    int index = m.nodeIndex % n;
+    const NodeEntry &e = m.nodes->at(index);
+
+    memcpy(title, "NODE ", 5);
+    int len = 5 + formatUint(title + 5, index + 1);
+    title[len++] = '/';
+    formatUint(title + len, n);
+    uiTitle(fb, title, PAGE_NODE);
+
+    char num[12];
+    formatUint(num, e.nodeId);
+    fb.text(0, 1, num);
+    formatUint(num, (m.nowMs - e.lastSeen) / 1000);
+    len = strlen(num);
+    num[len++] = 's';
+    num[len] = '\0';
+    fb.textRight(FB_COLS, 1, num);
+    for (int i = 0; i < NODE_VALUES; i++) {
+        uiRow(fb, UI_FIRST_ROW + i, m.keys[i], e.value[i], m.suffix[i]);
+    }
+}
+
+inline void uiTrend(FrameBuffer &fb, const UiModel &m, int metric, int page) {
+    uiTitle(fb, kTrendTitles[metric], page);
+    uint16_t columns[UI_SPARK_W];
+    uint16_t lo, hi;
+    int used = m.trend[metric]->decimate(columns, UI_SPARK_W, &lo, &hi);
+    if (used == 0) {
+        fb.text(0, 3, "Collecting...");
+        return;
+    }
+
+    // Filled sparkline, scaled to the visible range, newest at the right
+    uint32_t span = hi > lo ? hi - lo : 1;
+    int height = UI_SPARK_BOTTOM - UI_SPARK_TOP;
+    int x0 = UI_SPARK_X + UI_SPARK_W - used;
+    for (int c = 0; c < used; c++) {
+        int y = UI_SPARK_BOTTOM - (int)((columns[c] - lo) * height / span);
+        fb.vline(x0 + c, UI_SPARK_BOTTOM, y);
+    }
+    fb.hline(UI_SPARK_X, UI_SPARK_X + UI_SPARK_W - 1, UI_SPARK_BOTTOM + 1);
+
+    char num[12];
+    fb.text(0, 7, "lo");
+    formatTenths(num, lo);
+    fb.text(3, 7, num);
+    fb.text(11, 7, "hi");
+    formatTenths(num, hi);
+    fb.text(14, 7, num);
+}
+
+inline void renderPage(FrameBuffer &fb, const UiModel &m, int page) {
+    fb.clear();
+    switch (page) {
+    case PAGE_READINGS:     uiReadings(fb, m); break;
+    case PAGE_SUMMARY:      uiSummary(fb, m); break;
+    case PAGE_NODE:         uiNode(fb, m); break;
+    case PAGE_TREND_PM1_0:  uiTrend(fb, m, 0, page); break;
+    case PAGE_TREND_PM2_5:  uiTrend(fb, m, 1, page); break;
+    case PAGE_TREND_PM10_0: uiTrend(fb, m, 2, page); break;
+    }
+}
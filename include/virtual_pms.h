@@ -0,0 +1,387 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        virtual_pms.h
+//
+// Description:
+//
+//   A PMS7003 for the host, seen through the HalSerial it is wired to.
+//   It answers the commands Pms7003 sends with the frames the real sensor
+//   would: an 8-byte ack for mode and sleep changes, a 32-byte reading
+//   per read request in passive mode, and one reading every period in
+//   active mode, which is how the sensor powers up.  Bytes arrive at
+//   9600 baud on a HalClock, so a reader polling too early sees half a
+//   frame, as it would on the UART.
+//
+//   Values come from a PmsProfile: SyntheticProfile (a daily cycle plus
+//   smoke events) or TraceProfile (recorded readings).  VirtualPmsConfig
+//   adds faults on top: noise, bit flips that break the checksum, dropped
+//   bytes, and power-up or wake part-way through a frame.  All randomness
+//   is a seeded xorshift, so a run is repeatable for a given seed.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <hal.h>
+#include <pms7003.h>
+
+#include <deque>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define VPMS_BYTE_US        1042    // 10 bits at 9600 baud
+#define VPMS_LATENCY_US     3000    // Request to first byte of the answer
+#define VPMS_ACTIVE_MS      1000    // Reading period in active mode
+#define VPMS_SETTLE_MS      30000   // Readings ramp up from 0 while the fan spins up
+#define VPMS_DAY_MS         86400000u
+
+// The sensor's true atmospheric readings at a given time, in ug/m3
+class PmsProfile {
+public:
+    virtual void sample(uint32_t ms, uint16_t pm[3]) = 0;
+
+protected:
+    ~PmsProfile() = default;
+};
+
+// A clean baseline with a daily swing (a triangle wave, peaking at
+// peakHourMs) and, optionally, a smoke event every eventEveryMs that
+// rises over eventRiseMs and decays over eventDecayMs
+struct SyntheticProfile : PmsProfile {
+    uint16_t base = 8;              // pm2.5 at the daily low
+    uint16_t dailySwing = 10;       // Added at the daily peak
+    uint32_t peakHourMs = 18 * 3600000u;
+    uint16_t eventPeak = 0;         // Added at the top of an event; 0 = none
+    uint32_t eventEveryMs = VPMS_DAY_MS;
+    uint32_t eventOffsetMs = 13 * 3600000u;
+    uint32_t eventRiseMs = 600000;
+    uint32_t eventDecayMs = 3 * 3600000u;
+
+    void sample(uint32_t ms, uint16_t pm[3]) override {
+        uint32_t day = (ms + VPMS_DAY_MS - peakHourMs % VPMS_DAY_MS + VPMS_DAY_MS / 2) % VPMS_DAY_MS;
+        uint32_t fromLow = day < VPMS_DAY_MS / 2 ? day : VPMS_DAY_MS - day;  // 0 at the low, DAY/2 at the peak
+        uint32_t pm25 = base + (uint64_t)dailySwing * fromLow / (VPMS_DAY_MS / 2);
+        if (eventPeak && eventEveryMs && ms >= eventOffsetMs) {
+            uint32_t t = (ms - eventOffsetMs) % eventEveryMs;
+            if (t < eventRiseMs) {
+                pm25 += (uint64_t)eventPeak * t / eventRiseMs;
+            } else if (t < eventRiseMs + eventDecayMs) {
+                pm25 += (uint64_t)eventPeak * (eventRiseMs + eventDecayMs - t) / eventDecayMs;
+            }
+        }
+        pm[0] = (uint16_t)(pm25 * 2 / 3);
+        pm[1] = (uint16_t)pm25;
+        pm[2] = (uint16_t)(pm25 * 3 / 2 + base / 2);  // Coarse dust doesn't follow smoke
+    }
+};
+
+// Recorded readings, each held until the next.  Past the end the trace
+// repeats, so a short recording can drive a long run.
+class TraceProfile : public PmsProfile {
+public:
+    struct Point {
+        uint32_t ms;
+        uint16_t pm[3];
+    };
+
+    void add(uint32_t ms, uint16_t pm1_0, uint16_t pm2_5, uint16_t pm10_0) {
+        m_points.push_back({ ms, { pm1_0, pm2_5, pm10_0 } });
+    }
+
+    // Lines of "ms,pm1.0,pm2.5,pm10.0" in time order; '#' starts a
+    // comment.  Returns false if the file can't be read or has no points.
+    bool load(const char *path) {
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            return false;
+        }
+        char line[128];
+        while (fgets(line, sizeof(line), f)) {
+            unsigned ms, a, b, c;
+            if (line[0] != '#' && sscanf(line, "%u,%u,%u,%u", &ms, &a, &b, &c) == 4) {
+                add(ms, a, b, c);
+            }
+        }
+        fclose(f);
+        return !m_points.empty();
+    }
+
+    void sample(uint32_t ms, uint16_t pm[3]) override {
+        if (m_points.empty()) {
+            pm[0] = pm[1] = pm[2] = 0;
+            return;
+        }
+        uint32_t span = m_points.back().ms + 1;
+        ms %= span;
+        // Readings are asked for in time order, so the search resumes
+        // where the last one stopped
+        if (m_at >= m_points.size() || m_points[m_at].ms > ms) {
+            m_at = 0;
+        }
+        while (m_at + 1 < m_points.size() && m_points[m_at + 1].ms <= ms) {
+            m_at++;
+        }
+        for (int i = 0; i < 3; i++) {
+            pm[i] = m_points[m_at].pm[i];
+        }
+    }
+
+    size_t size() const { return m_points.size(); }
+
+private:
+    std::vector<Point> m_points;
+    size_t m_at = 0;
+};
+
+struct VirtualPmsConfig {
+    uint32_t seed = 1;
+    uint16_t noisePct = 0;          // Each reading varies by up to +/- this
+    uint16_t corruptPerMille = 0;   // Frames with one bit flipped
+    uint16_t dropPerMille = 0;      // Frames missing one byte
+    bool midFrameStart = false;     // Power-up and wake begin inside a frame
+    uint32_t activePeriodMs = VPMS_ACTIVE_MS;
+    uint32_t latencyUs = VPMS_LATENCY_US;
+};
+
+struct VirtualPmsStats {
+    uint32_t readings;      // Reading frames sent, faulty or not
+    uint32_t acks;
+    uint32_t corrupted;
+    uint32_t dropped;
+    uint32_t commands;      // Well-formed commands received
+    uint32_t badCommands;   // Bad header or sum
+    uint32_t ignored;       // Reads while asleep or in active mode
+};
+
+class VirtualPms7003 : public HalSerial {
+public:
+    VirtualPms7003(HalClock &clock, PmsProfile &profile, const VirtualPmsConfig &config = VirtualPmsConfig())
+        : m_clock(clock), m_profile(profile), m_config(config), m_random(config.seed ? config.seed : 1) {
+        powerOn();
+    }
+
+    // Starts over as the sensor does at power-up: active mode, fan
+    // settling, and possibly the tail of a frame already on the wire
+    void powerOn() {
+        m_rx.clear();
+        m_cmdLen = 0;
+        m_passive = false;
+        m_asleep = false;
+        m_wokeMs = m_clock.millis();
+        m_nextActiveMs = m_wokeMs + m_config.activePeriodMs;
+        if (m_config.midFrameStart) {
+            sendPartialFrame();
+        }
+    }
+
+    int available() override {
+        run();
+        uint32_t now = m_clock.micros();
+        int count = 0;
+        for (const Byte &b : m_rx) {
+            if ((int32_t)(now - b.atUs) < 0) {
+                break;
+            }
+            count++;
+        }
+        return count;
+    }
+
+    int read() override {
+        run();
+        if (m_rx.empty() || (int32_t)(m_clock.micros() - m_rx.front().atUs) < 0) {
+            return -1;
+        }
+        uint8_t b = m_rx.front().value;
+        m_rx.pop_front();
+        return b;
+    }
+
+    size_t write(const uint8_t *data, size_t len) override {
+        run();
+        for (size_t i = 0; i < len; i++) {
+            if (m_cmdLen == 0 && data[i] != 0x42) {
+                continue;
+            }
+            m_cmd[m_cmdLen++] = data[i];
+            if (m_cmdLen == 7) {
+                m_cmdLen = 0;
+                command();
+            }
+        }
+        return len;
+    }
+
+    bool passive() const { return m_passive; }
+    bool asleep() const { return m_asleep; }
+    const VirtualPmsStats &stats() const { return m_stats; }
+
+private:
+    struct Byte {
+        uint32_t atUs;  // When it has fully arrived at the host
+        uint8_t value;
+    };
+
+    // Sends the active-mode readings that have come due
+    void run() {
+        if (m_passive || m_asleep) {
+            return;
+        }
+        uint32_t now = m_clock.millis();
+        while ((int32_t)(now - m_nextActiveMs) >= 0) {
+            sendReading(m_nextActiveMs);
+            m_nextActiveMs += m_config.activePeriodMs;
+        }
+    }
+
+    void command() {
+        uint16_t sum = 0;
+        for (int i = 0; i < 5; i++) {
+            sum += m_cmd[i];
+        }
+        if (m_cmd[1] != 0x4D || sum != ((m_cmd[5] << 8) | m_cmd[6])) {
+            m_stats.badCommands++;
+            return;
+        }
+        m_stats.commands++;
+        uint8_t cmd = m_cmd[2];
+        uint8_t data = m_cmd[4];
+        uint32_t now = m_clock.millis();
+        switch (cmd) {
+        case PMS_CMD_READ:
+            if (m_passive && !m_asleep) {
+                sendReading(now);
+            } else {
+                m_stats.ignored++;
+            }
+            return;
+        case PMS_CMD_MODE:
+            if (m_asleep) {
+                break;
+            }
+            m_passive = data == 0;
+            m_nextActiveMs = now + m_config.activePeriodMs;
+            break;
+        case PMS_CMD_SLEEP:
+            if (data == 1 && m_asleep) {
+                m_asleep = false;
+                m_wokeMs = now;
+                m_nextActiveMs = now + m_config.activePeriodMs;
+                if (m_config.midFrameStart) {
+                    sendPartialFrame();
+                }
+                return;  // Waking doesn't ack
+            }
+            m_asleep = data == 0;
+            break;
+        default:
+            m_stats.badCommands++;
+            return;
+        }
+        uint8_t ack[8] = { 0x42, 0x4D, 0x00, 0x04, cmd, data };
+        finishFrame(ack, sizeof(ack));
+        queue(ack, sizeof(ack));
+        m_stats.acks++;
+    }
+
+    // Builds the reading the sensor would report at ms
+    void buildReading(uint32_t ms, uint8_t frame[4 + PMS_READING_LEN]) {
+        uint16_t pm[3];
+        m_profile.sample(ms, pm);
+        uint32_t awake = ms - m_wokeMs;
+        uint16_t words[13] = {};
+        for (int i = 0; i < 3; i++) {
+            uint32_t v = pm[i];
+            if (awake < VPMS_SETTLE_MS) {
+                v = v * awake / VPMS_SETTLE_MS;
+            }
+            if (m_config.noisePct && v) {
+                uint32_t span = v * m_config.noisePct / 100;
+                int32_t offset = (int32_t)(next() % (2 * span + 1)) - (int32_t)span;
+                v = (int32_t)v + offset > 0 ? v + offset : 0;
+            }
+            words[i] = (uint16_t)v;         // Standard particles; the same here
+            words[3 + i] = (uint16_t)v;     // Atmospheric environment
+        }
+        frame[0] = 0x42;
+        frame[1] = 0x4D;
+        frame[2] = 0;
+        frame[3] = PMS_READING_LEN;
+        for (int w = 0; w < 13; w++) {
+            frame[4 + w * 2] = words[w] >> 8;
+            frame[5 + w * 2] = (uint8_t)words[w];
+        }
+        finishFrame(frame, 4 + PMS_READING_LEN);
+    }
+
+    void sendReading(uint32_t ms) {
+        uint8_t frame[4 + PMS_READING_LEN];
+        buildReading(ms, frame);
+        size_t len = sizeof(frame);
+        if (m_config.corruptPerMille && next() % 1000 < m_config.corruptPerMille) {
+            frame[2 + next() % (len - 2)] ^= (uint8_t)(1 << next() % 8);  // Header kept, so it fails the sum
+            m_stats.corrupted++;
+        }
+        if (m_config.dropPerMille && next() % 1000 < m_config.dropPerMille) {
+            size_t at = next() % len;
+            memmove(frame + at, frame + at + 1, len - at - 1);
+            len--;
+            m_stats.dropped++;
+        }
+        queue(frame, len);
+        m_stats.readings++;
+    }
+
+    // The last part of a reading, as if the host started listening late
+    void sendPartialFrame() {
+        uint8_t frame[4 + PMS_READING_LEN];
+        buildReading(m_clock.millis(), frame);
+        size_t skip = 1 + next() % (sizeof(frame) - 1);
+        queue(frame + skip, sizeof(frame) - skip);
+    }
+
+    static void finishFrame(uint8_t *frame, size_t len) {
+        uint16_t sum = 0;
+        for (size_t i = 0; i < len - 2; i++) {
+            sum += frame[i];
+        }
+        frame[len - 2] = sum >> 8;
+        frame[len - 1] = (uint8_t)sum;
+    }
+
+    // Puts bytes on the wire after whatever is still being sent
+    void queue(const uint8_t *data, size_t len) {
+        uint32_t at = m_clock.micros() + m_config.latencyUs;
+        if (!m_rx.empty() && (int32_t)(m_rx.back().atUs - at) >= 0) {
+            at = m_rx.back().atUs;
+        }
+        for (size_t i = 0; i < len; i++) {
+            at += VPMS_BYTE_US;
+            m_rx.push_back({ at, data[i] });
+        }
+    }
+
+    uint32_t next() {
+        m_random ^= m_random << 13;
+        m_random ^= m_random >> 17;
+        m_random ^= m_random << 5;
+        return m_random;
+    }
+
+    HalClock &m_clock;
+    PmsProfile &m_profile;
+    VirtualPmsConfig m_config;
+    uint32_t m_random;
+    std::deque<Byte> m_rx;
+    uint8_t m_cmd[7];
+    int m_cmdLen = 0;
+    bool m_passive = false;
+    bool m_asleep = false;
+    uint32_t m_wokeMs = 0;
+    uint32_t m_nextActiveMs = 0;
+    VirtualPmsStats m_stats = {};
+};
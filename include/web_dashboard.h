@@ -0,0 +1,427 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        web_dashboard.h
+//
+// Description:
+//
+//   Web dashboard for a node that is also joined to a WiFi station.  The
+//   page at "/" is rendered once and then kept current by an EventSource
+//   on "/events", so readings show up as they arrive instead of on a
+//   30 second page refresh.
+//
+//   Included from main.cpp after the reading globals (keys, nodeCore, suf).
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <WiFi.h>
+#include <WebServer.h>  // Simple web server for monitoring
+#include <event_stream.h>
+#include <openmetrics.h>
+#include <aqi.h>
+
+#ifndef WEB_SERVER_PORT
+#define WEB_SERVER_PORT 8080
+#endif
+
+WebServer server(WEB_SERVER_PORT);
+SseHub sseHub;
+
+// A node's row, as the node table has it, as the data of a reading event
+void formatReading(const NodeEntry &e, char *data, size_t size) {
+    int len = snprintf(data, size, "{\"node\":%u,\"v\":[", (unsigned)e.nodeId);
+    for (int i = 0; i < NODE_VALUES && len < (int)size; i++) {
+        len += snprintf(data + len, size - len, "%s\"%s\"", i ? "," : "", e.value[i]);
+    }
+    if (len < (int)size) {
+        snprintf(data + len, size - len, "]}");
+    }
+}
+
+// Queues a node's row for every connected browser
+void publishReading(const NodeEntry &e) {
+    char data[SSE_EVENT_SIZE - 32];
+    formatReading(e, data, sizeof(data));
+    sseHub.publish("reading", data);
+}
+
+// Every node's row, for a browser that is new or fell behind.  The web
+// server runs on the app core, which owns nodeTable.
+bool readingRow(int index, char *data, size_t size) {
+    if (index >= nodeTable.size()) {
+        return false;
+    }
+    formatReading(nodeTable.at(index), data, size);
+    return true;
+}
+
+// Handler for the root URL of the web server
+void handleRoot() {
+    String html = "<html><head><title>Mesh Network Monitor</title></head><body>";
+    html += "<h1>Sensor Readings</h1><table id=\"nodes\" border=\"1\"><tr><th>Node</th>";
+    for (int i = 0; i < 5; i++) {
+        html += "<th>" + String(keys[i]) + " (" + suf[i] + ")</th>";
+    }
+    html += "</tr></table><p id=\"status\">connecting...</p>";
+
+    // One row per node, updated in place as events arrive
+    html += "<script>"
+            "var t=document.getElementById('nodes'),s=document.getElementById('status');"
+            "var es=new EventSource('/events');"
+            "es.onopen=function(){s.textContent='live';};"
+            "es.onerror=function(){s.textContent='reconnecting...';};"
+            "es.addEventListener('reading',function(e){"
+            "var d=JSON.parse(e.data),r=document.getElementById('n'+d.node);"
+            "if(!r){r=t.insertRow();r.id='n'+d.node;r.insertCell().textContent=d.node;"
+            "for(var i=0;i<d.v.length;i++)r.insertCell();}"
+            "for(var i=0;i<d.v.length;i++)r.cells[i+1].textContent=d.v[i];"
+            "});"
+            "</script></body></html>";
+    server.send(200, "text/html", html);
+}
+
+// Handler for the /api/readings URL, which serves JSON data
+void handleJson() {
+    static TaggedJsonAllocator allocator(g_MemTags[MEM_TAG_JSON_WEB]);
+    JsonDocument doc(&allocator);  // Not jsonReadings, which belongs to the mesh task
+    for (int i = 0; i < 5; i++) {
+        doc[keys[i]] = nodeCore.value(i);
+    }
+    String json;
+    serializeJson(doc, json);
+    server.send(200, "application/json", json);
+}
+
+// Metric family names for the five reading values, in reading order
+static const char *kValueMetrics[NODE_VALUES] = {
+    "aq_pm1_0_ugm3", "aq_pm2_5_ugm3", "aq_pm10_0_ugm3", "aq_temperature", "aq_humidity"
+};
+
+void sendMetricsChunk(const char *data, size_t len) {
+    server.sendContent(data, len);
+}
+
+// Handler for /metrics in OpenMetrics text format, streamed in chunks
+void handleMetrics() {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, OPENMETRICS_CONTENT_TYPE, "");
+
+    MetricsWriter w(sendMetricsChunk);
+    unsigned long now = millis();
+
+    // Per-node readings; each family's samples must be contiguous.  A
+    // node without that sensor ("null", or nothing yet) has no sample
+    // rather than a 0.
+    for (int v = 0; v < NODE_VALUES; v++) {
+        w.family(kValueMetrics[v], "gauge", keys[v]);
+        for (int i = 0; i < nodeTable.size(); i++) {
+            const NodeEntry &e = nodeTable.at(i);
+            if (isReadingNumber(e.value[v])) {
+                w.nodeSample(kValueMetrics[v], e.nodeId, strtod(e.value[v], nullptr));
+            }
+        }
+    }
+    w.family("aq_aqi", "gauge", "US EPA AQI from PM2.5 and PM10");
+    for (int i = 0; i < nodeTable.size(); i++) {
+        const NodeEntry &e = nodeTable.at(i);
+        // The worse of the two; an unknown one reads as 0 and never wins
+        if (!isReadingNumber(e.value[1]) && !isReadingNumber(e.value[2])) {
+            continue;
+        }
+        w.nodeSample("aq_aqi", e.nodeId, aqiOverall(tenthsFromText(e.value[1]), tenthsFromText(e.value[2])));
+    }
+    w.family("aq_node_messages", "counter", "Readings received per node");
+    for (int i = 0; i < nodeTable.size(); i++) {
+        const NodeEntry &e = nodeTable.at(i);
+        w.line("aq_node_messages_total{node=\"%u\"} %u\n", (unsigned)e.nodeId, (unsigned)e.messages);
+    }
+    w.family("aq_node_age_seconds", "gauge", "Seconds since the node last reported");
+    for (int i = 0; i < nodeTable.size(); i++) {
+        const NodeEntry &e = nodeTable.at(i);
+        w.nodeSample("aq_node_age_seconds", e.nodeId, (now - e.lastSeen) / 1000.0);
+    }
+    w.family("aq_node_heap_free_bytes", "gauge", "Free heap each node last reported");
+    for (int i = 0; i < nodeTable.size(); i++) {
+        const NodeEntry &e = nodeTable.at(i);
+        if (e.heapFree) {
+            w.nodeSample("aq_node_heap_free_bytes", e.nodeId, e.heapFree);
+        }
+    }
+    w.family("aq_node_heap_fragmentation_ratio", "gauge", "Heap fragmentation each node last reported");
+    for (int i = 0; i < nodeTable.size(); i++) {
+        const NodeEntry &e = nodeTable.at(i);
+        if (e.heapFree) {
+            w.nodeSample("aq_node_heap_fragmentation_ratio", e.nodeId, e.heapFragPct / 100.0);
+        }
+    }
+    w.family("aq_node_report_interval_seconds", "gauge", "Time between each node's last two reports, as it sent it");
+    for (int i = 0; i < nodeTable.size(); i++) {
+        const NodeEntry &e = nodeTable.at(i);
+        if (e.reportDs) {
+            w.nodeSample("aq_node_report_interval_seconds", e.nodeId, e.reportDs / 10.0);
+        }
+    }
+    w.family("aq_node_raw_pm25", "gauge", "Sensor pm2.5 of each node that corrects or filters it, ug/m3");
+    for (int i = 0; i < nodeTable.size(); i++) {
+        const NodeEntry &e = nodeTable.at(i);
+        if (e.flags & READING_HAS_RAW) {
+            w.nodeSample("aq_node_raw_pm25", e.nodeId, e.rawPm[1]);
+        }
+    }
+    w.family("aq_node_sample_period_seconds", "gauge", "Each node's sensor sample period, as it sent it");
+    for (int i = 0; i < nodeTable.size(); i++) {
+        const NodeEntry &e = nodeTable.at(i);
+        if (e.sampleDs) {
+            w.nodeSample("aq_node_sample_period_seconds", e.nodeId, e.sampleDs / 10.0);
+        }
+    }
+
+    // Build profile
+    w.family("aq_node_role", "gauge", "Role this firmware was built for, with its feature bits");
+    w.line("aq_node_role{role=\"%s\",features=\"%02x\"} 1\n", kRoleNames[kNodeRole], (unsigned)kRoleFeatureMask);
+
+    // Message counters
+    w.family("aq_mesh_received", "counter", "Readings received from other nodes");
+    w.sample("aq_mesh_received", "_total", g_Counters.meshReceived);
+    w.family("aq_mesh_parse_errors", "counter", "Mesh messages that failed to parse");
+    w.sample("aq_mesh_parse_errors", "_total", g_Counters.meshParseErrors);
+    w.family("aq_mesh_sent", "counter", "Broadcasts sent by this node");
+    w.sample("aq_mesh_sent", "_total", g_Counters.meshSent);
+    w.family("aq_sensor_frames", "counter", "Valid PMS7003 frames");
+    w.sample("aq_sensor_frames", "_total", g_Counters.sensorFrames);
+    w.family("aq_sensor_bad_frames", "counter", "PMS7003 frames with a bad header or checksum");
+    w.sample("aq_sensor_bad_frames", "_total", g_Counters.sensorBadFrames);
+#if PMS_SENSOR
+    // Sampling cadence; stats are written by the acquisition task, so a
+    // scrape can catch them mid-update, which is fine for monitoring
+    const SampleStats &ss = acquisition.stats();
+    w.family("aq_sample_period_target_seconds", "gauge", "Configured sensor sample period");
+    w.sample("aq_sample_period_target_seconds", "", acquisition.periodMs() / 1e3);
+    w.family("aq_sample_period_seconds", "gauge", "Measured time between the last two samples");
+    w.sample("aq_sample_period_seconds", "", ss.periodLastUs / 1e6);
+    w.family("aq_sample_period_min_seconds", "gauge", "Shortest measured sample period");
+    w.sample("aq_sample_period_min_seconds", "", ss.intervals ? ss.periodMinUs / 1e6 : 0);
+    w.family("aq_sample_period_max_seconds", "gauge", "Longest measured sample period");
+    w.sample("aq_sample_period_max_seconds", "", ss.periodMaxUs / 1e6);
+    w.family("aq_sample_jitter_max_seconds", "gauge", "Largest deviation from the sample period");
+    w.sample("aq_sample_jitter_max_seconds", "", ss.jitterMaxUs / 1e6);
+    w.family("aq_sample_jitter_mean_seconds", "gauge", "Mean deviation from the sample period");
+    w.sample("aq_sample_jitter_mean_seconds", "", ss.intervals ? ss.jitterTotalUs / 1e6 / ss.intervals : 0);
+    w.family("aq_sample_timeouts", "counter", "Read requests the sensor did not answer");
+    w.sample("aq_sample_timeouts", "_total", ss.timeouts);
+    w.family("aq_sample_skipped", "counter", "Sample periods missed entirely");
+    w.sample("aq_sample_skipped", "_total", ss.skipped);
+#if OUTLIER_FILTER
+    w.family("aq_outliers", "counter", "Sensor values rejected as spikes, per channel");
+    for (int i = 0; i < 3; i++) {
+        w.labelSample("aq_outliers_total", "value", kReadingKeys[i], g_Conditioner.outliers(i).rejected());
+    }
+#endif
+#if SMOOTHING
+    w.family("aq_smooth_restarts", "counter", "Times the Kalman smoothing jumped to a step, per channel");
+    for (int i = 0; i < 3; i++) {
+        w.labelSample("aq_smooth_restarts_total", "value", kReadingKeys[i], g_Conditioner.smoother(i).resets());
+    }
+#endif
+#if CALIBRATION
+    const CalStats &cs = calibrator.stats();
+    w.family("aq_cal_model", "gauge", "Calibration model: 0 linear, 1 epa, 2 kohler");
+    w.sample("aq_cal_model", "", calibrator.coefficients().model);
+    w.family("aq_cal_no_humidity", "counter", "Readings a humidity model had to leave linear");
+    w.sample("aq_cal_no_humidity", "_total", cs.noHumidity);
+    w.family("aq_cal_clamped", "counter", "Calibrated values raised to zero");
+    w.sample("aq_cal_clamped", "_total", cs.clamped);
+#endif
+#if ADAPTIVE_RATE
+    const RateStats &rs = adaptiveRate.stats();
+    w.family("aq_rate_tier", "gauge", "Sampling tier: 0 calm, 1 active, 2 event");
+    w.sample("aq_rate_tier", "", adaptiveRate.tier());
+    w.family("aq_rate_escalations", "counter", "Steps up to a faster tier");
+    w.sample("aq_rate_escalations", "_total", rs.escalations);
+    w.family("aq_rate_decays", "counter", "Steps down to a slower tier");
+    w.sample("aq_rate_decays", "_total", rs.decays);
+#endif
+#endif
+    w.family("aq_mesh_throttled", "counter", "Broadcasts put off by the airtime budget");
+    w.sample("aq_mesh_throttled", "_total", g_Counters.meshThrottled);
+    w.family("aq_node_table_evictions", "counter", "Nodes dropped from the full node table");
+    w.sample("aq_node_table_evictions", "_total", nodeTable.evictions());
+
+    // Heap
+    w.family("aq_heap_free_bytes", "gauge", "Free heap");
+    w.sample("aq_heap_free_bytes", "", ESP.getFreeHeap());
+    w.family("aq_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    w.sample("aq_heap_min_free_bytes", "", ESP.getMinFreeHeap());
+    w.family("aq_heap_largest_block_bytes", "gauge", "Largest allocatable heap block");
+    w.sample("aq_heap_largest_block_bytes", "", ESP.getMaxAllocHeap());
+    w.family("aq_heap_fragmentation_ratio", "gauge", "Share of free heap outside the largest block");
+    w.sample("aq_heap_fragmentation_ratio", "", g_Heap.fragPct / 100.0);
+    w.family("aq_heap_alerts", "counter", "Times the heap went low or fragmented");
+    w.sample("aq_heap_alerts", "_total", g_Counters.heapAlerts);
+    w.family("aq_json_allocs", "counter", "JSON document allocations per owner");
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        w.labelSample("aq_json_allocs_total", "tag", kMemTagNames[i], g_MemTags[i].allocs);
+    }
+    w.family("aq_json_alloc_failures", "counter", "JSON document allocations that failed");
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        w.labelSample("aq_json_alloc_failures_total", "tag", kMemTagNames[i], g_MemTags[i].failures);
+    }
+    w.family("aq_json_live_bytes", "gauge", "Heap held by JSON documents now");
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        w.labelSample("aq_json_live_bytes", "tag", kMemTagNames[i], g_MemTags[i].bytesLive);
+    }
+    w.family("aq_json_peak_bytes", "gauge", "Most heap JSON documents have held at once");
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        w.labelSample("aq_json_peak_bytes", "tag", kMemTagNames[i], g_MemTags[i].bytesPeak);
+    }
+
+    // WiFi and mesh state
+    w.family("aq_wifi_connected", "gauge", "1 when the station link is up");
+    w.sample("aq_wifi_connected", "", WiFi.status() == WL_CONNECTED);
+    w.family("aq_wifi_rssi_dbm", "gauge", "Station signal strength");
+    w.sample("aq_wifi_rssi_dbm", "", WiFi.RSSI());
+    w.family("aq_mesh_nodes", "gauge", "Nodes reachable over the mesh");
+    w.sample("aq_mesh_nodes", "", g_MeshNodes);
+    w.family("aq_node_table_size", "gauge", "Nodes held in the node table");
+    w.sample("aq_node_table_size", "", nodeTable.size());
+    w.family("aq_sse_subscribers", "gauge", "Browsers subscribed to /events");
+    w.sample("aq_sse_subscribers", "", sseHub.subscribers());
+    w.family("aq_sse_dropped_events", "counter", "Events skipped for slow subscribers");
+    w.sample("aq_sse_dropped_events", "_total", sseHub.dropped());
+
+    w.family("aq_queue_dropped", "counter", "Readings lost because the processing queue was full");
+    w.labelSample("aq_queue_dropped_total", "source", "mesh", g_Counters.meshDropped);
+    w.labelSample("aq_queue_dropped_total", "source", "sensor", g_Counters.sensorDropped);
+    w.family("aq_log_dropped", "counter", "Log records lost to a full log queue");
+    w.sample("aq_log_dropped", "_total", g_Log.dropped());
+    w.family("aq_log_rate_limited", "counter", "Log records suppressed by per-site rate limits");
+    w.sample("aq_log_rate_limited", "_total", g_Log.rateLimited());
+    w.family("aq_led_shows", "counter", "LED strip updates pushed out");
+    w.sample("aq_led_shows", "_total", g_Counters.ledShows);
+
+#if OLED_DISPLAY
+    // OLED rendering
+    const DisplayStats &ds = oledView.stats();
+    w.family("aq_display_requests", "counter", "Readings that asked for a redraw");
+    w.sample("aq_display_requests", "_total", g_Counters.displayRequests);
+    w.family("aq_display_coalesced", "counter", "Redraw requests merged into a pending frame");
+    w.sample("aq_display_coalesced", "_total", g_Counters.displayCoalesced);
+    w.family("aq_display_renders", "counter", "OLED updates that sent data");
+    w.sample("aq_display_renders", "_total", ds.renders);
+    w.family("aq_display_skipped", "counter", "OLED updates with nothing changed");
+    w.sample("aq_display_skipped", "_total", ds.skipped);
+    w.family("aq_display_bytes", "counter", "Bytes sent to the OLED over I2C");
+    w.sample("aq_display_bytes", "_total", ds.bytesTotal);
+    w.family("aq_display_last_bytes", "gauge", "Bytes sent by the last OLED update");
+    w.sample("aq_display_last_bytes", "", ds.bytesLast);
+    w.family("aq_display_render_seconds", "counter", "Time spent rendering the OLED");
+    w.sample("aq_display_render_seconds", "_total", ds.usTotal / 1e6);
+    w.family("aq_display_render_max_seconds", "gauge", "Slowest OLED update since boot");
+    w.sample("aq_display_render_max_seconds", "", ds.usMax / 1e6);
+#endif
+
+#if MQTT_UPLINK
+    // MQTT uplink
+    const MqttStats &mq = mqttUplink.stats();
+    w.family("aq_mqtt_connected", "gauge", "1 when the broker session is up");
+    w.sample("aq_mqtt_connected", "", mqttUplink.connected());
+    w.family("aq_mqtt_backlog", "gauge", "Readings queued or awaiting PUBACK");
+    w.sample("aq_mqtt_backlog", "", mqttUplink.backlog());
+    w.family("aq_mqtt_acked", "counter", "Readings acknowledged by the broker");
+    w.sample("aq_mqtt_acked", "_total", mq.acked);
+    w.family("aq_mqtt_dropped", "counter", "Readings lost to a full offline queue");
+    w.sample("aq_mqtt_dropped", "_total", mq.dropped);
+    w.family("aq_mqtt_publishes", "counter", "PUBLISH packets sent");
+    w.sample("aq_mqtt_publishes", "_total", mq.publishes);
+    w.family("aq_mqtt_failures", "counter", "Broker connection failures");
+    w.sample("aq_mqtt_failures", "_total", mq.failures);
+
+#endif
+#if STAGE_TIMING
+    // Stage latency, bucketed at the histogram's octave bounds from 1 us
+    // up.  Ticks are whole, so a bucket's le is the largest tick count in
+    // it, not the next bucket's low bound.
+    w.family("aq_stage_seconds", "histogram", "Time spent in each pipeline stage");
+    double ticksPerSecond = stageTicksPerUs() * 1e6;
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const LatencyHistogram &h = g_Stages[s];
+        uint32_t cumulative = 0;
+        for (int i = 0; i < STAGE_BUCKETS; i++) {
+            cumulative += h.bucket(i);
+            uint32_t le = LatencyHistogram::bucketMax(i);
+            if ((i & 1) && le >= stageTicksPerUs()) {
+                w.bucket("aq_stage_seconds", "stage", kStageNames[s], le / ticksPerSecond, cumulative);
+            }
+        }
+        w.histogramEnd("aq_stage_seconds", "stage", kStageNames[s], h.count(), h.sum() / ticksPerSecond);
+    }
+#endif
+
+    // Task timing
+    w.family("aq_loop_iterations", "counter", "loop() iterations");
+    w.sample("aq_loop_iterations", "_total", g_Counters.loopCount);
+    w.family("aq_loop_seconds", "counter", "Time spent in loop()");
+    w.sample("aq_loop_seconds", "_total", g_Counters.loopTotalUs / 1e6);
+    w.family("aq_loop_max_seconds", "gauge", "Longest single loop() since boot");
+    w.sample("aq_loop_max_seconds", "", g_Counters.loopMaxUs / 1e6);
+    w.family("aq_callback_calls", "counter", "receivedCallback() calls");
+    w.sample("aq_callback_calls", "_total", g_Counters.callbacks);
+    w.family("aq_callback_seconds", "counter", "Time spent in receivedCallback()");
+    w.sample("aq_callback_seconds", "_total", g_Counters.callbackTotalUs / 1e6);
+    w.family("aq_callback_max_seconds", "gauge", "Slowest receivedCallback() since boot");
+    w.sample("aq_callback_max_seconds", "", g_Counters.callbackMaxUs / 1e6);
+    w.family("aq_uptime_seconds", "gauge", "Seconds since boot");
+    w.sample("aq_uptime_seconds", "", now / 1000.0);
+
+    w.finish();
+    server.sendContent("", 0);  // Terminating chunk
+}
+
+#if STAGE_TIMING
+// Handler for /stages: the same table "stages" prints on Serial
+void handleStages() {
+    char report[768];
+    formatStageReport(report, sizeof(report));
+    server.send(200, "text/plain", report);
+}
+#endif
+
+// Handler for /memory: the same report "mem" prints on Serial
+void handleMemory() {
+    char report[1024];
+    formatMemoryReport(report, sizeof(report));
+    server.send(200, "text/plain", report);
+}
+
+// Handler for /events; the socket is handed to the SSE hub and kept open
+void handleEvents() {
+    WiFiClient client = server.client();
+    if (!sseHub.attach(client)) {
+        server.send(503, "text/plain", "Too many subscribers");
+    }
+}
+
+// Start the web server and define the routes
+void startWebServer() {
+    sseHub.setResync("reading", readingRow);
+    server.on("/", handleRoot);  // Serve web page at the root URL
+    server.on("/api/readings", handleJson);  // Serve JSON at /api/readings
+    server.on("/events", handleEvents);  // Live readings as Server-Sent Events
+    server.on("/metrics", handleMetrics);  // Prometheus / OpenMetrics scrape
+    server.on("/memory", handleMemory);  // Heap, JSON allocations and budgets
+#if STAGE_TIMING
+    server.on("/stages", handleStages);  // Stage latency table
+#endif
+    server.begin();
+    Serial.printf("Web server started on port %d\n", WEB_SERVER_PORT);
+}
+
+// Serve HTTP requests and flush queued events; call from loop()
+void updateWebServer() {
+    server.handleClient();
+    sseHub.pump();
+}
@@ -0,0 +1,534 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        bench_main.cpp
+//
+// Description:
+//
+//   Entry point for [env:bench]: host microbenchmarks of the data-path
+//   kernels, reporting ns/op, heap bytes/op and allocations/op.
+//
+//   Each benchmark is warmed up, then run in batches sized to take at
+//   least BENCH_BATCH_NS; the median of BENCH_REPS batches is reported,
+//   with the spread between the fastest and slowest as a check on how
+//   stable the number is.  Allocations are counted by replacing the
+//   global operator new and by giving every JsonDocument a counting
+//   allocator, so they cover std::string, std::map and ArduinoJson.
+//
+//   third.h uses Arduino String, which does not exist on a host; its
+//   sendDatum()/recieveDatum() are reproduced here with std::string, so
+//   short values may fit the small-string buffer and allocate less than
+//   they would on the ESP32.
+//
+//   Build:   pio run -e bench
+//   Usage:   .pio/build/bench/program [--json] [filter]
+//            --json prints one JSON document for regression tracking
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <node_core.h>
+#include <node_table.h>
+#include <pms7003.h>
+#include <serial_frame.h>
+#include <stage_timer.h>
+#include <fixed_point.h>
+#include <history.h>
+#include <ui_pages.h>
+#include <aqi.h>
+#include <outlier_filter.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define BENCH_WARMUP    1000        // Untimed calls before calibrating
+#define BENCH_BATCH_NS  20000000    // Smallest timed batch, 20 ms
+#define BENCH_REPS      7           // Batches per benchmark; the median is reported
+
+//---------------------------------------------------------------------------
+// Allocation counting
+
+static uint64_t g_Allocs = 0;
+static uint64_t g_AllocBytes = 0;
+
+// GCC sees malloc() inside operator new and warns about the free() in
+// operator delete; they are a matched pair here
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(size_t size) {
+    g_Allocs++;
+    g_AllocBytes += size;
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+class CountingJsonAllocator : public ArduinoJson::Allocator {
+public:
+    void *allocate(size_t size) override {
+        g_Allocs++;
+        g_AllocBytes += size;
+        return malloc(size);
+    }
+    void deallocate(void *p) override { free(p); }
+    void *reallocate(void *p, size_t size) override {
+        g_Allocs++;
+        g_AllocBytes += size;
+        return realloc(p, size);
+    }
+};
+
+static CountingJsonAllocator g_JsonAllocator;
+
+//---------------------------------------------------------------------------
+// Harness
+
+struct BenchResult {
+    std::string name;
+    double nsPerOp;     // Median batch
+    double nsMin;
+    double spreadPct;   // (slowest - fastest) / median
+    double bytesPerOp;
+    double allocsPerOp;
+    uint64_t iterations;
+};
+
+static std::vector<BenchResult> g_Results;
+static const char *g_Filter = nullptr;
+
+// Keeps a result alive so the optimizer cannot drop the work behind it
+template <typename T>
+inline void keep(const T &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename Op>
+static void bench(const char *name, Op op) {
+    if (g_Filter && !strstr(name, g_Filter)) {
+        return;
+    }
+    for (int i = 0; i < BENCH_WARMUP; i++) {
+        op();
+    }
+
+    uint64_t batch = 1;
+    for (;;) {
+        uint64_t start = nowNs();
+        for (uint64_t i = 0; i < batch; i++) {
+            op();
+        }
+        if (nowNs() - start >= BENCH_BATCH_NS) {
+            break;
+        }
+        batch *= 2;
+    }
+
+    double samples[BENCH_REPS];
+    uint64_t allocs = g_Allocs, bytes = g_AllocBytes;
+    for (int r = 0; r < BENCH_REPS; r++) {
+        uint64_t start = nowNs();
+        for (uint64_t i = 0; i < batch; i++) {
+            op();
+        }
+        samples[r] = (double)(nowNs() - start) / batch;
+    }
+    uint64_t ops = batch * BENCH_REPS;
+
+    std::sort(samples, samples + BENCH_REPS);
+    BenchResult res;
+    res.name = name;
+    res.nsPerOp = samples[BENCH_REPS / 2];
+    res.nsMin = samples[0];
+    res.spreadPct = (samples[BENCH_REPS - 1] - samples[0]) / res.nsPerOp * 100;
+    res.bytesPerOp = (double)(g_AllocBytes - bytes) / ops;
+    res.allocsPerOp = (double)(g_Allocs - allocs) / ops;
+    res.iterations = ops;
+    g_Results.push_back(res);
+    fprintf(stderr, ".");
+}
+
+//---------------------------------------------------------------------------
+// Fixtures
+
+// Replays one recorded frame on every poll
+class ReplaySerial : public HalSerial {
+public:
+    void load(const uint8_t *data, size_t len) {
+        memcpy(m_data, data, len);
+        m_len = len;
+        m_pos = 0;
+    }
+    void rewind() { m_pos = 0; }
+
+    int available() override { return (int)(m_len - m_pos); }
+    int read() override { return m_pos < m_len ? m_data[m_pos++] : -1; }
+    size_t write(const uint8_t *, size_t len) override { return len; }
+
+private:
+    uint8_t m_data[64];
+    size_t m_len = 0;
+    size_t m_pos = 0;
+};
+
+static size_t makePmsFrame(uint8_t *frame, uint16_t pm1, uint16_t pm25, uint16_t pm10) {
+    memset(frame, 0, 4 + PMS_READING_LEN);
+    frame[0] = 0x42;
+    frame[1] = 0x4D;
+    frame[3] = PMS_READING_LEN;
+    const uint16_t atm[3] = { pm1, pm25, pm10 };
+    for (int i = 0; i < 3; i++) {
+        frame[10 + i * 2] = atm[i] >> 8;
+        frame[11 + i * 2] = (uint8_t)atm[i];
+    }
+    uint16_t sum = 0;
+    for (int i = 0; i < 2 + PMS_READING_LEN; i++) {
+        sum += frame[i];
+    }
+    frame[2 + PMS_READING_LEN] = sum >> 8;
+    frame[3 + PMS_READING_LEN] = (uint8_t)sum;
+    return 4 + PMS_READING_LEN;
+}
+
+static Reading sampleReading() {
+    Reading r = {};
+    r.node = 2882400001u;
+    r.time = 123456;
+    copyValue(r.value[0], "12");
+    copyValue(r.value[1], "35.5");
+    copyValue(r.value[2], "54");
+    copyValue(r.value[3], "71.6");
+    copyValue(r.value[4], "48.2");
+    r.heapFree = 187392;
+    r.heapMin = 160220;
+    r.heapFragPct = 12;
+    return r;
+}
+
+// The same message readingToJson() builds, written with snprintf
+static int writeReadingJson(char *out, size_t size, const Reading &r) {
+    return snprintf(out, size,
+                    "{\"%s\":\"%s\",\"%s\":\"%s\",\"%s\":\"%s\",\"%s\":\"%s\",\"%s\":\"%s\","
+                    "\"heap\":%u,\"heapMin\":%u,\"frag\":%u}",
+                    kReadingKeys[0], r.value[0], kReadingKeys[1], r.value[1], kReadingKeys[2], r.value[2],
+                    kReadingKeys[3], r.value[3], kReadingKeys[4], r.value[4],
+                    r.heapFree, r.heapMin, r.heapFragPct);
+}
+
+// third.h's space-separated datum string, with std::string for String
+struct LegacyDatum {
+    std::string information;
+    std::string datum[5] = { "12", "35.5", "54", "71.6", "48.2" };
+    std::string keys[5] = { "pm1.0", "pm2.5", "pm10.0", "temp", "humidity" };
+    std::map<std::string, std::string> data_map;
+
+    void sendDatum() {
+        std::string full = "";
+        information = full;
+        std::string temp = " ";
+        for (int i = 0; i < 5; i++) {
+            full = full + datum[i];
+            full = full + temp;
+        }
+        information = full;
+    }
+
+    void recieveDatum() {
+        std::string temp = "";
+        std::string del = " ";
+        int index = 0;
+        for (size_t i = 0; i < information.length(); i++) {
+            if (information[i] != del[0]) {
+                temp += information[i];
+            } else {
+                datum[index] = temp;
+                index += 1;
+                temp = "";
+            }
+        }
+        for (int i = 0; i < 5; i++) {
+            std::string word = datum[i];
+            data_map[keys[i]] = word;
+        }
+        for (int i = 0; i < 5; i++) {
+            std::string word = data_map[keys[i]];
+            datum[i] = word;
+        }
+    }
+};
+
+// The same split into fixed fields, in place
+static int splitFields(const char *text, char fields[NODE_VALUES][NODE_VALUE_LEN]) {
+    int n = 0;
+    while (*text && n < NODE_VALUES) {
+        const char *end = strchr(text, ' ');
+        size_t len = end ? (size_t)(end - text) : strlen(text);
+        if (len >= NODE_VALUE_LEN) {
+            len = NODE_VALUE_LEN - 1;
+        }
+        memcpy(fields[n], text, len);
+        fields[n++][len] = '\0';
+        if (!end) {
+            break;
+        }
+        text = end + 1;
+    }
+    return n;
+}
+
+//---------------------------------------------------------------------------
+// Benchmarks
+
+static void benchSensor() {
+    uint8_t frame[PMS_FRAME_MAX];
+    size_t len = makePmsFrame(frame, 8, 12, 15);
+    ReplaySerial port;
+    port.load(frame, len);
+    Pms7003 pms(port);
+    bench("pms/checksum_parse", [&] {
+        port.rewind();
+        keep(pms.poll());
+    });
+}
+
+static void benchMessages() {
+    const Reading r = sampleReading();
+    char msg[256];
+    JsonDocument encodeDoc(&g_JsonAllocator);
+    bench("json/encode_arduinojson", [&] {
+        readingToJson(encodeDoc, r);
+        keep(serializeJson(encodeDoc, msg, sizeof(msg)));
+    });
+    bench("json/encode_arduinojson_new_doc", [&] {
+        JsonDocument doc(&g_JsonAllocator);
+        readingToJson(doc, r);
+        keep(serializeJson(doc, msg, sizeof(msg)));
+    });
+    bench("json/encode_snprintf", [&] {
+        keep(writeReadingJson(msg, sizeof(msg), r));
+    });
+
+    size_t msgLen = writeReadingJson(msg, sizeof(msg), r);
+    JsonDocument decodeDoc(&g_JsonAllocator);
+    Reading out;
+    bench("json/decode_arduinojson", [&] {
+        keep(deserializeJson(decodeDoc, msg, msgLen).code());
+        readingFromJson(decodeDoc, r.node, 0, out);
+        keep(out);
+    });
+
+    WireReading wire = { r.node, r.time, {} };
+    for (int i = 0; i < NODE_VALUES; i++) {
+        wire.value[i] = hundredthsFromText(r.value[i]);
+    }
+    uint8_t frame[FRAME_MAX_ENCODED];
+    bench("wire/encode_binary", [&] {
+        keep(encodeReading(wire, frame));
+    });
+    size_t frameLen = encodeReading(wire, frame);
+    FrameDecoder decoder;
+    WireReading back;
+    bench("wire/decode_binary", [&] {
+        bool done = false;
+        for (size_t i = 0; i < frameLen; i++) {
+            done = decoder.feed(frame[i]);
+        }
+        keep(done && decodeReading(decoder.payload(), decoder.payloadLen(), back));
+    });
+
+    LegacyDatum legacy;
+    bench("legacy/send_datum", [&] {
+        legacy.sendDatum();
+        keep(legacy.information);
+    });
+    legacy.sendDatum();
+    bench("legacy/recieve_datum", [&] {
+        legacy.recieveDatum();
+        keep(legacy.datum[4]);
+    });
+    std::string line = legacy.information;
+    char fields[NODE_VALUES][NODE_VALUE_LEN];
+    bench("legacy/split_fixed_fields", [&] {
+        keep(splitFields(line.c_str(), fields));
+    });
+}
+
+static void benchNodeTable() {
+    static NodeTable table;  // Too big for the stack
+    for (uint32_t id = 1; id <= NODE_TABLE_SIZE; id++) {
+        table.update(id * 7919, id);
+    }
+    uint32_t last = NODE_TABLE_SIZE * 7919;
+    bench("node_table/find_last_of_200", [&] {
+        keep(table.find(last));
+    });
+    bench("node_table/find_missing", [&] {
+        keep(table.find(1));
+    });
+    NodeCore core(table);
+    Reading r = sampleReading();
+    r.node = (NODE_TABLE_SIZE / 2) * 7919;
+    uint32_t now = NODE_TABLE_SIZE;
+    bench("node_core/apply_existing", [&] {
+        keep(core.apply(r, ++now));
+    });
+}
+
+static void benchStats() {
+    LatencyHistogram hist;
+    uint32_t ticks = 12345;
+    bench("stats/histogram_record", [&] {
+        ticks = ticks * 1103515245u + 12345;
+        hist.record(ticks >> 12);
+    });
+    keep(hist.count());
+    bench("stats/histogram_p99", [&] {
+        keep(hist.percentile(0.99));
+    });
+    FixedMean<16> mean;
+    Fixed16 v = Fixed16::fromDecimal(355, 1);
+    bench("stats/fixed_mean_add", [&] {
+        mean.add(v);
+        keep(mean);
+    });
+    HampelFilter<OUTLIER_WINDOW> hampel;
+    uint32_t noise = 1;
+    bench("stats/hampel_push", [&] {
+        noise = noise * 1103515245u + 12345;
+        keep(hampel.push(30 + (noise >> 28)));
+    });
+    History history;
+    uint16_t sample = 0;
+    bench("stats/history_push", [&] {
+        history.push(sample++);
+        keep(history);
+    });
+}
+
+static void benchDisplay() {
+    static NodeTable table;
+    Reading r = sampleReading();
+    NodeCore core(table);
+    for (uint32_t id = 1; id <= 20; id++) {
+        r.node = id;
+        core.apply(r, id);
+    }
+    History trend[3];
+    for (int i = 0; i < HISTORY_SAMPLES; i++) {
+        for (int t = 0; t < 3; t++) {
+            trend[t].push((uint16_t)(100 + (i * 37 + t * 11) % 250));
+        }
+    }
+    UiModel model = {};
+    model.nowMs = 60000;
+    model.selfId = 1;
+    model.meshNodes = 19;
+    for (int i = 0; i < NODE_VALUES; i++) {
+        model.keys[i] = kUiLabels[i];
+        model.suffix[i] = kUiSuffix[i];
+        model.values[i] = core.value(i);
+    }
+    model.nodes = &table;
+    for (int i = 0; i < 3; i++) {
+        model.trend[i] = &trend[i];
+    }
+
+    uint8_t buffer[FB_BYTES];
+    FrameBuffer fb(buffer);
+    bench("display/render_readings", [&] {
+        renderPage(fb, model, PAGE_READINGS);
+        keep(buffer[0]);
+    });
+    bench("display/render_summary", [&] {
+        renderPage(fb, model, PAGE_SUMMARY);
+        keep(buffer[0]);
+    });
+    bench("display/render_trend", [&] {
+        renderPage(fb, model, PAGE_TREND_PM2_5);
+        keep(buffer[0]);
+    });
+
+    char text[FIXED_FORMAT_MAX];
+    uint32_t tenths = 0;
+    bench("format/tenths", [&] {
+        keep(formatTenths(text, tenths++ & 0xFFFF));
+    });
+    Fixed16 f = Fixed16::fromDecimal(355, 1);
+    bench("format/fixed16", [&] {
+        keep(f.format(text, 1));
+    });
+    float fl = 35.5f;
+    bench("format/snprintf_float", [&] {
+        keep(snprintf(text, sizeof(text), "%.1f", fl));
+    });
+    bench("aqi/text_to_aqi", [&] {
+        keep(aqiOverall(tenthsFromText("35.5"), tenthsFromText("54")));
+    });
+}
+
+//---------------------------------------------------------------------------
+// Output
+
+static void printTable() {
+    printf("%-34s %10s %8s %10s %10s %12s\n", "benchmark", "ns/op", "spread%", "B/op", "allocs/op", "iterations");
+    for (const BenchResult &r : g_Results) {
+        printf("%-34s %10.1f %8.1f %10.1f %10.2f %12llu\n", r.name.c_str(), r.nsPerOp, r.spreadPct,
+               r.bytesPerOp, r.allocsPerOp, (unsigned long long)r.iterations);
+    }
+}
+
+static void printJson() {
+    printf("{\"benchmarks\":[");
+    for (size_t i = 0; i < g_Results.size(); i++) {
+        const BenchResult &r = g_Results[i];
+        printf("%s\n{\"name\":\"%s\",\"ns_per_op\":%.2f,\"ns_min\":%.2f,\"spread_pct\":%.1f,"
+               "\"bytes_per_op\":%.2f,\"allocs_per_op\":%.3f,\"iterations\":%llu}",
+               i ? "," : "", r.name.c_str(), r.nsPerOp, r.nsMin, r.spreadPct, r.bytesPerOp, r.allocsPerOp,
+               (unsigned long long)r.iterations);
+    }
+    printf("\n]}\n");
+}
+
+int main(int argc, char **argv) {
+    bool json = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            g_Filter = argv[i];
+        }
+    }
+
+    benchSensor();
+    benchMessages();
+    benchNodeTable();
+    benchStats();
+    benchDisplay();
+    fprintf(stderr, "\n");
+
+    if (json) {
+        printJson();
+    } else {
+        printTable();
+    }
+    return 0;
+}
@@ -0,0 +1,213 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        dutysim_main.cpp
+//
+// Description:
+//
+//   Entry point for [env:dutysim]: runs the LOW_POWER sensor schedule
+//   (include/duty_cycle.h) on virtual time against a VirtualPms7003 and a
+//   gateway on a FakeMesh, and reports where the charge goes, the energy
+//   per reading and the battery life that implies.
+//
+//   Each wake is a fresh DutyCycle and Pms7003 driver, as after the
+//   reset that ends deep sleep; only the DutyState carries over, as RTC
+//   memory does.  The sensor keeps its state between wakes like the real
+//   one, which stays powered and asleep.  Joining the mesh takes a random
+//   time around --join-ms and fails outright --join-fail times in 1000.
+//
+//   The gateway checks the sequence numbers for gaps and compares each
+//   reported pm2.5 with the air at that moment, which shows how much a
+//   shorter --settle-s costs in accuracy.
+//
+//   Build:   pio run -e dutysim
+//   Usage:   .pio/build/dutysim/program [options]
+//            --days N          virtual days to run (7)
+//            --period-s N      wake to wake (300)
+//            --settle-s N      fan settle before reading (30)
+//            --burst N         reads per wake (5)
+//            --join-ms N       typical time to join the mesh (3000)
+//            --join-fail N     wakes per 1000 that never join (20)
+//            --sink HEX        node the readings go to; 0 broadcasts
+//                              (the gateway)
+//            --battery-mah N   capacity for the life estimate (3000)
+//            --seed N          join time and failure seed (1)
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <duty_cycle.h>
+#include <hal_native.h>
+#include <virtual_pms.h>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DUTYSIM_STEP_MS     10
+#define DUTYSIM_BOOT_MS     250     // Reset to setup(), not seen by millis()
+#define DUTYSIM_SENSOR      0x1001
+#define DUTYSIM_GATEWAY     0x1002
+
+struct DutySimOptions {
+    uint32_t days = 7;
+    uint32_t joinMs = 3000;
+    uint32_t joinFailPerMille = 20;
+    uint32_t sink = DUTYSIM_GATEWAY;
+    uint32_t batteryMah = 3000;
+    uint32_t seed = 1;
+    DutyConfig duty;
+};
+
+// What the gateway heard
+struct Gateway {
+    FakeClock *clock;
+    SyntheticProfile *air;
+    JsonDocument json;
+    uint32_t received = 0;
+    uint32_t gaps = 0;              // Sequence numbers never seen
+    uint32_t nextSeq = 0;
+    double errorSum = 0;            // |reported - true| pm2.5
+    double trueSum = 0;
+
+    static void onMessage(void *context, uint32_t, const char *msg, size_t len) {  // Only one sensor sends
+        Gateway &g = *(Gateway *)context;
+        if (deserializeJson(g.json, msg, len)) {
+            return;
+        }
+        uint32_t seq = g.json["seq"].as<uint32_t>();
+        g.gaps += seq > g.nextSeq ? seq - g.nextSeq : 0;
+        g.nextSeq = seq + 1;
+        g.received++;
+        uint16_t pm[3];
+        g.air->sample(g.clock->millis(), pm);
+        double reported = atof(g.json[kReadingKeys[1]].as<const char *>());
+        g.errorSum += reported > pm[1] ? reported - pm[1] : pm[1] - reported;
+        g.trueSum += pm[1];
+    }
+};
+
+static uint32_t nextRandom(uint32_t &x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static void run(const DutySimOptions &opt) {
+    FakeClock clock;
+    FakeMeshBus bus;
+    FakeMesh nodeMesh(bus, DUTYSIM_SENSOR);
+    FakeMesh gatewayMesh(bus, DUTYSIM_GATEWAY);
+    SyntheticProfile air;
+    air.eventPeak = 150;
+    air.eventEveryMs = 2 * VPMS_DAY_MS;
+    air.eventOffsetMs = 19 * 3600000u;
+    VirtualPms7003 sensor(clock, air);
+    Gateway gateway;
+    gateway.clock = &clock;
+    gateway.air = &air;
+    gatewayMesh.onReceive(Gateway::onMessage, &gateway);
+
+    DutyState rtc;
+    memset(&rtc, 0xA5, sizeof(rtc));  // Power-up garbage
+    uint32_t random = opt.seed ? opt.seed : 1;
+    uint64_t endMs = (uint64_t)opt.days * VPMS_DAY_MS;
+    uint64_t awakeMs = 0;
+
+    while (clock.millis() < endMs) {
+        clock.advanceMs(DUTYSIM_BOOT_MS);
+        uint32_t resetMs = clock.millis() - DUTYSIM_BOOT_MS;
+        Pms7003 pms(sensor);
+        DutyCycle duty(pms, nodeMesh, rtc, opt.duty);
+        duty.begin(DUTYSIM_BOOT_MS, opt.sink);
+
+        uint32_t joinAt = UINT32_MAX;
+        for (;;) {
+            uint32_t now = clock.millis() - resetMs;
+            if (now >= joinAt) {
+                duty.linkUp();
+                joinAt = UINT32_MAX;
+            }
+            DutyAction action = duty.step(now);
+            gatewayMesh.update();
+            if (action == DUTY_SLEEP_NOW) {
+                awakeMs += now;
+                clock.advanceMs(duty.sleepMs(now));
+                break;
+            }
+            if (action == DUTY_RADIO_ON && nextRandom(random) % 1000 >= opt.joinFailPerMille) {
+                joinAt = now + opt.joinMs / 2 + nextRandom(random) % opt.joinMs;  // joinMs +/- 50%
+            }
+            uint32_t wait = std::min(duty.msUntilNext(now), joinAt - now);
+            clock.advanceMs(std::max<uint32_t>(DUTYSIM_STEP_MS, wait / DUTYSIM_STEP_MS * DUTYSIM_STEP_MS));
+        }
+    }
+
+    const DutyState &s = rtc;
+    uint64_t totalMs = dutyTotalMs(s);
+    uint64_t charge = dutyTotalCharge(s);
+    printf("%u wakes over %u days, %u sent, %u failed, %u empty bursts, %u reads\n", s.cycles, opt.days,
+           s.sent, s.sendFailures, s.emptyBursts, s.readings);
+    printf("gateway: %u received, %u missing by sequence number", gateway.received, gateway.gaps);
+    if (gateway.received) {
+        printf(", pm2.5 off by %.1f%% on average", 100.0 * gateway.errorSum / std::max(gateway.trueSum, 1.0));
+    }
+    printf("\nsink %x, %.1f s awake per wake\n\n", s.sinkNode, s.cycles ? awakeMs / 1000.0 / s.cycles : 0.0);
+
+    printf("%-8s %10s %7s %8s %12s %7s\n", "phase", "current", "time", "", "charge", "");
+    for (int i = 0; i < DUTY_PHASE_COUNT; i++) {
+        printf("%-8s %7.1f mA %6.0f s %7.3f%% %9.1f mAh %6.1f%%\n", kDutyPhaseNames[i], opt.duty.phaseUa[i] / 1000.0,
+               s.phaseMs[i] / 1000.0, totalMs ? 100.0 * s.phaseMs[i] / totalMs : 0.0,
+               s.chargeUaMs[i] / 3.6e9, charge ? 100.0 * s.chargeUaMs[i] / charge : 0.0);
+    }
+    uint32_t hours = dutyBatteryHours(s, opt.batteryMah);
+    printf("\naverage %.3f mA, %.1f mJ per reading at %.1f V\n", dutyAverageUa(s) / 1000.0,
+           dutyEnergyPerReadingUj(s) / 1000.0, DUTY_SUPPLY_MV / 1000.0);
+    printf("%u mAh lasts %u days (%.1f with sensor and radio always on)\n", opt.batteryMah, hours / 24,
+           opt.batteryMah / ((opt.duty.phaseUa[DUTY_SAMPLE] + opt.duty.phaseUa[DUTY_RADIO]) / 1000.0) / 24);
+}
+
+static bool parseArgs(int argc, char **argv, DutySimOptions &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *arg = argv[i];
+        uint32_t value = strtoul(argv[i + 1], nullptr, strcmp(arg, "--sink") == 0 ? 16 : 0);
+        if (strcmp(arg, "--days") == 0) {
+            opt.days = value;
+        } else if (strcmp(arg, "--period-s") == 0) {
+            opt.duty.periodMs = value * 1000;
+        } else if (strcmp(arg, "--settle-s") == 0) {
+            opt.duty.settleMs = value * 1000;
+        } else if (strcmp(arg, "--burst") == 0) {
+            opt.duty.burst = (uint8_t)value;
+        } else if (strcmp(arg, "--join-ms") == 0) {
+            opt.joinMs = value;
+        } else if (strcmp(arg, "--join-fail") == 0) {
+            opt.joinFailPerMille = value;
+        } else if (strcmp(arg, "--sink") == 0) {
+            opt.sink = value;
+        } else if (strcmp(arg, "--battery-mah") == 0) {
+            opt.batteryMah = value;
+        } else if (strcmp(arg, "--seed") == 0) {
+            opt.seed = value;
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.days > 0 && opt.days < 49 && opt.joinMs > 0 && opt.duty.burst > 0 &&
+           opt.duty.burst <= 100;
+}
+
+int main(int argc, char **argv) {
+    DutySimOptions opt;
+    if (!parseArgs(argc, argv, opt)) {
+        fprintf(stderr, "usage: %s [--days N] [--period-s N] [--settle-s N] [--burst N] [--join-ms N] "
+                        "[--join-fail N] [--sink HEX] [--battery-mah N] [--seed N]\n",
+                argv[0]);
+        return 2;
+    }
+    run(opt);
+    return 0;
+}
@@ -11,15 +11,43 @@
 // History:     Sep-30-2024     cfl429      Created
 //---------------------------------------------------------------------------
 
+#include <node_role.h>  // First: the feature flags below depend on NODE_ROLE
 #include <Arduino.h>
+#if OLED_DISPLAY
 #include <U8g2lib.h>  // For text on the OLED
+#endif
+#if STATUS_LEDS
 #include <FastLED.h>  // FastLED library for controlling LEDs
+#endif
 #include <painlessMesh.h>  // Mesh networking library
 #include <iostream>
 #include <HardwareSerial.h>
 #include <ArduinoJson.h>
 #include <TaskScheduler.h>
 #include <math.h>
+#include <hal_esp32.h>
+#include <node_table.h>
+#include <node_core.h>
+#include <serial_frame.h>
+#include <oled_view.h>
+#include <ui_pages.h>
+#include <led_status.h>
+#include <acquisition.h>
+#include <stage_timer.h>
+#include <binlog.h>
+#include <mem_telemetry.h>
+#include <boot_state.h>
+#include <esp_system.h>
+#include <duty_cycle.h>
+#include <adaptive_rate.h>
+#include <conditioning.h>
+#include <esp_sleep.h>
+#include <spsc_queue.h>
+#include <mpsc_queue.h>
+#if MQTT_UPLINK
+#include <WiFi.h>
+#include <mqtt_uplink.h>
+#endif
 
 // Constants for OLED and LEDs
 #define OLED_CLOCK  15          
@@ -27,202 +55,1264 @@
 #define OLED_RESET  16
 #define LED_PIN     5
 #define NUM_LEDS    5
+#define UI_BUTTON_PIN 0         // PRG button, steps to the next page
 
+Esp32Clock g_Clock;
+#if STATUS_LEDS
 CRGB g_LEDs[NUM_LEDS] = {0};  // Frame buffer for FastLED
+FastLedStrip ledStrip(g_LEDs);
+LedStatus<NUM_LEDS> ledStatus;  // One LED per reading value
+#endif
+#define LED_TICK_MS 20  // Fade step interval
 
 // Mesh network settings
 #define MESH_PREFIX "esp32_mesh"
 #define MESH_PASSWORD "mesh_password"
 #define MESH_PORT 5555
 
-// OLED Display object
-U8G2_SSD1306_128X64_NONAME_F_HW_I2C g_OLED(U8G2_R2, OLED_RESET, OLED_CLOCK, OLED_DATA);
+// Web dashboard (needs a WiFi station to join; set these from build_flags).
+// WEB_DASHBOARD and MQTT_UPLINK default from NODE_ROLE.
+#ifndef STATION_SSID
+#define STATION_SSID "your_ssid"
+#endif
+#ifndef STATION_PASSWORD
+#define STATION_PASSWORD "your_password"
+#endif
+#define HOSTNAME "aq_gateway"
+
+// MQTT uplink for gateway nodes (also needs the WiFi station above)
+#ifndef MQTT_BROKER
+#define MQTT_BROKER "192.168.1.10"
+#endif
+#ifndef MQTT_BROKER_PORT
+#define MQTT_BROKER_PORT 1883
+#endif
+#define MQTT_TOPIC_PREFIX "aq/node"
+
+#define USE_STATION (WEB_DASHBOARD || MQTT_UPLINK)
+
+// Binary reading stream to tools/collector instead of text logging
+#ifndef SERIAL_BRIDGE
+#define SERIAL_BRIDGE 0
+#endif
+#define SERIAL_BRIDGE_BAUD 921600
+#define SERIAL_TX_BUFFER 1024  // Room for log lines and frames between drains
+
+// 1 turns on every painlessMesh debug category (synchronous Serial output)
+#ifndef MESH_DEBUG
+#define MESH_DEBUG 0
+#endif
+#define LOG_DRAIN_MS 20  // How often queued log records go out
+
+// Start without waiting for a serial host, and put the last values and
+// node table back from RTC memory or flash so the first broadcast
+// already carries data.  0 waits for Serial and starts empty.
+#ifndef FAST_BOOT
+#define FAST_BOOT 1
+#endif
+#define BOOT_RTC_SAVE_MS    10000       // RTC copy; costs a CRC over ~600 bytes
+#define BOOT_FLASH_SAVE_MS  900000      // NVS copy, rarely, for flash wear
+#define BOOT_STATE_KEY      "boot"
+
+// Mesh on one core, acquisition and output on the other.  0 runs the same
+// steps one after another from loop(), for comparisons.
+#ifndef DUAL_CORE
+#define DUAL_CORE 1
+#endif
+#define MESH_CORE 0             // Shares the core with the WiFi driver
+#define APP_CORE 1              // Where Arduino's loop() runs
+
+// PMS7003 on Serial2, sampled in passive mode on a fixed period.  GPIO16
+// is also OLED_RESET on the Heltec board, so a node with a sensor wired
+// up sets PMS_SENSOR (on by default for ROLE_SENSOR) and the pins it
+// actually uses.
+#ifndef PMS_RX_PIN
+#define PMS_RX_PIN 16
+#endif
+#ifndef PMS_TX_PIN
+#define PMS_TX_PIN 17
+#endif
+#ifndef PMS_SAMPLE_PERIOD_MS
+#define PMS_SAMPLE_PERIOD_MS 2000
+#endif
+static_assert(PMS_SAMPLE_PERIOD_MS >= 1000, "The PMS7003 updates about once a second; faster reads repeat values");
+
+// Sample and report faster when pm2.5 is high or moving and slower in
+// clean, steady air (include/adaptive_rate.h).  0 keeps
+// PMS_SAMPLE_PERIOD_MS and REPORT_PERIOD_MS.  Every node's broadcasts
+// stay within its airtime budget either way.
+#ifndef ADAPTIVE_RATE
+#define ADAPTIVE_RATE 1
+#endif
+#define REPORT_PERIOD_MS 10000  // Broadcasts from nodes without an adaptive sensor
+
+// Correct this node's PMS7003 values before they are used or sent, with
+// the model and coefficients in flash under CAL_STORAGE_KEY (set with
+// the "cal" serial command; include/calibration.h).  The sensor's own
+// values go out alongside.  The defaults leave the values unchanged.
+#ifndef CALIBRATION
+#define CALIBRATION 1
+#endif
+// Check this node's sensor values for spikes first, with a Hampel
+// identifier per channel (include/outlier_filter.h).  Spikes are flagged
+// in the reading and, with OUTLIER_REPLACE, swapped for the window median.
+#ifndef OUTLIER_FILTER
+#define OUTLIER_FILTER 1
+#endif
+#ifndef OUTLIER_REPLACE
+#define OUTLIER_REPLACE 1
+#endif
+// Then smooth them last, per channel, so the OLED and LEDs don't flicker
+// between categories: SMOOTH_MODE (EMA or Kalman) with a time constant of
+// SMOOTH_LATENCY_MS (include/smoothing.h).  The sensor's own values go
+// out alongside.
+#ifndef SMOOTHING
+#define SMOOTHING 1
+#endif
+#define CAL_STORAGE_KEY "cal"
+
+// Battery sensor node: deep sleep between short wakes that read a burst
+// from the PMS7003 and send one message (include/duty_cycle.h).  setup()
+// and loop() then run a single wake and nothing else here starts.
+#ifndef LOW_POWER
+#define LOW_POWER 0
+#endif
+#ifndef DUTY_SINK_NODE
+#define DUTY_SINK_NODE 0            // Mesh node id of the gateway; 0 broadcasts
+#endif
+#define DUTY_LIGHT_SLEEP_MS 50      // Shorter idle gaps aren't worth a light sleep
+static_assert(!LOW_POWER || (kHasSensor && !kHasOled && !kHasLeds && !kHasWeb && !kHasMqtt && !SERIAL_BRIDGE),
+              "LOW_POWER is for the sensor role without a bridge");
+
+#if OLED_DISPLAY
+// OLED Display object.  R0 plus the controller's flip mode shows the same
+// way up as U8G2_R2, but keeps the buffer in the layout pages draw into.
+U8G2_SSD1306_128X64_NONAME_F_HW_I2C g_OLED(U8G2_R0, OLED_RESET, OLED_CLOCK, OLED_DATA);
 int g_lineHeight = 0;
+U8g2Display oledPanel(g_OLED);
+OledView oledView(oledPanel, g_Clock);  // Only sends tile rows that changed
+#endif
+#define DISPLAY_MAX_FPS 5  // Cap on OLED redraws per second
+#ifndef DISPLAY_DIRECT
+#define DISPLAY_DIRECT 0  // 1 = render inside the callers, for before/after comparisons
+#endif
+bool g_DisplayDirty = false;  // Values changed since the last frame
+#define UI_PAGE_MS 5000  // Pages advance on their own this often
+int g_Page = PAGE_READINGS;
+int g_NodeIndex = 0;  // Node carousel position
+unsigned long g_PageSince = 0;
+unsigned long g_LastRender = 0;
+bool g_ButtonWasDown = false;
+#if OLED_DISPLAY
+History g_Trend[3];  // Recent pm1.0, pm2.5, pm10.0 in tenths, of g_TrendNode
+uint32_t g_TrendNode = 0;  // 0 until chosen by sampleHistory()
+#endif
 int g_Brightness = 255;  // LED brightness scale
 int g_PowerLimit = 3000;  // Power Limit for LEDs in milliWatts
 
-// Variables to store the last 5 messages
-const char * keys[5] = {"PM 1.0", "PM 2.5", "PM 10.0", "Temperature", "Humidity"};  // Keys for the data_map (these match the data positions in datum)
-String datum[5] = {"2", "2", "2", "2", "2"};  // pm1.0, pm2.5, pm10.0, temp, hum
-String suf[5] = {"ppm", "ppm", "ppm", "F", "%"};  // pm1.0, pm2.5, pm10.0, temp, hum
-JsonDocument jsonReadings;
-int runTry = 0;
-int numTry = 0;
+// Names and units of the five values: pm1.0, pm2.5, pm10.0, temp, hum
+const char *const *keys = kReadingKeys;  // Also the mesh message keys
+const char *const *suf = kUiSuffix;
+MemTagStats g_MemTags[MEM_TAG_COUNT];  // Heap use by JSON documents, per owner
+TaggedJsonAllocator meshJsonAllocator(g_MemTags[MEM_TAG_JSON_MESH]);
+JsonDocument jsonReadings(&meshJsonAllocator);
+
+// Latest readings from every node, this one included
+NodeTable nodeTable;
+NodeCore nodeCore(nodeTable);  // Current values; app core only
+
+// Counters exported on /metrics
+struct Counters {
+    uint32_t meshReceived;      // Readings received from other nodes
+    uint32_t meshParseErrors;   // Messages that were not valid JSON
+    uint32_t meshSent;          // Broadcasts sent by this node
+    uint32_t sensorFrames;      // Valid PMS7003 frames
+    uint32_t sensorBadFrames;   // Frames with a bad header or checksum
+    uint32_t loopCount;         // loop() iterations
+    uint64_t loopTotalUs;       // Time spent in loop()
+    uint32_t loopMaxUs;         // Longest single loop()
+    uint32_t displayRequests;   // displayMessages() calls
+    uint32_t displayCoalesced;  // Requests folded into an already pending frame
+    uint32_t callbacks;         // receivedCallback() calls
+    uint64_t callbackTotalUs;   // Time spent in receivedCallback()
+    uint32_t callbackMaxUs;
+    uint32_t bridgeFrames;      // Frames written to the serial bridge
+    uint32_t bridgeDropped;     // Frames skipped because the UART was backed up
+    uint32_t ledShows;          // FastLED.show() calls
+    uint32_t meshDropped;       // Received readings lost to a full queue
+    uint32_t sensorDropped;     // Sensor readings lost to a full queue
+    uint32_t heapAlerts;        // Times the heap went low or fragmented
+    uint32_t meshThrottled;     // Broadcasts put off by the airtime budget
+} g_Counters = {};
+int g_MeshNodes = 0;  // Nodes reachable, refreshed on connection changes
+BinLog g_Log;  // LOG_*() records, drained by taskDrainLog
+HeapSnapshot g_Heap = {};  // Refreshed by checkHeap(); app core
+bool g_HeapAlert = false;
+BootTimeline g_Boot;  // setup() phases; first connection and broadcast on the mesh task
+NvsStorage g_Storage;  // Boot state and calibration
+#if FAST_BOOT
+RTC_NOINIT_ATTR BootState g_RtcState;  // Kept across every reset but power-on
+BootSource g_BootSource = BOOT_SOURCE_NONE;
+uint32_t g_BootRestored = 0;  // Nodes put back in the table, this one included
+uint32_t g_Boots = 1;  // Starts since the state was first saved
+#endif
+
+#if STAGE_TIMING
+// Per-stage latency; read with "stages" on Serial or GET /stages
+enum Stage {
+    STAGE_SENSOR,       // acquireStep()
+    STAGE_JSON_ENCODE,  // readingsToJSON()
+    STAGE_MESH_SEND,    // mesh.sendBroadcast()
+    STAGE_JSON_DECODE,  // deserializeJson() in receivedCallback()
+    STAGE_PROCESS,      // One reading through processReadings()
+    STAGE_DISPLAY,      // displayMessages()
+    STAGE_RENDER,       // A frame drawn and sent by renderDisplay()
+    STAGE_COUNT
+};
+const char *const kStageNames[STAGE_COUNT] = {
+    "sensor_read", "json_encode", "mesh_send", "json_decode", "process", "display_request", "render"
+};
+LatencyHistogram g_Stages[STAGE_COUNT];
+
+// Writes a table of count, mean and percentiles in microseconds
+int formatStageReport(char *out, size_t size) {
+    double perUs = stageTicksPerUs();
+    int len = snprintf(out, size, "%-16s %8s %9s %9s %9s %9s %9s\n",
+                       "stage", "count", "mean_us", "p50_us", "p90_us", "p99_us", "max_us");
+    for (int i = 0; i < STAGE_COUNT && len < (int)size; i++) {
+        const LatencyHistogram &h = g_Stages[i];
+        double mean = h.count() ? h.sum() / perUs / h.count() : 0;
+        len += snprintf(out + len, size - len, "%-16s %8u %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                        kStageNames[i], h.count(), mean, h.percentile(0.5) / perUs,
+                        h.percentile(0.9) / perUs, h.percentile(0.99) / perUs, h.max() / perUs);
+    }
+    return len < (int)size ? len : (int)size - 1;
+}
+#endif
+
+#if MQTT_UPLINK
+WiFiClient mqttClient;
+char mqttClientId[24];  // "aq-<nodeId>", filled in by setup()
+MqttUplink mqttUplink(mqttClient, MQTT_BROKER, MQTT_BROKER_PORT, mqttClientId, MQTT_TOPIC_PREFIX);
+#endif
 
 //String to send to other nodes with sensor readings
 String readings;
 
-Scheduler userScheduler;  // Task scheduler for painlessMesh
+Scheduler userScheduler;  // Task scheduler for painlessMesh; mesh task only
+Scheduler appScheduler;  // Display, LED and history tasks; app core only
 painlessMesh mesh;
+PainlessMeshLink meshLink(mesh);  // Readings in and out; connection events use mesh directly
+uint32_t g_NodeId = 0;  // Set once in setup(), before the tasks start
+
+// Mesh and acquisition tasks -> processing on the app core
+MpscQueue<Reading, 16> g_ToProcess;
+// App core -> mesh task: snapshots of the current values for the next broadcast
+SpscQueue<Reading, 4> g_ToMesh;
+Reading g_Broadcast = {};  // What sendMessage() sends; mesh task only
 
 // PMS7003 Serial Communication
-HardwareSerial pmsSerial(2);  // Use Serial2 for PMS7003 (TX=17, RX=16)
-// PMS7003 Constants
-#define FRAME_LENGTH 32  // PMS7003 sends 32-byte data frame
+HardwareSerial pmsSerial(2);  // Use Serial2 for PMS7003
+StreamSerial pmsPort(pmsSerial);
+Pms7003 pms(pmsPort);
+Acquisition acquisition(pms, PMS_SAMPLE_PERIOD_MS);
+#if PMS_SENSOR && ADAPTIVE_RATE
+AdaptiveRate adaptiveRate;  // Acquisition side only
+#endif
+#if PMS_SENSOR && (OUTLIER_FILTER || CALIBRATION || SMOOTHING)
+SensorConditioner g_Conditioner((OUTLIER_FILTER ? CONDITION_OUTLIERS : 0) | (OUTLIER_REPLACE ? CONDITION_REPLACE : 0) |
+                                (CALIBRATION ? CONDITION_CALIBRATE : 0) | (SMOOTHING ? CONDITION_SMOOTH : 0));  // App core only
+#endif
+#if PMS_SENSOR && CALIBRATION
+Calibrator &calibrator = g_Conditioner.calibrator();
+#endif
+AirtimeBudget g_Airtime;  // Mesh task only
+uint32_t g_ReportMs = REPORT_PERIOD_MS;  // Broadcast interval asked for; mesh task
+uint32_t g_SampleMs = 0;  // Own sensor period, for the metadata; mesh task
+uint32_t g_LastSentMs = 0;
+#if LOW_POWER
+RTC_NOINIT_ATTR DutyState g_DutyState;  // Sequence, sink and charge across deep sleep
+DutyCycle dutyCycle(pms, meshLink, g_DutyState);
+bool g_MeshStarted = false;
+#endif
 
-// Function to update the OLED with the last 4 messages
-void displayMessages() {
-    g_OLED.clearBuffer();  // Clear the screen
+#if OLED_DISPLAY
+// Moves to the next page; each visit to the node page shows the next node
+void nextPage(unsigned long now) {
+    g_Page = (g_Page + 1) % PAGE_COUNT;
+    if (g_Page == PAGE_NODE) {
+        g_NodeIndex++;
+    }
+    g_PageSince = now;
+}
+
+// Draws the current page on the OLED; runs from taskRenderDisplay
+void renderDisplay() {
+    unsigned long now = millis();
+    bool pageChanged = false;
+
+    bool buttonDown = digitalRead(UI_BUTTON_PIN) == LOW;
+    if ((buttonDown && !g_ButtonWasDown) || now - g_PageSince >= UI_PAGE_MS) {
+        nextPage(now);
+        pageChanged = true;
+    }
+    g_ButtonWasDown = buttonDown;
+
+    // Redraw on new data, a page change, or once a second for ages and trends
+    if (!g_DisplayDirty && !pageChanged && now - g_LastRender < 1000) {
+        return;
+    }
+    g_DisplayDirty = false;
+    g_LastRender = now;
+    STAGE_TIMER(g_Stages[STAGE_RENDER]);
+
+    UiModel model;
+    model.nowMs = now;
+    model.selfId = mesh.getNodeId();
+    model.meshNodes = g_MeshNodes;
+    model.received = g_Counters.meshReceived;
+    model.parseErrors = g_Counters.meshParseErrors;
     for (int i = 0; i < 5; i++) {
-        g_OLED.setCursor(0, g_lineHeight * (i + 1));  // Display each message on a new line
-        g_OLED.printf("%s: %s %s", keys[i], datum[i].c_str(), suf[i].c_str());
+        model.keys[i] = kUiLabels[i];  // Short enough for the screen
+        model.suffix[i] = suf[i];
+        model.values[i] = nodeCore.value(i);
+    }
+    model.nodes = &nodeTable;
+    model.nodeIndex = g_NodeIndex;
+    for (int i = 0; i < 3; i++) {
+        model.trend[i] = &g_Trend[i];
     }
-    g_OLED.sendBuffer();  // Send the updated buffer to the OLED
+
+    oledView.beginFrame();
+    FrameBuffer fb = oledView.frame();
+    renderPage(fb, model, g_Page);
+    oledView.present();  // Sends only the tile rows that changed
 }
 
-void readPMS7003Data();
+// Samples the PM values shown for the trend pages from one node's table
+// entry, so the history never mixes nodes: this node's own if it has a
+// sensor, otherwise the first node heard from
+void sampleHistory() {
+    if (!g_TrendNode) {
+        g_TrendNode = kHasSensor ? g_NodeId : nodeTable.size() ? nodeTable.at(0).nodeId : 0;
+    }
+    const NodeEntry *e = nodeTable.find(g_TrendNode);
+    if (!e) {
+        return;  // No reading yet, or evicted; the pages say "Collecting..."
+    }
+    for (int i = 0; i < 3; i++) {
+        g_Trend[i].push(tenthsFromText(e->value[i]));
+    }
+}
+
+// 120 samples at 10 s is the last 20 minutes
+Task taskSampleHistory(TASK_SECOND * 10, TASK_FOREVER, &sampleHistory);
 
-void runOn(int num) {
-    if (runTry > num) {
-        runTry = 0;
+// Redraws the OLED at most DISPLAY_MAX_FPS times a second
+Task taskRenderDisplay(TASK_SECOND / DISPLAY_MAX_FPS, TASK_FOREVER, &renderDisplay);
+#endif
+
+#if STATUS_LEDS
+// Points each status LED at the level of its reading value
+void updateLedLevels() {
+    const char *values[NODE_VALUES];
+    for (int i = 0; i < NODE_VALUES; i++) {
+        values[i] = nodeCore.received(i);  // The "2" placeholder isn't a reading
     }
-    if (runTry < num) {
-        runTry += 1;
-    } else {
-        readPMS7003Data();
-        runTry += 1;
+    ledShowReadings(ledStatus, values);
+}
+
+// Steps LED fades and blinks; only pushes pixels out when one changed
+void updateLEDs() {
+    if (ledStatus.tick(millis())) {
+        ledStrip.show(ledStatus.pixels(), NUM_LEDS);
+        g_Counters.ledShows++;
     }
 }
 
-// Function to read data from PMS7003 and store in datum array
-void readPMS7003Data() {
-    if (pmsSerial.available() >= FRAME_LENGTH) {
-        uint8_t buffer[FRAME_LENGTH];
-        pmsSerial.readBytes(buffer, FRAME_LENGTH);
+Task taskUpdateLEDs(LED_TICK_MS, TASK_FOREVER, &updateLEDs);
+#endif
 
-        // Verify frame start bytes and checksum
-        if (buffer[0] == 0x42 && buffer[1] == 0x4d) {
-            uint16_t checksum = 0;
-            for (int i = 0; i < FRAME_LENGTH - 2; i++) {
-                checksum += buffer[i];
-            }
-            uint16_t frameChecksum = (buffer[30] << 8) | buffer[31];
-            if (checksum == frameChecksum) {
-                // Extract PM1.0, PM2.5, and PM10.0 values
-                uint16_t pm1_0 = (buffer[10] << 8) | buffer[11];
-                uint16_t pm2_5 = (buffer[12] << 8) | buffer[13];
-                uint16_t pm10_0 = (buffer[14] << 8) | buffer[15];
-
-                // Store the values in the datum array
-                datum[0] = String(pm1_0);
-                datum[1] = String(pm2_5);
-                datum[2] = String(pm10_0);
-
-                displayMessages();  // Update OLED with new values
-            }
-        }
+// Function to update the OLED with the last 5 messages.  Only marks the
+// screen dirty, so a burst of updates between frames costs one redraw.
+// The status LEDs follow the same readings.  Does nothing on roles with
+// neither.
+void displayMessages() {
+    STAGE_TIMER(g_Stages[STAGE_DISPLAY]);
+#if STATUS_LEDS
+    updateLedLevels();
+#endif
+#if OLED_DISPLAY
+    g_Counters.displayRequests++;
+    if (g_DisplayDirty) {
+        g_Counters.displayCoalesced++;
+    }
+    g_DisplayDirty = true;
+#if DISPLAY_DIRECT
+    renderDisplay();
+#endif
+#endif
+}
+
+// Times receivedCallback() from entry to whichever return it takes
+struct CallbackTimer {
+    unsigned long start = micros();
+    ~CallbackTimer() {
+        uint32_t elapsed = micros() - start;
+        g_Counters.callbacks++;
+        g_Counters.callbackTotalUs += elapsed;
+        g_Counters.callbackMaxUs = max(g_Counters.callbackMaxUs, elapsed);
+    }
+};
+
+#if SERIAL_BRIDGE
+// Writes one reading to the collector; drops it rather than block on the UART
+void sendBridgeFrame(const NodeEntry &entry) {
+    WireReading r;
+    r.node = entry.nodeId;
+    r.time = entry.lastSeen;
+    for (int i = 0; i < NODE_VALUES; i++) {
+        r.value[i] = hundredthsFromText(entry.value[i]);
+    }
+    uint8_t frame[FRAME_MAX_ENCODED];
+    size_t len = encodeReading(r, frame);
+    if (Serial.availableForWrite() < (int)len) {
+        g_Counters.bridgeDropped++;
+        return;
+    }
+    Serial.write(frame, len);
+    g_Counters.bridgeFrames++;
+}
+#endif
+
+// Makes a reading current, files it in the node table and hands the
+// entry to the uplinks; returns the entry
+NodeEntry *storeReading(const Reading &r) {
+    NodeEntry *entry = nodeCore.apply(r, millis());
+#if MQTT_UPLINK
+    mqttUplink.enqueue(*entry);  // Held until the broker acknowledges it
+#endif
+#if SERIAL_BRIDGE
+    sendBridgeFrame(*entry);
+#endif
+    return entry;
+}
+
+#if WEB_DASHBOARD
+void publishReading(const NodeEntry &e);  // Defined in web_dashboard.h
+#endif
+
+// Acquisition stage: asks the sensor for a reading each sample period
+// and queues it for the app core.  Returns how long it can sleep.
+uint32_t acquireStep() {
+    STAGE_TIMER(g_Stages[STAGE_SENSOR]);
+    uint32_t now = millis();
+    bool ready = acquisition.step(now, micros());
+    g_Counters.sensorBadFrames = pms.badFrames();
+    if (!ready) {
+        return acquisition.msUntilNext(now);
+    }
+    g_Counters.sensorFrames++;
+    const PmsReading &pm = acquisition.reading();
+    LOG_DEBUG(SENSOR, LOG_SENSOR_READING, pm.pm1_0, pm.pm2_5, pm.pm10_0);
+#if PMS_SENSOR && ADAPTIVE_RATE
+    if (adaptiveRate.update(now, pm.pm2_5)) {
+        acquisition.setPeriod(adaptiveRate.sampleMs(), now);
+        LOG_INFO(SENSOR, LOG_RATE_TIER, adaptiveRate.tier(), adaptiveRate.sampleMs(), adaptiveRate.reportMs(),
+                 pm.pm2_5);
     }
+    uint32_t reportMs = adaptiveRate.reportMs();
+#else
+    uint32_t reportMs = REPORT_PERIOD_MS;
+#endif
+
+    // Hand the values to the app core; nodeCore is only touched there
+    size_t ticket;
+    Reading *r = g_ToProcess.claim(ticket);
+    if (!r) {
+        g_Counters.sensorDropped++;
+        LOG_WARN(SENSOR, LOG_QUEUE_FULL, 1);
+        return acquisition.msUntilNext(now);
+    }
+    r->node = g_NodeId;
+    r->time = now;
+    formatUint(r->value[0], pm.pm1_0);
+    formatUint(r->value[1], pm.pm2_5);
+    formatUint(r->value[2], pm.pm10_0);
+    r->value[3][0] = '\0';  // No temperature or humidity on this sensor
+    r->value[4][0] = '\0';
+    r->heapFree = 0;  // processReadings() fills in this node's own
+    r->flags = 0;  // processReadings() filters, calibrates and smooths; the values above are the sensor's
+    r->rawPm[0] = pm.pm1_0;
+    r->rawPm[1] = pm.pm2_5;
+    r->rawPm[2] = pm.pm10_0;
+    r->reportMs = reportMs;  // The interval wanted; sendMessage() puts in the one achieved
+    r->sampleMs = acquisition.periodMs();
+    g_ToProcess.publish(ticket);
+    return acquisition.msUntilNext(now);
 }
 
 // User stub
 void sendMessage() ; // Prototype so PlatformIO doesn't complain
 String getReadings(); // Prototype for sending sensor readings
 
-// Periodic task to send a message
-Task taskSendMessage(TASK_SECOND * 10 , TASK_FOREVER, &sendMessage);
+// Periodic task to send a message; meshStep() moves the interval to g_ReportMs
+Task taskSendMessage(REPORT_PERIOD_MS, TASK_FOREVER, &sendMessage);
 
 String readingsToJSON () {
-    for (int i = 0; i < 5; i++) {
-        jsonReadings[keys[i]] = datum[i];
-    }
-    
+    STAGE_TIMER(g_Stages[STAGE_JSON_ENCODE]);
+    // Health fields, so a gateway can watch every node's heap
+    HeapSnapshot heap = readHeap();
+    g_Broadcast.heapFree = heap.free;
+    g_Broadcast.heapMin = heap.minFree;
+    g_Broadcast.heapFragPct = heap.fragPct;
+    // The rate this node actually reports at, so receivers know how
+    // fresh its values are; g_LastSentMs is 0 before the first send
+    uint32_t now = millis();
+    g_Broadcast.reportMs = g_LastSentMs ? now - g_LastSentMs : g_ReportMs;
+    g_Broadcast.sampleMs = g_SampleMs;
+    readingToJson(jsonReadings, g_Broadcast);
     serializeJson(jsonReadings, readings);
     return readings;
 }
 
 void sendMessage () {
     String msg = readingsToJSON();
-    mesh.sendBroadcast(msg);
+    uint32_t now = millis();
+    if (!g_Airtime.take(now, msg.length())) {
+        // Over budget: try again as soon as the bucket holds this much,
+        // or at the next report if it never will
+        g_Counters.meshThrottled++;
+        uint32_t wait = g_Airtime.msUntil(now, msg.length());
+        taskSendMessage.delay(wait == UINT32_MAX ? g_ReportMs : wait);
+        return;
+    }
+    {
+        STAGE_TIMER(g_Stages[STAGE_MESH_SEND]);
+        meshLink.broadcast(msg.c_str());
+    }
+    g_LastSentMs = now;
+    g_Counters.meshSent++;
+    if (g_Boot.connectedMs() && g_Boot.firstBroadcast(millis())) {
+        LOG_INFO(SYSTEM, LOG_BOOT_FIRST_TX, g_Boot.broadcastMs());
+    }
+}
+
+#if WEB_DASHBOARD
+int formatMemoryReport(char *out, size_t size);  // Defined below, after the web globals
+#include <web_dashboard.h>
+#endif
+
+// Static memory each module reserves, against what it is allowed.  The
+// sizes are fixed at build time; the heap is what varies with uptime.
+struct MemBudget {
+    const char *module;
+    uint32_t bytes;
+    uint32_t budget;
+};
+const MemBudget kMemBudget[] = {
+    { "node_table", sizeof(nodeTable), 18432 },  // 88 bytes a node
+#if OLED_DISPLAY
+    { "oled_view", sizeof(oledView), 1536 },
+    { "trend", sizeof(g_Trend), 1024 },
+#endif
+    { "queue_process", sizeof(g_ToProcess), 2048 },
+    { "queue_mesh", sizeof(g_ToMesh), 768 },
+    { "log", sizeof(g_Log), 4096 },
+#if PMS_SENSOR && (OUTLIER_FILTER || CALIBRATION || SMOOTHING)
+    { "conditioning", sizeof(g_Conditioner), 512 },
+#endif
+#if STATUS_LEDS
+    { "leds", sizeof(ledStatus) + sizeof(g_LEDs), 128 },
+#endif
+#if STAGE_TIMING
+    { "stages", sizeof(g_Stages), 2048 },
+#endif
+#if WEB_DASHBOARD
+    { "sse_hub", sizeof(sseHub), 3072 },
+#endif
+#if MQTT_UPLINK
+    { "mqtt_uplink", sizeof(mqttUplink), 4096 },
+#endif
+};
+const int kMemBudgetCount = sizeof(kMemBudget) / sizeof(kMemBudget[0]);
+
+// Samples the heap and logs when it crosses into or out of the alert zone
+void checkHeap() {
+    g_Heap = readHeap();
+    bool alert = heapAlert(g_Heap);
+    if (alert && !g_HeapAlert) {
+        g_Counters.heapAlerts++;
+        LOG_WARN(SYSTEM, LOG_HEAP_ALERT, g_Heap.free, g_Heap.largest, g_Heap.fragPct);
+    } else if (!alert && g_HeapAlert) {
+        LOG_INFO(SYSTEM, LOG_HEAP_RECOVERED, g_Heap.free, g_Heap.largest, g_Heap.fragPct);
+    }
+    g_HeapAlert = alert;
+}
+
+Task taskCheckHeap(TASK_SECOND * 5, TASK_FOREVER, &checkHeap);
+
+// Writes heap state, JSON allocations per tag and the static budget table
+int formatMemoryReport(char *out, size_t size) {
+    int len = snprintf(out, size, "heap %u of %u free, min %u, largest block %u, frag %u%%%s\n",
+                       g_Heap.free, g_Heap.size, g_Heap.minFree, g_Heap.largest, g_Heap.fragPct,
+                       g_HeapAlert ? " ALERT" : "");
+    len += snprintf(out + len, len < (int)size ? size - len : 0, "%-14s %8s %8s %8s %8s %8s\n",
+                    "tag", "allocs", "frees", "failed", "live", "peak");
+    for (int i = 0; i < MEM_TAG_COUNT && len < (int)size; i++) {
+        const MemTagStats &t = g_MemTags[i];
+        len += snprintf(out + len, size - len, "%-14s %8u %8u %8u %8u %8u\n",
+                        kMemTagNames[i], t.allocs, t.frees, t.failures, t.bytesLive, t.bytesPeak);
+    }
+    if (len < (int)size) {
+        len += snprintf(out + len, size - len, "%-14s %8s %8s\n", "module", "bytes", "budget");
+    }
+    for (int i = 0; i < kMemBudgetCount && len < (int)size; i++) {
+        const MemBudget &b = kMemBudget[i];
+        len += snprintf(out + len, size - len, "%-14s %8u %8u%s\n", b.module, b.bytes, b.budget,
+                        b.bytes > b.budget ? " OVER" : "");
+    }
+    return len < (int)size ? len : (int)size - 1;
+}
+
+#if FAST_BOOT
+// Puts back the values and nodes saved by the last run: RTC memory if it
+// survived the reset, else the flash copy
+void restoreBootState() {
+    static BootState flash;  // Off the setup() stack
+    const BootState *state = nullptr;
+    if (bootStateValid(g_RtcState)) {
+        state = &g_RtcState;
+        g_BootSource = BOOT_SOURCE_RTC;
+    } else if (g_Storage.load(BOOT_STATE_KEY, &flash, sizeof(flash)) && bootStateValid(flash)) {
+        state = &flash;
+        g_BootSource = BOOT_SOURCE_FLASH;
+    }
+    if (!state) {
+        return;
+    }
+    g_Boots = state->boots + 1;
+    bootStateRestore(*state, nodeCore, g_NodeId, millis());
+    g_BootRestored = nodeTable.size();
+    LOG_INFO(SYSTEM, LOG_BOOT_RESTORED, g_BootSource, g_BootRestored, state->savedAtMs / 1000, g_Boots);
 }
 
-// Needed for painless library
-void receivedCallback( uint32_t from, String &msg ) {
-    // Ignore messages from this node itself
-    if (from == mesh.getNodeId()) {
+// Refreshes the RTC copy every run and the flash copy every
+// BOOT_FLASH_SAVE_MS.  App core, which owns nodeCore.
+void saveBootState() {
+    static uint32_t lastFlashSave = 0;
+    uint32_t now = millis();
+    bootStateCapture(g_RtcState, nodeCore, nodeTable, g_Boots, now);
+    if (now - lastFlashSave >= BOOT_FLASH_SAVE_MS) {
+        lastFlashSave = now;
+        if (!g_Storage.save(BOOT_STATE_KEY, &g_RtcState, sizeof(g_RtcState))) {
+            LOG_WARN(SYSTEM, LOG_BOOT_SAVE_FAILED, (uint32_t)sizeof(g_RtcState));
+        }
+    }
+}
+
+Task taskSaveBootState(BOOT_RTC_SAVE_MS, TASK_FOREVER, &saveBootState);
+#endif
+
+// Logs how long each part of setup() took
+void reportBoot() {
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        LOG_INFO(SYSTEM, LOG_BOOT_PHASE, i, g_Boot.phaseUs(i));
+    }
+#if !SERIAL_BRIDGE
+    char report[320];
+#if FAST_BOOT
+    g_Boot.format(report, sizeof(report), g_BootSource, g_BootRestored);
+#else
+    g_Boot.format(report, sizeof(report), BOOT_SOURCE_NONE, 0);
+#endif
+    Serial.print(report);
+#endif
+}
+
+// Mesh messages from meshLink, on the mesh task
+void receivedCallback(void *, uint32_t from, const char *msg, size_t len) {
+    CallbackTimer timer;
+
+    // Ignore messages from this node itself, and everything on roles
+    // that keep no table of other nodes
+    if (!kMeshReceive || from == mesh.getNodeId()) {
         return;  // Ignore message
     }
 
-    Serial.printf("Received from %u msg=%s\n", from, msg.c_str());
-    
-    // JSON input string.
-    const char* json = msg.c_str();
+    LOG_DEBUG(MESH, LOG_MESH_RX, from, len);
+
     // Deserialize the JSON document
-    DeserializationError error = deserializeJson(jsonReadings, json);
+    DeserializationError error;
+    {
+        STAGE_TIMER(g_Stages[STAGE_JSON_DECODE]);
+        error = deserializeJson(jsonReadings, msg, len);
+    }
 
     // Test if parsing succeeds.
     if (error) {
-        Serial.print(F("deserializeJson() failed: "));
-        Serial.println(error.f_str());
+        g_Counters.meshParseErrors++;
+        LOG_WARN(MESH, LOG_MESH_PARSE_ERROR, from, (uint32_t)error.code());
         return;
     }
 
-    Serial.print("Node: ");
-    Serial.println(from);
-    
-    for (int i = 0; i < 5; i++) {    
-        datum[i] = jsonReadings[keys[i]].as<String>();
-        Serial.print(keys[i]);
-        Serial.print(": ");
-        Serial.print(datum[i]);
-        Serial.print(" ");
-        Serial.println(suf[i]);
+    // Parsed straight into a queue slot for the app core
+    size_t ticket;
+    Reading *r = g_ToProcess.claim(ticket);
+    if (!r) {
+        g_Counters.meshDropped++;
+        LOG_WARN(MESH, LOG_QUEUE_FULL, 0);
+        return;
     }
+    readingFromJson(jsonReadings, from, millis(), *r);
+    LOG_INFO(MESH, LOG_MESH_READING, from, hundredthsFromText(r->value[0]), hundredthsFromText(r->value[1]),
+             hundredthsFromText(r->value[2]), hundredthsFromText(r->value[3]), hundredthsFromText(r->value[4]));
+    g_ToProcess.publish(ticket);
+    g_Counters.meshReceived++;
+}
 
-    displayMessages();
+#if PMS_SENSOR && (OUTLIER_FILTER || CALIBRATION || SMOOTHING)
+// Puts this node's sensor values through g_Conditioner; rawPm keeps what
+// the sensor said
+void conditionReading(Reading &r, uint32_t now) {
+    uint8_t spikes = g_Conditioner.apply(r, now);
+    for (int i = 0; i < 3; i++) {
+        if (spikes & (1 << i)) {
+            LOG_DEBUG(SENSOR, LOG_OUTLIER, i, r.rawPm[i], g_Conditioner.outliers(i).median());
+        }
+    }
 }
+#endif
+
+// Applies queued readings to nodeCore and everything that follows it:
+// node table, uplinks, display, LEDs and dashboard.  App core only.
+void processReadings() {
+    Reading *r;
+    while ((r = g_ToProcess.front()) != nullptr) {
+        STAGE_TIMER(g_Stages[STAGE_PROCESS]);
+        Reading in = *r;
+        g_ToProcess.pop();  // Slot goes back to the producers
+#if PMS_SENSOR && CALIBRATION
+        if (in.node != g_NodeId) {
+            calibrator.humidity(in.value[4], millis());  // Ignores "null" from nodes that don't measure it
+        }
+#endif
+        if (in.node == g_NodeId) {
+            in.heapFree = g_Heap.free;  // This node's own, from checkHeap()
+            in.heapFragPct = g_Heap.fragPct;
+#if PMS_SENSOR && (OUTLIER_FILTER || CALIBRATION || SMOOTHING)
+            conditionReading(in, millis());
+#endif
+        }
+
+        NodeEntry *entry = storeReading(in);
+        displayMessages();
+#if WEB_DASHBOARD
+        publishReading(*entry);
+#endif
+
+        // The mesh task broadcasts this node's latest values; other nodes'
+        // only go to the table.  If it is behind, skip this snapshot, a
+        // newer one follows with the next reading.
+        Reading *out = in.node == g_NodeId ? g_ToMesh.claim() : nullptr;
+        if (out) {
+            nodeCore.snapshot(g_NodeId, millis(), *out);
+            out->reportMs = in.reportMs;
+            out->sampleMs = in.sampleMs;
+            out->flags = in.flags;
+            memcpy(out->rawPm, in.rawPm, sizeof(out->rawPm));
+            g_ToMesh.publish();
+        }
+    }
+}
+
+// Mesh side of the pipeline: radio, broadcasts and incoming messages
+void meshStep() {
+    meshLink.update();  // Also runs userScheduler, i.e. taskSendMessage
+    Reading *r;
+    while ((r = g_ToMesh.front()) != nullptr) {
+        g_Broadcast = *r;
+        if (r->reportMs && r->reportMs != g_ReportMs) {
+            // Sooner reports start now; later ones from the next send
+            if (r->reportMs < g_ReportMs) {
+                taskSendMessage.forceNextIteration();
+            }
+            taskSendMessage.setInterval(r->reportMs);
+            g_ReportMs = r->reportMs;
+        }
+        if (r->sampleMs) {
+            g_SampleMs = r->sampleMs;
+        }
+        g_ToMesh.pop();
+    }
+}
+
+// Forwards queued log records: as text lines, or in SERIAL_BRIDGE builds as
+// frames for tools/collector to format.  Stops when the UART buffer is
+// short instead of waiting; the rest go out on the next run.
+void drainLog() {
+    LogRecord *r;
+    while ((r = g_Log.front()) != nullptr) {
+#if SERIAL_BRIDGE
+        uint8_t out[FRAME_MAX_ENCODED];
+        size_t len = encodeLogRecord(*r, out);
+#else
+        char out[160];
+        size_t len = formatLogRecord(out, sizeof(out) - 1, *r);
+        out[len++] = '\n';
+#endif
+        if (Serial.availableForWrite() < (int)len) {
+            return;
+        }
+        Serial.write((const uint8_t *)out, len);
+        g_Log.pop();
+    }
+}
+
+Task taskDrainLog(LOG_DRAIN_MS, TASK_FOREVER, &drainLog);
+
+#if !SERIAL_BRIDGE
+// Looks a name up in a table; -1 if it isn't there
+int findName(const char *const *names, int count, const char *name, size_t len) {
+    for (int i = 0; i < count; i++) {
+        if (strlen(names[i]) == len && strncmp(names[i], name, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// "log level <error|warn|info|debug>", "log cat all" or
+// "log cat <name>[,<name>...]"; plain "log" shows the current filter
+void logCommand(const char *args) {
+    if (strncmp(args, "level ", 6) == 0) {
+        int level = findName(kLogLevelNames, LOG_LEVEL_COUNT, args + 6, strlen(args + 6));
+        if (level >= 0) {
+            g_Log.setLevel(level);
+        }
+    } else if (strcmp(args, "cat all") == 0) {
+        g_Log.setCategories(0xFFFFFFFF);
+    } else if (strncmp(args, "cat ", 4) == 0) {
+        uint32_t mask = 0;
+        for (const char *p = args + 4; *p;) {
+            const char *end = strchr(p, ',');
+            size_t len = end ? (size_t)(end - p) : strlen(p);
+            int cat = findName(kLogCategoryNames, LOG_CAT_COUNT, p, len);
+            if (cat >= 0) {
+                mask |= 1u << cat;
+            }
+            p += len + (end ? 1 : 0);
+        }
+        g_Log.setCategories(mask);
+    }
+    Serial.printf("log level %s, categories", kLogLevelNames[g_Log.level()]);
+    for (int i = 0; i < LOG_CAT_COUNT; i++) {
+        if (g_Log.categories() & (1u << i)) {
+            Serial.printf(" %s", kLogCategoryNames[i]);
+        }
+    }
+    Serial.printf(", %u dropped, %u rate limited\n", g_Log.dropped(), g_Log.rateLimited());
+}
+
+#if PMS_SENSOR && CALIBRATION
+// Reads up to count space-separated decimals as Fixed16 raw; returns how
+// many it found
+int parseFixedArgs(const char *p, int32_t *out, int count) {
+    int n = 0;
+    while (n < count) {
+        while (*p == ' ') {
+            p++;
+        }
+        const char *end;
+        Fixed16 v = Fixed16::parse(p, &end);
+        if (end == p) {
+            break;
+        }
+        out[n++] = v.raw();
+        p = end;
+    }
+    return n;
+}
+
+// "cal model <linear|epa|kohler>", "cal gain <0-2> <x>", "cal offset
+// <0-2> <x>", "cal epa <a> <b> <c>", "cal kappa <x>" or "cal reset" change
+// the coefficients and save them; plain "cal" shows them
+void calCommand(const char *args) {
+    CalCoefficients c = calibrator.coefficients();
+    int32_t v[3];
+    bool changed = true;
+    if (strncmp(args, "model ", 6) == 0) {
+        int model = findName(kCalModelNames, CAL_MODEL_COUNT, args + 6, strlen(args + 6));
+        changed = model >= 0 && (kMeshReceive || model == CAL_LINEAR);
+        c.model = changed ? model : c.model;
+        if (model > CAL_LINEAR && !kMeshReceive) {
+            Serial.println("cal: the humidity models need MESH_RECEIVE");
+        }
+    } else if ((strncmp(args, "gain ", 5) == 0 || strncmp(args, "offset ", 7) == 0) &&
+               parseFixedArgs(strchr(args, ' '), v, 2) == 2 && v[0] >= 0 && v[0] < Fixed16::fromInt(CAL_CHANNELS).raw()) {
+        int ch = Fixed16::fromRaw(v[0]).toInt();
+        (args[0] == 'g' ? c.gain : c.offset)[ch] = v[1];
+    } else if (strncmp(args, "epa ", 4) == 0 && parseFixedArgs(args + 4, v, 3) == 3) {
+        memcpy(c.epa, v, sizeof(c.epa));
+    } else if (strncmp(args, "kappa ", 6) == 0 && parseFixedArgs(args + 6, v, 1) == 1) {
+        c.kappa = v[0];
+    } else if (strcmp(args, "reset") == 0) {
+        calDefaults(c);
+    } else {
+        changed = false;
+    }
+    if (changed) {
+        calSeal(c);
+        calibrator.set(c);
+        bool saved = g_Storage.save(CAL_STORAGE_KEY, &c, sizeof(c));
+        LOG_INFO(SENSOR, LOG_CAL_SET, c.model, saved);
+    }
+
+    char a[FIXED_FORMAT_MAX], b[FIXED_FORMAT_MAX], d[FIXED_FORMAT_MAX];
+    Serial.printf("cal model %s", kCalModelNames[c.model]);
+    for (int i = 0; i < CAL_CHANNELS; i++) {
+        Fixed16::fromRaw(c.gain[i]).format(a, 4);
+        Fixed16::fromRaw(c.offset[i]).format(b, 2);
+        Serial.printf(", %s: x%s %s%s", kReadingKeys[i], a, c.offset[i] < 0 ? "" : "+", b);
+    }
+    Fixed16::fromRaw(c.epa[0]).format(a, 4);
+    Fixed16::fromRaw(c.epa[1]).format(b, 4);
+    Fixed16::fromRaw(c.epa[2]).format(d, 2);
+    Serial.printf(", epa %s %s %s", a, b, d);
+    Fixed16::fromRaw(c.kappa).format(a, 3);
+    const CalStats &s = calibrator.stats();
+    Serial.printf(", kappa %s; %u applied, %u without humidity\n", a, s.applied, s.noHumidity);
+}
+#endif
+
+// Line commands on Serial, e.g. "log level debug", "stages" or "mem".  Never
+// waits for input.
+void pollSerialCommands() {
+    static char line[48];
+    static int len = 0;
+    while (Serial.available() > 0) {
+        char c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (len < (int)sizeof(line) - 1) {
+                line[len++] = c;
+            }
+            continue;
+        }
+        line[len] = '\0';
+        len = 0;
+        if (strcmp(line, "log") == 0 || strncmp(line, "log ", 4) == 0) {
+            logCommand(line[3] ? line + 4 : "");
+#if STAGE_TIMING
+        } else if (strcmp(line, "stages") == 0) {
+            char report[768];
+            formatStageReport(report, sizeof(report));
+            Serial.print(report);
+        } else if (strcmp(line, "stages reset") == 0) {
+            for (int i = 0; i < STAGE_COUNT; i++) {
+                g_Stages[i].reset();  // Writers on the mesh core may race this; it is a debug aid
+            }
+            Serial.println("stages cleared");
+#endif
+#if PMS_SENSOR && CALIBRATION
+        } else if (strcmp(line, "cal") == 0 || strncmp(line, "cal ", 4) == 0) {
+            calCommand(line[3] ? line + 4 : "");
+#endif
+        } else if (strcmp(line, "mem") == 0) {
+            char report[1024];
+            formatMemoryReport(report, sizeof(report));
+            Serial.print(report);
+        }
+    }
+}
+#endif
+
+// App side of the pipeline: readings in, then display, LEDs and uplinks
+void appStep() {
+#if !SERIAL_BRIDGE
+    pollSerialCommands();
+#endif
+    processReadings();
+    appScheduler.execute();
+#if WEB_DASHBOARD
+    updateWebServer();
+#endif
+#if MQTT_UPLINK
+    if (WiFi.status() == WL_CONNECTED) {
+        mqttUplink.update();
+    }
+#endif
+}
+
+#if DUAL_CORE
+void meshTask(void *) {
+    for (;;) {
+        meshStep();
+        vTaskDelay(1);  // Lets the idle task feed the watchdog
+    }
+}
+
+#if PMS_SENSOR
+void acquireTask(void *) {
+    for (;;) {
+        uint32_t wait = acquireStep();
+        vTaskDelay(pdMS_TO_TICKS(wait ? wait : 1));  // Sleeps until the next due time
+    }
+}
+#endif
+#endif
 
 void newConnectionCallback(uint32_t nodeId) {
-    Serial.printf("--> startHere: New Connection, nodeId = %u\n", nodeId);
+    LOG_INFO(MESH, LOG_MESH_CONNECTED, nodeId);
+    if (g_Boot.firstConnection(millis())) {
+        LOG_INFO(SYSTEM, LOG_BOOT_JOINED, g_Boot.connectedMs());
+        taskSendMessage.forceNextIteration();  // Current values out now, not on the next tick
+    }
 }
 
 void changedConnectionCallback() {
-    Serial.printf("Changed connections\n");
+    g_MeshNodes = mesh.getNodeList().size();
+    LOG_INFO(MESH, LOG_MESH_CHANGED, g_MeshNodes);
 }
 
 void nodeTimeAdjustedCallback(int32_t offset) {
-    Serial.printf("Adjusted time %u. Offset = %d\n", mesh.getNodeTime(),offset);
+    LOG_DEBUG(MESH, LOG_MESH_TIME, mesh.getNodeTime(), offset);
+}
+
+#if LOW_POWER
+void dutyConnected(uint32_t nodeId) {
+    LOG_INFO(MESH, LOG_MESH_CONNECTED, nodeId);
+    dutyCycle.linkUp();
+}
+
+// The whole of a LOW_POWER wake; the sensor is woken and given time to
+// settle before the radio is started at all
+void setupLowPower() {
+    Serial.begin(115200);
+    pmsSerial.begin(9600, SERIAL_8N1, PMS_RX_PIN, PMS_TX_PIN);
+    LOG_INFO(SYSTEM, LOG_BOOT_RESET, (uint32_t)esp_reset_reason());
+    dutyCycle.begin(millis(), DUTY_SINK_NODE);
+}
+
+void loopLowPower() {
+    uint32_t now = millis();
+    switch (dutyCycle.step(now)) {
+    case DUTY_RADIO_ON:
+        mesh.setDebugMsgTypes( ERROR );
+        mesh.init(MESH_PREFIX, MESH_PASSWORD, &userScheduler, MESH_PORT);
+        mesh.onNewConnection(&dutyConnected);
+        g_MeshStarted = true;
+        break;
+    case DUTY_SLEEP_NOW: {
+        uint32_t sleepMs = dutyCycle.sleepMs(now);
+        const DutyState &s = dutyCycle.state();
+        LOG_INFO(SYSTEM, LOG_DUTY_WAKE, s.cycles, dutyCycle.samples(), dutyCycle.delivered(), now);
+        LOG_INFO(SYSTEM, LOG_DUTY_ENERGY, dutyAverageUa(s), dutyEnergyPerReadingUj(s), sleepMs);
+        while (g_Log.front()) {
+            drainLog();
+            Serial.flush();
+        }
+        if (g_MeshStarted) {
+            mesh.stop();
+        }
+        esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000);
+        esp_deep_sleep_start();  // Doesn't return; the next wake starts at setup()
+        break;
+    }
+    default:
+        // Between reads and while the fan settles nothing arrives that
+        // matters, and the radio is still off
+        uint32_t idle = dutyCycle.msUntilNext(now);
+        if (!g_MeshStarted && idle >= DUTY_LIGHT_SLEEP_MS) {
+            esp_sleep_enable_timer_wakeup((uint64_t)idle * 1000);
+            esp_light_sleep_start();
+        }
+        break;
+    }
 }
+#endif
 
 void setup() {
+#if LOW_POWER
+    setupLowPower();
+    return;
+#endif
+    g_Boot.begin(micros());
+    Serial.setTxBufferSize(SERIAL_TX_BUFFER);  // Before begin(); lets drainLog() write without waiting
+#if SERIAL_BRIDGE
+    // Serial carries framed readings to the collector
+    Serial.begin(SERIAL_BRIDGE_BAUD);
+#else
     // Serial for debugging
     Serial.begin(115200);
+#endif
 
+#if !FAST_BOOT
     while (!Serial) { }
+#endif
+    g_Boot.mark(BOOT_SERIAL, micros());
 
-    // Initialize OLED display
-    g_OLED.begin();
-    g_OLED.clear();
-    g_OLED.setFont(u8g2_font_profont15_tf);
-    g_lineHeight = g_OLED.getFontAscent() - g_OLED.getFontDescent();
-
-    // Initialize FastLED
-    FastLED.addLeds<WS2812B, LED_PIN, GRB>(g_LEDs, NUM_LEDS);
-    FastLED.setBrightness(g_Brightness);
-    FastLED.setMaxPowerInMilliWatts(g_PowerLimit);
-
+    // The mesh comes up first: painlessMesh scans and joins in the
+    // background while the peripherals below are initialised.
+    // painlessMesh prints synchronously, so only errors and startup by default
+#if MESH_DEBUG && !SERIAL_BRIDGE
     mesh.setDebugMsgTypes( ERROR | MESH_STATUS | CONNECTION | SYNC | COMMUNICATION | GENERAL | MSG_TYPES | REMOTE ); // all types on
+#elif SERIAL_BRIDGE
+    mesh.setDebugMsgTypes( ERROR );  // Keep the bridge stream mostly binary
+#else
+    mesh.setDebugMsgTypes( ERROR | STARTUP );
+#endif
 
     // Initialize painlessMesh
     mesh.init(MESH_PREFIX, MESH_PASSWORD, &userScheduler, MESH_PORT);
+    g_NodeId = mesh.getNodeId();
+    LOG_INFO(SYSTEM, LOG_BOOT, g_NodeId);
+    LOG_INFO(SYSTEM, LOG_ROLE, kNodeRole, kRoleFeatureMask);
+    LOG_INFO(SYSTEM, LOG_BOOT_RESET, (uint32_t)esp_reset_reason());
 
     // Assign all the callback functions to their corresponding events.
-    mesh.onReceive(&receivedCallback);  // Set the callback for receiving messages
+    meshLink.onReceive(&receivedCallback, nullptr);  // Set the callback for receiving messages
     mesh.onNewConnection(&newConnectionCallback);
     mesh.onChangedConnections(&changedConnectionCallback);
     mesh.onNodeTimeAdjusted(&nodeTimeAdjustedCallback);
 
-    // Add the task to send messages periodically
+#if USE_STATION
+    // Join the WiFi station alongside the mesh
+    mesh.stationManual(STATION_SSID, STATION_PASSWORD);
+    mesh.setHostname(HOSTNAME);
+#endif
+
+    // Add the task to send messages periodically; its first run sends
+    // whatever restoreBootState() put back
     userScheduler.addTask(taskSendMessage);
     taskSendMessage.enable();
+    g_Boot.mark(BOOT_MESH, micros());
+
+#if FAST_BOOT
+    restoreBootState();
+#endif
+    nodeCore.snapshot(g_NodeId, millis(), g_Broadcast);
+    markHeapBaseline();  // The regions' layout, before any task can fragment them
+#if DUAL_CORE
+    // Started now so the join overlaps the rest of setup(); loop() stays
+    // on APP_CORE as the output pipeline
+    xTaskCreatePinnedToCore(meshTask, "mesh", 8192, nullptr, 2, nullptr, MESH_CORE);
+#endif
+    g_Boot.mark(BOOT_RESTORE, micros());
+
+#if OLED_DISPLAY
+    // Initialize OLED display
+    g_OLED.begin();
+    g_OLED.clear();
+    g_OLED.setFont(u8g2_font_profont15_tf);
+    g_lineHeight = g_OLED.getFontAscent() - g_OLED.getFontDescent();
+    g_OLED.setFlipMode(1);  // Mounted upside down
+    oledView.begin();
+    pinMode(UI_BUTTON_PIN, INPUT_PULLUP);
+#endif
+    g_Boot.mark(BOOT_DISPLAY, micros());
+
+#if STATUS_LEDS
+    // Initialize FastLED
+    FastLED.addLeds<WS2812B, LED_PIN, GRB>(g_LEDs, NUM_LEDS);
+    FastLED.setBrightness(g_Brightness);
+    FastLED.setMaxPowerInMilliWatts(g_PowerLimit);
+#endif
+    g_Boot.mark(BOOT_LEDS, micros());
 
+#if PMS_SENSOR
     // Initialize PMS7003 Serial communication
-    // pmsSerial.begin(9600, SERIAL_8N1, 16, 17);  // TX=17, RX=16
+    pmsSerial.begin(9600, SERIAL_8N1, PMS_RX_PIN, PMS_TX_PIN);
+    acquisition.begin(millis());
+#if CALIBRATION
+    CalCoefficients cal;
+    if (g_Storage.load(CAL_STORAGE_KEY, &cal, sizeof(cal))) {
+        if (!kMeshReceive && cal.model != CAL_LINEAR) {
+            cal.model = CAL_LINEAR;  // No humidity ever arrives without MESH_RECEIVE
+            calSeal(cal);
+        }
+        if (calibrator.set(cal)) {
+            LOG_INFO(SENSOR, LOG_CAL_LOADED, cal.model);
+        }
+    }
+#endif
+#if ADAPTIVE_RATE
+    adaptiveRate.begin(millis());
+#endif
+#endif
+    g_Boot.mark(BOOT_SENSOR, micros());
+
+#if WEB_DASHBOARD
+    startWebServer();
+#endif
+#if MQTT_UPLINK
+    snprintf(mqttClientId, sizeof(mqttClientId), "aq-%u", g_NodeId);
+#endif
+    g_Boot.mark(BOOT_UPLINKS, micros());
+
+#if OLED_DISPLAY
+    appScheduler.addTask(taskRenderDisplay);
+    taskRenderDisplay.enable();
+    appScheduler.addTask(taskSampleHistory);
+    taskSampleHistory.enable();
+#endif
+#if STATUS_LEDS
+    appScheduler.addTask(taskUpdateLEDs);
+    taskUpdateLEDs.enable();
+#endif
+    appScheduler.addTask(taskDrainLog);
+    taskDrainLog.enable();
+    appScheduler.addTask(taskCheckHeap);
+    taskCheckHeap.enable();
+#if FAST_BOOT
+    appScheduler.addTask(taskSaveBootState);
+    taskSaveBootState.enable();
+#endif
+
+    // Memory at boot, before the mesh has had time to fragment anything
+    checkHeap();
+    for (int i = 0; i < kMemBudgetCount; i++) {
+        if (kMemBudget[i].bytes > kMemBudget[i].budget) {
+            LOG_WARN(SYSTEM, LOG_MEM_OVER_BUDGET, i, kMemBudget[i].bytes, kMemBudget[i].budget);
+        }
+    }
+#if !SERIAL_BRIDGE
+    Serial.printf("role %s, features %02x\n", kRoleNames[kNodeRole], kRoleFeatureMask);
+    char report[1024];
+    formatMemoryReport(report, sizeof(report));
+    Serial.print(report);
+#endif
 
     displayMessages();
+
+#if DUAL_CORE && PMS_SENSOR
+    xTaskCreatePinnedToCore(acquireTask, "acquire", 4096, nullptr, 2, nullptr, APP_CORE);
+#endif
+    g_Boot.mark(BOOT_TASKS, micros());
+    reportBoot();
 }
 
 void loop() {
+#if LOW_POWER
+    loopLowPower();
+    return;
+#endif
+    unsigned long start = micros();
+
+#if DUAL_CORE
+    appStep();
+#else
     // Keep the mesh network alive
-    mesh.update();
-    // runOn(5);
+    meshStep();
+#if PMS_SENSOR
+    acquireStep();
+#endif
+    appStep();
+#endif
+
+    uint32_t elapsed = micros() - start;
+    g_Counters.loopCount++;
+    g_Counters.loopTotalUs += elapsed;
+    if (elapsed > g_Counters.loopMaxUs) {
+        g_Counters.loopMaxUs = elapsed;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,240 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        replay_main.cpp
+//
+// Description:
+//
+//   Entry point for [env:replay]: runs days of sensor data through the
+//   sample -> display -> mesh pipeline on virtual time, as fast as the
+//   host allows.  Each node reads a VirtualPms7003 driven by a recorded
+//   trace or a synthetic profile with smoke events, with whatever faults
+//   are asked for.
+//
+//   The scenario runs twice and the two digests of everything the nodes
+//   sent (mesh messages, panel frames, LED updates) must match, which
+//   catches anything that depends on wall time, addresses or
+//   uninitialised memory.  --expect compares against a digest from an
+//   earlier commit, so a change that alters the output shows up as a
+//   failure and --log shows where.
+//
+//   Build:   pio run -e replay
+//   Usage:   .pio/build/replay/program [options]
+//            --days N          virtual days to run (7)
+//            --nodes N         nodes on the mesh (3)
+//            --trace FILE      "ms,pm1.0,pm2.5,pm10.0" lines instead of
+//                              the synthetic profile
+//            --seed N          fault and noise seed (1)
+//            --noise PCT       reading noise, +/- percent (10)
+//            --corrupt N       frames per 1000 with a flipped bit (5)
+//            --drop N          frames per 1000 missing a byte (5)
+//            --clean           no noise, faults or mid-frame starts
+//            --expect HEX      fail unless the digest matches
+//            --log FILE        every broadcast, "ms node json"
+//            --write-trace F   the synthetic profile at 1 s steps, then exit
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <sim_node.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+struct ReplayOptions {
+    uint32_t days = 7;
+    int nodes = 3;
+    const char *trace = nullptr;
+    const char *log = nullptr;
+    const char *writeTrace = nullptr;
+    bool expect = false;
+    uint32_t expected = 0;
+    VirtualPmsConfig sensor;
+};
+
+struct ReplayResult {
+    uint32_t digest;
+    bool complete;      // Every node heard from every other node
+};
+
+// The synthetic air for node i: a daily cycle and an evening smoke
+// event every other day, a little different at each node
+static void syntheticAir(SyntheticProfile &air, int i) {
+    air.base = (uint16_t)(6 + i % 5 * 3);
+    air.dailySwing = 12;
+    air.eventPeak = (uint16_t)(150 + i * 20);
+    air.eventEveryMs = 2 * VPMS_DAY_MS;
+    air.eventOffsetMs = 19 * 3600000u + i * 300000u;  // The plume reaches each node a few minutes apart
+}
+
+static ReplayResult runScenario(const ReplayOptions &opt, const TraceProfile *trace, bool report) {
+    FakeClock clock;
+    FakeMeshBus bus;
+    FILE *log = nullptr;
+    if (opt.log && report) {
+        log = fopen(opt.log, "w");
+    }
+
+    std::vector<SyntheticProfile> air(opt.nodes);
+    std::vector<TraceProfile> traces(trace ? opt.nodes : 0, trace ? *trace : TraceProfile());
+    std::vector<std::unique_ptr<SimNode>> nodes;
+    for (int i = 0; i < opt.nodes; i++) {
+        syntheticAir(air[i], i);
+        PmsProfile &profile = trace ? (PmsProfile &)traces[i] : (PmsProfile &)air[i];
+        VirtualPmsConfig config = opt.sensor;
+        config.seed = opt.sensor.seed * 7919 + i;
+        nodes.emplace_back(new SimNode(bus, clock, SIM_NODE_BASE + 1 + i, profile, config));
+        nodes.back()->begin();
+        nodes.back()->setLog(log);
+    }
+
+    // Steps stay on the SIM_STEP_MS grid but skip the ticks where no node
+    // has anything to do
+    uint64_t endMs = (uint64_t)opt.days * VPMS_DAY_MS;
+    uint64_t now = 0;
+    while (now < endMs) {
+        uint32_t wait = UINT32_MAX;
+        for (auto &node : nodes) {
+            node->step((uint32_t)now);
+        }
+        for (auto &node : nodes) {
+            wait = std::min(wait, node->msUntilNext((uint32_t)now));
+        }
+        uint32_t advance = std::max<uint32_t>(SIM_STEP_MS, (wait + SIM_STEP_MS - 1) / SIM_STEP_MS * SIM_STEP_MS);
+        now += advance;
+        clock.advanceMs(advance);
+    }
+    if (log) {
+        fclose(log);
+    }
+
+    ReplayResult res = { 2166136261u, true };
+    for (auto &node : nodes) {
+        res.digest = (res.digest ^ node->digest()) * 16777619u;
+        res.complete = res.complete && node->table().size() == opt.nodes;
+    }
+    if (!report) {
+        return res;
+    }
+
+    printf("%-6s %8s %8s %7s %7s %6s %8s %8s %8s %8s\n", "node", "frames", "bad", "corrupt", "dropped",
+           "tmo", "samples", "sent", "received", "renders");
+    for (auto &node : nodes) {
+        const VirtualPmsStats &vs = node->sensor().stats();
+        printf("%-6u %8u %8u %7u %7u %6u %8u %8u %8u %8u\n", node->nodeId(), node->pms().frames(),
+               node->pms().badFrames(), vs.corrupted, vs.dropped, node->sampleStats().timeouts,
+               node->sampleStats().samples, node->sent(), node->received(), node->displayStats().renders);
+    }
+    return res;
+}
+
+static bool writeSyntheticTrace(const char *path, uint32_t days) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    SyntheticProfile air;
+    syntheticAir(air, 0);
+    fprintf(f, "# ms,pm1.0,pm2.5,pm10.0\n");
+    for (uint64_t ms = 0; ms < (uint64_t)days * VPMS_DAY_MS; ms += 1000) {
+        uint16_t pm[3];
+        air.sample((uint32_t)ms, pm);
+        fprintf(f, "%u,%u,%u,%u\n", (uint32_t)ms, pm[0], pm[1], pm[2]);
+    }
+    return fclose(f) == 0;
+}
+
+static bool parseArgs(int argc, char **argv, ReplayOptions &opt) {
+    opt.sensor.noisePct = 10;
+    opt.sensor.corruptPerMille = 5;
+    opt.sensor.dropPerMille = 5;
+    opt.sensor.midFrameStart = true;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--clean") == 0) {
+            opt.sensor.noisePct = 0;
+            opt.sensor.corruptPerMille = 0;
+            opt.sensor.dropPerMille = 0;
+            opt.sensor.midFrameStart = false;
+            continue;
+        }
+        if (!value) {
+            return false;
+        }
+        i++;
+        if (strcmp(arg, "--days") == 0) {
+            opt.days = strtoul(value, nullptr, 0);
+        } else if (strcmp(arg, "--nodes") == 0) {
+            opt.nodes = atoi(value);
+        } else if (strcmp(arg, "--trace") == 0) {
+            opt.trace = value;
+        } else if (strcmp(arg, "--seed") == 0) {
+            opt.sensor.seed = strtoul(value, nullptr, 0);
+        } else if (strcmp(arg, "--noise") == 0) {
+            opt.sensor.noisePct = atoi(value);
+        } else if (strcmp(arg, "--corrupt") == 0) {
+            opt.sensor.corruptPerMille = atoi(value);
+        } else if (strcmp(arg, "--drop") == 0) {
+            opt.sensor.dropPerMille = atoi(value);
+        } else if (strcmp(arg, "--expect") == 0) {
+            opt.expect = true;
+            opt.expected = strtoul(value, nullptr, 16);
+        } else if (strcmp(arg, "--log") == 0) {
+            opt.log = value;
+        } else if (strcmp(arg, "--write-trace") == 0) {
+            opt.writeTrace = value;
+        } else {
+            return false;
+        }
+    }
+    return opt.nodes > 0 && opt.days > 0 && opt.days < 49;  // millis() wraps at 49.7 days
+}
+
+int main(int argc, char **argv) {
+    ReplayOptions opt;
+    if (!parseArgs(argc, argv, opt)) {
+        fprintf(stderr, "usage: %s [--days N] [--nodes N] [--trace FILE] [--seed N] [--noise PCT] "
+                        "[--corrupt N] [--drop N] [--clean] [--expect HEX] [--log FILE] [--write-trace FILE]\n",
+                argv[0]);
+        return 2;
+    }
+    if (opt.writeTrace) {
+        return writeSyntheticTrace(opt.writeTrace, opt.days) ? 0 : 1;
+    }
+    TraceProfile trace;
+    if (opt.trace && !trace.load(opt.trace)) {
+        fprintf(stderr, "can't read a trace from %s\n", opt.trace);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ReplayResult first = runScenario(opt, opt.trace ? &trace : nullptr, true);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ReplayResult second = runScenario(opt, opt.trace ? &trace : nullptr, false);
+
+    double simulated = (double)opt.days * VPMS_DAY_MS / 1000;
+    printf("%u days x %d nodes in %.2f s, %.0fx real time\n", opt.days, opt.nodes, wall, simulated / wall);
+    printf("digest %08x, rerun %08x\n", first.digest, second.digest);
+
+    bool ok = true;
+    if (first.digest != second.digest) {
+        printf("FAIL: two runs of the same scenario differ\n");
+        ok = false;
+    }
+    if (opt.expect && first.digest != opt.expected) {
+        printf("FAIL: expected digest %08x\n", opt.expected);
+        ok = false;
+    }
+    if (!first.complete) {
+        printf("FAIL: some node never heard from every other node\n");
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
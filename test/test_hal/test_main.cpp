@@ -0,0 +1,261 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        test_main.cpp
+//
+// Description:
+//
+//   Unity tests for the node modules on the hal_native.h fakes: the
+//   PMS7003 driver on a FakeSerial, message delivery on a FakeMeshBus,
+//   OledView's tile-row diffing on a FakeDisplay, LED fades and levels
+//   and FileStorage round trips.
+//
+//   Run:     pio test -e native
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <hal_native.h>
+#include <led_status.h>
+#include <oled_view.h>
+#include <pms7003.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <unity.h>
+#include <vector>
+
+void setUp() {}
+void tearDown() {}
+
+// A 32-byte reading frame as the sensor sends it
+static std::vector<uint8_t> pmsFrame(uint16_t pm1_0, uint16_t pm2_5, uint16_t pm10_0) {
+    std::vector<uint8_t> f(4 + PMS_READING_LEN, 0);
+    f[0] = 0x42;
+    f[1] = 0x4D;
+    f[3] = PMS_READING_LEN;
+    uint16_t values[3] = { pm1_0, pm2_5, pm10_0 };
+    for (int i = 0; i < 3; i++) {
+        f[10 + 2 * i] = values[i] >> 8;
+        f[11 + 2 * i] = values[i] & 0xFF;
+    }
+    uint16_t sum = 0;
+    for (size_t i = 0; i < f.size() - 2; i++) {
+        sum += f[i];
+    }
+    f[f.size() - 2] = sum >> 8;
+    f[f.size() - 1] = sum & 0xFF;
+    return f;
+}
+
+static void test_pms_read_request_bytes() {
+    FakeSerial port;
+    Pms7003 pms(port);
+    pms.requestRead();
+    const uint8_t expect[7] = { 0x42, 0x4D, PMS_CMD_READ, 0x00, 0x00, 0x01, 0x71 };
+    TEST_ASSERT_EQUAL(7, port.written().size());
+    TEST_ASSERT_EQUAL_MEMORY(expect, port.written().data(), 7);
+}
+
+static void test_pms_parses_frame() {
+    FakeSerial port;
+    Pms7003 pms(port);
+    std::vector<uint8_t> f = pmsFrame(7, 12, 300);
+    const uint8_t noise[3] = { 0x00, 0x42, 0x13 };  // Line noise before the header
+    port.inject(noise, sizeof(noise));
+    port.inject(f.data(), f.size());
+    TEST_ASSERT_TRUE(pms.poll());
+    TEST_ASSERT_EQUAL(7, pms.reading().pm1_0);
+    TEST_ASSERT_EQUAL(12, pms.reading().pm2_5);
+    TEST_ASSERT_EQUAL(300, pms.reading().pm10_0);
+    TEST_ASSERT_EQUAL(1, pms.frames());
+    TEST_ASSERT_EQUAL(0, pms.badFrames());
+}
+
+static void test_pms_frame_split_across_polls() {
+    FakeSerial port;
+    Pms7003 pms(port);
+    std::vector<uint8_t> f = pmsFrame(1, 2, 3);
+    port.inject(f.data(), 10);
+    TEST_ASSERT_FALSE(pms.poll());
+    port.inject(f.data() + 10, f.size() - 10);
+    TEST_ASSERT_TRUE(pms.poll());
+    TEST_ASSERT_EQUAL(2, pms.reading().pm2_5);
+}
+
+static void test_pms_rejects_bad_checksum() {
+    FakeSerial port;
+    Pms7003 pms(port);
+    std::vector<uint8_t> f = pmsFrame(5, 5, 5);
+    f[12] ^= 0x01;
+    port.inject(f.data(), f.size());
+    TEST_ASSERT_FALSE(pms.poll());
+    TEST_ASSERT_EQUAL(0, pms.frames());
+    TEST_ASSERT_EQUAL(1, pms.badFrames());
+
+    f = pmsFrame(5, 6, 7);  // The next good frame still reads
+    port.inject(f.data(), f.size());
+    TEST_ASSERT_TRUE(pms.poll());
+    TEST_ASSERT_EQUAL(6, pms.reading().pm2_5);
+}
+
+struct Inbox {
+    std::vector<std::string> messages;
+    std::vector<uint32_t> from;
+
+    static void onMessage(void *context, uint32_t from, const char *msg, size_t len) {
+        Inbox &in = *(Inbox *)context;
+        in.messages.push_back(std::string(msg, len));
+        in.from.push_back(from);
+    }
+};
+
+static void test_mesh_broadcast_in_order_to_others() {
+    FakeMeshBus bus;
+    FakeMesh a(bus, 1), b(bus, 2), c(bus, 3);
+    Inbox inA, inB, inC;
+    a.onReceive(Inbox::onMessage, &inA);
+    b.onReceive(Inbox::onMessage, &inB);
+    c.onReceive(Inbox::onMessage, &inC);
+
+    a.broadcast("first");
+    c.broadcast("second");
+    TEST_ASSERT_TRUE(b.pending());
+    TEST_ASSERT_EQUAL(0, inB.messages.size());  // Only handed over on update()
+    a.update();
+    b.update();
+    c.update();
+
+    TEST_ASSERT_EQUAL(2, inB.messages.size());
+    TEST_ASSERT_EQUAL_STRING("first", inB.messages[0].c_str());
+    TEST_ASSERT_EQUAL(1, inB.from[0]);
+    TEST_ASSERT_EQUAL_STRING("second", inB.messages[1].c_str());
+    TEST_ASSERT_EQUAL(3, inB.from[1]);
+    TEST_ASSERT_EQUAL(1, inA.messages.size());  // Not its own
+    TEST_ASSERT_EQUAL_STRING("second", inA.messages[0].c_str());
+    TEST_ASSERT_EQUAL(1, inC.messages.size());
+    TEST_ASSERT_EQUAL(2, bus.messages());
+}
+
+static void test_mesh_send_to_one_node() {
+    FakeMeshBus bus;
+    FakeMesh a(bus, 1), b(bus, 2), c(bus, 3);
+    Inbox inB, inC;
+    b.onReceive(Inbox::onMessage, &inB);
+    c.onReceive(Inbox::onMessage, &inC);
+
+    TEST_ASSERT_TRUE(a.sendTo(3, "hello"));
+    TEST_ASSERT_FALSE(a.sendTo(9, "nobody"));
+    TEST_ASSERT_FALSE(a.sendTo(1, "self"));
+    b.update();
+    c.update();
+    TEST_ASSERT_EQUAL(0, inB.messages.size());
+    TEST_ASSERT_EQUAL(1, inC.messages.size());
+    TEST_ASSERT_EQUAL_STRING("hello", inC.messages[0].c_str());
+    TEST_ASSERT_EQUAL(1, a.sent());
+}
+
+static void test_oled_view_sends_changed_rows() {
+    FakeClock clock;
+    FakeDisplay display;
+    OledView view(display, clock);
+    view.begin();
+    view.beginFrame();
+    view.present();  // First frame sends every row
+    TEST_ASSERT_EQUAL(FB_ROWS, display.tileRows());
+
+    view.beginFrame();
+    view.present();  // Nothing changed
+    TEST_ASSERT_EQUAL(FB_ROWS, display.tileRows());
+    TEST_ASSERT_EQUAL(1, view.stats().skipped);
+
+    view.beginFrame();
+    view.frame().text(0, 3, "PM2.5 12");
+    clock.advanceUs(1500);
+    view.present();
+    TEST_ASSERT_EQUAL(FB_ROWS + 1, display.tileRows());
+    TEST_ASSERT_EQUAL(FB_WIDTH, view.stats().bytesLast);
+    TEST_ASSERT_EQUAL(1500, view.stats().usLast);
+    TEST_ASSERT_EQUAL_MEMORY(display.buffer(), display.panel(), FB_BYTES);
+}
+
+static void test_led_fade_reaches_level() {
+    FakeLeds strip;
+    LedStatus<5> leds;
+    leds.setLevel(1, 2);
+    leds.tick(1);
+    leds.tick(1 + LED_FADE_MS / 2);
+    strip.show(leds.pixels(), 5);
+    LedColor half = strip.pixels()[1];
+    TEST_ASSERT_TRUE(half.r > 0 && half.r < kLedGamma[kLedPalette[2].r]);
+    TEST_ASSERT_TRUE(leds.animating());
+
+    leds.tick(1 + LED_FADE_MS);
+    strip.show(leds.pixels(), 5);
+    TEST_ASSERT_EQUAL(kLedGamma[kLedPalette[2].r], strip.pixels()[1].r);
+    TEST_ASSERT_EQUAL(kLedGamma[kLedPalette[2].g], strip.pixels()[1].g);
+    TEST_ASSERT_EQUAL(0, strip.pixels()[0].r + strip.pixels()[0].g + strip.pixels()[0].b);
+    TEST_ASSERT_FALSE(leds.animating());
+    TEST_ASSERT_EQUAL(2, strip.shows());
+}
+
+static void test_led_unknown_values_turn_off() {
+    FakeLeds strip;
+    LedStatus<5> leds;
+    const char *known[5] = { "40", "40", "40", "60.0", "20.0" };
+    ledShowReadings(leds, known);
+    leds.tick(1);
+    leds.tick(1 + LED_FADE_MS);
+    strip.show(leds.pixels(), 5);
+    TEST_ASSERT_TRUE(strip.pixels()[3].r + strip.pixels()[3].g + strip.pixels()[3].b > 0);
+
+    // No temperature or humidity sensor: "null" from the mesh, nullptr
+    // for the placeholder, and the LEDs go dark rather than show a level
+    const char *unknown[5] = { "40", "40", "40", "null", nullptr };
+    ledShowReadings(leds, unknown);
+    leds.tick(1 + 2 * LED_FADE_MS);
+    strip.show(leds.pixels(), 5);
+    for (int i = 3; i < 5; i++) {
+        TEST_ASSERT_EQUAL(0, strip.pixels()[i].r + strip.pixels()[i].g + strip.pixels()[i].b);
+    }
+    TEST_ASSERT_TRUE(strip.pixels()[1].g > 0);
+
+    TEST_ASSERT_TRUE(isReadingNumber("21.50"));
+    TEST_ASSERT_TRUE(isReadingNumber("-3"));
+    TEST_ASSERT_FALSE(isReadingNumber("2x"));
+    TEST_ASSERT_FALSE(isReadingNumber("12."));
+    TEST_ASSERT_FALSE(isReadingNumber(""));
+}
+
+static void test_file_storage_round_trip() {
+    char dir[] = "/tmp/aq_storage_XXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+    FileStorage storage(dir);
+    uint32_t out[4] = { 1, 2, 3, 0xDEADBEEF }, in[4] = {};
+    TEST_ASSERT_FALSE(storage.load("boot", in, sizeof(in)));
+    TEST_ASSERT_TRUE(storage.save("boot", out, sizeof(out)));
+    TEST_ASSERT_TRUE(storage.load("boot", in, sizeof(in)));
+    TEST_ASSERT_EQUAL_MEMORY(out, in, sizeof(out));
+    TEST_ASSERT_FALSE(storage.load("boot", in, sizeof(in) - 4));  // A different size is not this blob
+    std::string path = std::string(dir) + "/boot";
+    remove(path.c_str());
+    rmdir(dir);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pms_read_request_bytes);
+    RUN_TEST(test_pms_parses_frame);
+    RUN_TEST(test_pms_frame_split_across_polls);
+    RUN_TEST(test_pms_rejects_bad_checksum);
+    RUN_TEST(test_mesh_broadcast_in_order_to_others);
+    RUN_TEST(test_mesh_send_to_one_node);
+    RUN_TEST(test_oled_view_sends_changed_rows);
+    RUN_TEST(test_led_fade_reaches_level);
+    RUN_TEST(test_led_unknown_values_turn_off);
+    RUN_TEST(test_file_storage_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,95 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        test_main.cpp
+//
+// Description:
+//
+//   Unity tests for include/mem_telemetry.h: fragmentation against the
+//   boot baseline, the heap alert, and TaggedJsonAllocator's counts.
+//
+//   Run:     pio test -e native
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <mem_telemetry.h>
+
+#include <string.h>
+#include <unity.h>
+
+void setUp() {}
+void tearDown() {}
+
+// An ESP32 at boot: five regions, the largest block a third of free
+static const HeapBaseline kBoot = { 180000, 61000 };
+
+static HeapSnapshot snapshot(uint32_t free, uint32_t largest) {
+    HeapSnapshot h = {};
+    h.size = 300000;
+    h.free = free;
+    h.minFree = free;
+    h.largest = largest;
+    h.fragPct = heapFragPct(free, largest, kBoot);
+    return h;
+}
+
+static void test_fresh_heap_is_not_fragmented() {
+    TEST_ASSERT_EQUAL(0, heapFragPct(kBoot.free, kBoot.largest, kBoot));
+    TEST_ASSERT_FALSE(heapAlert(snapshot(kBoot.free, kBoot.largest)));
+
+    // Against total free, as before, the same heap read 67% and alerted
+    HeapBaseline none = {};
+    TEST_ASSERT_EQUAL(67, heapFragPct(kBoot.free, kBoot.largest, none));
+}
+
+static void test_fragmentation_is_loss_of_share() {
+    // Half the memory in use, the largest block shrinking with it: the
+    // share is unchanged, so nothing is fragmented
+    TEST_ASSERT_EQUAL(0, heapFragPct(90000, 30500, kBoot));
+    // Same free, largest block halved / cut to a tenth
+    TEST_ASSERT_EQUAL(50, heapFragPct(180000, 30500, kBoot));
+    TEST_ASSERT_EQUAL(90, heapFragPct(180000, 6100, kBoot));
+    // A better share than at boot counts as none
+    TEST_ASSERT_EQUAL(0, heapFragPct(120000, 61000, kBoot));
+    TEST_ASSERT_EQUAL(0, heapFragPct(0, 0, kBoot));
+    TEST_ASSERT_EQUAL(100, heapFragPct(180000, 0, kBoot));
+}
+
+static void test_alert_thresholds() {
+    TEST_ASSERT_FALSE(heapAlert(snapshot(180000, 30500)));   // 50%
+    TEST_ASSERT_TRUE(heapAlert(snapshot(180000, 12200)));    // 80%
+    TEST_ASSERT_TRUE(heapAlert(snapshot(MEM_LOW_HEAP_BYTES - 1, 8000)));
+}
+
+static void test_allocator_counts_live_and_peak() {
+    MemTagStats stats = {};
+    TaggedJsonAllocator alloc(stats);
+    void *a = alloc.allocate(100);
+    void *b = alloc.allocate(50);
+    TEST_ASSERT_NOT_NULL(a);
+    memset(a, 0x5A, 100);
+    TEST_ASSERT_EQUAL(150, stats.bytesLive);
+    a = alloc.reallocate(a, 300);
+    TEST_ASSERT_EQUAL(0x5A, ((uint8_t *)a)[99]);
+    TEST_ASSERT_EQUAL(350, stats.bytesLive);
+    TEST_ASSERT_EQUAL(350, stats.bytesPeak);
+    alloc.deallocate(a);
+    alloc.deallocate(b);
+    alloc.deallocate(nullptr);
+    TEST_ASSERT_EQUAL(0, stats.bytesLive);
+    TEST_ASSERT_EQUAL(350, stats.bytesPeak);
+    TEST_ASSERT_EQUAL(2, stats.allocs);
+    TEST_ASSERT_EQUAL(2, stats.frees);
+    TEST_ASSERT_EQUAL(0, stats.failures);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_fresh_heap_is_not_fragmented);
+    RUN_TEST(test_fragmentation_is_loss_of_share);
+    RUN_TEST(test_alert_thresholds);
+    RUN_TEST(test_allocator_counts_live_and_peak);
+    return UNITY_END();
+}
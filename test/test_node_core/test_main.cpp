@@ -0,0 +1,92 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        test_main.cpp
+//
+// Description:
+//
+//   Unity tests for NodeCore (include/node_core.h): each node's entry
+//   keeps only what that node sent, and a snapshot carries only the
+//   sending node's own values.
+//
+//   Run:     pio test -e native
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <node_core.h>
+
+#include <unity.h>
+
+static const uint32_t kSelf = 1001;
+static const uint32_t kOther = 1002;
+
+void setUp() {}
+void tearDown() {}
+
+static Reading reading(uint32_t node, const char *pm25, const char *hum) {
+    Reading r = {};
+    r.node = node;
+    copyValue(r.value[0], "3");
+    copyValue(r.value[1], pm25);
+    copyValue(r.value[2], "9");
+    if (hum) {
+        copyValue(r.value[4], hum);
+    }
+    return r;
+}
+
+static void test_snapshot_sends_only_own_values() {
+    static NodeTable table;
+    NodeCore core(table);
+    core.apply(reading(kSelf, "7", nullptr), 100);
+    core.apply(reading(kOther, "55", "40.0"), 200);
+
+    Reading out;
+    core.snapshot(kSelf, 300, out);
+    TEST_ASSERT_EQUAL(kSelf, out.node);
+    TEST_ASSERT_EQUAL_STRING("7", out.value[1]);     // Not the other node's 55
+    TEST_ASSERT_EQUAL_STRING("null", out.value[3]);
+    TEST_ASSERT_EQUAL_STRING("null", out.value[4]);  // Nor its humidity
+    TEST_ASSERT_EQUAL_STRING("55", core.value(1));   // Which still shows locally
+}
+
+static void test_snapshot_without_sensor_is_all_null() {
+    static NodeTable table;
+    NodeCore core(table);
+    core.apply(reading(kOther, "55", "40.0"), 200);
+
+    Reading out;
+    core.snapshot(kSelf, 300, out);
+    for (int i = 0; i < NODE_VALUES; i++) {
+        TEST_ASSERT_EQUAL_STRING("null", out.value[i]);
+    }
+    TEST_ASSERT_NULL(table.find(kSelf));  // Snapshots don't add an entry
+}
+
+static void test_entries_keep_their_own_values() {
+    static NodeTable table;
+    NodeCore core(table);
+    core.apply(reading(kOther, "55", "40.0"), 100);
+    core.apply(reading(kSelf, "7", nullptr), 200);
+    Reading partial = {};
+    partial.node = kOther;
+    copyValue(partial.value[1], "60");
+    core.apply(partial, 300);
+
+    const NodeEntry *other = table.find(kOther);
+    const NodeEntry *self = table.find(kSelf);
+    TEST_ASSERT_EQUAL_STRING("60", other->value[1]);
+    TEST_ASSERT_EQUAL_STRING("40.0", other->value[4]);  // Its own earlier humidity
+    TEST_ASSERT_EQUAL_STRING("7", self->value[1]);
+    TEST_ASSERT_EQUAL_STRING("null", self->value[4]);   // Never the other node's
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_snapshot_sends_only_own_values);
+    RUN_TEST(test_snapshot_without_sensor_is_all_null);
+    RUN_TEST(test_entries_keep_their_own_values);
+    return UNITY_END();
+}
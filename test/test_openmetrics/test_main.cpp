@@ -0,0 +1,136 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        test_main.cpp
+//
+// Description:
+//
+//   Unity tests for MetricsWriter (include/openmetrics.h): family
+//   headers, label escaping, histogram samples, the "# EOF" terminator,
+//   and output that is the same however the buffer splits it.
+//
+//   Run:     pio test -e native
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <openmetrics.h>
+
+#include <string>
+#include <unity.h>
+
+static std::string g_Out;
+static int g_Chunks;
+
+static void collect(const char *data, size_t len) {
+    g_Out.append(data, len);
+    g_Chunks++;
+}
+
+void setUp() {
+    g_Out.clear();
+    g_Chunks = 0;
+}
+
+void tearDown() {}
+
+static void test_family_type_then_help() {
+    MetricsWriter w(collect);
+    w.family("aq_uptime_seconds", "gauge", "Seconds since boot");
+    w.sample("aq_uptime_seconds", "", 12.5);
+    w.finish();
+    TEST_ASSERT_EQUAL_STRING("# TYPE aq_uptime_seconds gauge\n"
+                             "# HELP aq_uptime_seconds Seconds since boot\n"
+                             "aq_uptime_seconds 12.5\n"
+                             "# EOF\n",
+                             g_Out.c_str());
+}
+
+static void test_counter_and_node_samples() {
+    MetricsWriter w(collect);
+    w.family("aq_messages", "counter", "Messages received");
+    w.sample("aq_messages", "_total", 42);
+    w.nodeSample("aq_node_pm25", 3735928559u, 12.3);
+    w.finish();
+    TEST_ASSERT_EQUAL_STRING("# TYPE aq_messages counter\n"
+                             "# HELP aq_messages Messages received\n"
+                             "aq_messages_total 42\n"
+                             "aq_node_pm25{node=\"3735928559\"} 12.3\n"
+                             "# EOF\n",
+                             g_Out.c_str());
+}
+
+static void test_label_value_escaping() {
+    MetricsWriter w(collect);
+    w.labelSample("aq_info", "ssid", "a\"b\\c\nd", 1);
+    w.finish();
+    TEST_ASSERT_EQUAL_STRING("aq_info{ssid=\"a\\\"b\\\\c\\nd\"} 1\n# EOF\n", g_Out.c_str());
+}
+
+static void test_help_escaping_keeps_quotes() {
+    MetricsWriter w(collect);
+    w.family("aq_x", "gauge", "Says \"hi\"\\\nbye");
+    TEST_ASSERT_EQUAL(0, g_Out.size());  // Still buffered
+    w.finish();
+    TEST_ASSERT_EQUAL_STRING("# TYPE aq_x gauge\n# HELP aq_x Says \"hi\"\\\\\\nbye\n# EOF\n", g_Out.c_str());
+}
+
+static void test_escape_never_splits_or_overruns() {
+    char out[6];
+    MetricsWriter::escape("abcd\"e", out, sizeof(out), true);
+    TEST_ASSERT_EQUAL_STRING("abcd", out);  // \" would not fit with the NUL
+    MetricsWriter::escape("abcdefgh", out, sizeof(out), true);
+    TEST_ASSERT_EQUAL_STRING("abcde", out);
+}
+
+static void test_histogram_samples() {
+    MetricsWriter w(collect);
+    w.family("aq_stage_seconds", "histogram", "Time spent in each pipeline stage");
+    w.bucket("aq_stage_seconds", "stage", "render", 0.001, 3);
+    w.bucket("aq_stage_seconds", "stage", "render", 0.004, 7);
+    w.histogramEnd("aq_stage_seconds", "stage", "render", 9, 0.0215);
+    w.finish();
+    TEST_ASSERT_EQUAL_STRING("# TYPE aq_stage_seconds histogram\n"
+                             "# HELP aq_stage_seconds Time spent in each pipeline stage\n"
+                             "aq_stage_seconds_bucket{stage=\"render\",le=\"0.001\"} 3\n"
+                             "aq_stage_seconds_bucket{stage=\"render\",le=\"0.004\"} 7\n"
+                             "aq_stage_seconds_bucket{stage=\"render\",le=\"+Inf\"} 9\n"
+                             "aq_stage_seconds_count{stage=\"render\"} 9\n"
+                             "aq_stage_seconds_sum{stage=\"render\"} 0.0215\n"
+                             "# EOF\n",
+                             g_Out.c_str());
+}
+
+// Many lines cross several buffer flushes; the stream must be the same
+// as one built in a string, end with "# EOF", and no chunk may exceed
+// the buffer
+static void test_large_exposition_across_flushes() {
+    MetricsWriter w(collect);
+    std::string expect;
+    w.family("aq_node_pm25", "gauge", "pm2.5 per node");
+    expect += "# TYPE aq_node_pm25 gauge\n# HELP aq_node_pm25 pm2.5 per node\n";
+    for (uint32_t node = 1; node <= 200; node++) {
+        w.nodeSample("aq_node_pm25", node, node / 4.0);
+        char line[64];
+        snprintf(line, sizeof(line), "aq_node_pm25{node=\"%u\"} %.10g\n", (unsigned)node, node / 4.0);
+        expect += line;
+    }
+    w.finish();
+    expect += "# EOF\n";
+    TEST_ASSERT_EQUAL_STRING(expect.c_str(), g_Out.c_str());
+    TEST_ASSERT_GREATER_THAN(1, g_Chunks);
+    TEST_ASSERT_LESS_OR_EQUAL((int)(expect.size() / OPENMETRICS_BUFFER + 2), g_Chunks);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_family_type_then_help);
+    RUN_TEST(test_counter_and_node_samples);
+    RUN_TEST(test_label_value_escaping);
+    RUN_TEST(test_help_escaping_keeps_quotes);
+    RUN_TEST(test_escape_never_splits_or_overruns);
+    RUN_TEST(test_histogram_samples);
+    RUN_TEST(test_large_exposition_across_flushes);
+    return UNITY_END();
+}
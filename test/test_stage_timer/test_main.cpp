@@ -0,0 +1,139 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        test_main.cpp
+//
+// Description:
+//
+//   Unity tests for LatencyHistogram (include/stage_timer.h): bucket
+//   indexes, the bounds either side of every power of two, percentiles
+//   against exact ranks, and merging.
+//
+//   Run:     pio test -e native
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <stage_timer.h>
+
+#include <algorithm>
+#include <unity.h>
+#include <vector>
+
+void setUp() {}
+void tearDown() {}
+
+static void test_bucket_index_small_values() {
+    // 0 and 1 alone, then two buckets per power of two
+    const uint32_t values[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 11, 12, 15, 16 };
+    const int expect[] = { 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8 };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        TEST_ASSERT_EQUAL(expect[i], LatencyHistogram::bucketIndex(values[i]));
+    }
+    TEST_ASSERT_EQUAL(STAGE_BUCKETS - 1, LatencyHistogram::bucketIndex(UINT32_MAX));
+}
+
+static void test_power_of_two_boundaries() {
+    for (int k = 1; k < 32; k++) {
+        uint32_t p = 1u << k;
+        int i = LatencyHistogram::bucketIndex(p);
+        TEST_ASSERT_EQUAL(2 * k, i);
+        TEST_ASSERT_EQUAL(p, LatencyHistogram::bucketLow(i));
+        TEST_ASSERT_EQUAL(i - 1, LatencyHistogram::bucketIndex(p - 1));
+        TEST_ASSERT_EQUAL(p - 1, LatencyHistogram::bucketMax(i - 1));
+        if (k >= 2) {
+            uint32_t mid = p + p / 2;  // Where the upper half starts
+            TEST_ASSERT_EQUAL(2 * k + 1, LatencyHistogram::bucketIndex(mid));
+            TEST_ASSERT_EQUAL(2 * k, LatencyHistogram::bucketIndex(mid - 1));
+        }
+    }
+    TEST_ASSERT_EQUAL(UINT32_MAX, LatencyHistogram::bucketMax(STAGE_BUCKETS - 1));
+}
+
+// Every bucket covers [low, max], the next starts right after, and no
+// bucket past the first three is more than 50% wider than its low bound
+static void test_buckets_tile_the_range() {
+    for (int i = 0; i < STAGE_BUCKETS; i++) {
+        uint64_t low = LatencyHistogram::bucketLow(i);
+        uint32_t max = LatencyHistogram::bucketMax(i);
+        TEST_ASSERT_EQUAL(i, LatencyHistogram::bucketIndex((uint32_t)low));
+        TEST_ASSERT_EQUAL(i, LatencyHistogram::bucketIndex(max));
+        TEST_ASSERT_EQUAL(LatencyHistogram::bucketHigh(i), (uint64_t)max + 1);
+        if (i + 1 < STAGE_BUCKETS) {
+            TEST_ASSERT_EQUAL(LatencyHistogram::bucketLow(i + 1), (uint64_t)max + 1);
+        }
+        if (i >= 3) {
+            TEST_ASSERT_TRUE(((uint64_t)max + 1 - low) * 2 <= low);
+        }
+    }
+}
+
+static void test_percentile_bounds_exact_rank() {
+    LatencyHistogram h;
+    TEST_ASSERT_EQUAL(0, h.percentile(0.5));
+    std::vector<uint32_t> values;
+    uint32_t v = 7;
+    for (int i = 0; i < 1000; i++) {
+        v = v * 1103515245u + 12345u;
+        values.push_back(v >> 12);  // Up to about a million
+        h.record(values.back());
+    }
+    std::sort(values.begin(), values.end());
+    const double fractions[] = { 0.01, 0.5, 0.9, 0.99 };
+    for (double f : fractions) {
+        uint32_t exact = values[(size_t)(f * values.size() + 0.5) - 1];
+        uint32_t p = h.percentile(f);
+        TEST_ASSERT_EQUAL(LatencyHistogram::bucketIndex(exact), LatencyHistogram::bucketIndex(p));
+        TEST_ASSERT_TRUE(p >= exact);
+        TEST_ASSERT_TRUE(p - exact <= exact / 2);
+    }
+    TEST_ASSERT_EQUAL(values.back(), h.percentile(1.0));  // Capped at the largest seen
+    TEST_ASSERT_EQUAL(values.back(), h.max());
+    TEST_ASSERT_EQUAL(1000, h.count());
+}
+
+static void test_percentile_small_counts() {
+    LatencyHistogram h;
+    h.record(100);
+    TEST_ASSERT_EQUAL(100, h.percentile(0.0));  // Capped at max, not the bucket's 127
+    TEST_ASSERT_EQUAL(100, h.percentile(0.99));
+    h.record(5);
+    TEST_ASSERT_EQUAL(5, h.percentile(0.5));    // Rank 1: bucket 4..5
+    TEST_ASSERT_EQUAL(100, h.percentile(0.75));  // Rank 2 of 2
+}
+
+static void test_merge_matches_recording_together() {
+    LatencyHistogram a, b, both;
+    for (uint32_t v = 1; v <= 5000; v++) {
+        uint32_t x = v * v % 70001;
+        (v & 1 ? a : b).record(x);
+        both.record(x);
+    }
+    a.merge(b);
+    TEST_ASSERT_EQUAL(both.count(), a.count());
+    TEST_ASSERT_EQUAL(both.sum(), a.sum());
+    TEST_ASSERT_EQUAL(both.max(), a.max());
+    for (int i = 0; i < STAGE_BUCKETS; i++) {
+        TEST_ASSERT_EQUAL(both.bucket(i), a.bucket(i));
+    }
+    TEST_ASSERT_EQUAL(both.percentile(0.5), a.percentile(0.5));
+    TEST_ASSERT_EQUAL(both.percentile(0.99), a.percentile(0.99));
+
+    LatencyHistogram empty;
+    a.merge(empty);
+    TEST_ASSERT_EQUAL(both.count(), a.count());
+    empty.merge(b);
+    TEST_ASSERT_EQUAL(b.max(), empty.max());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_index_small_values);
+    RUN_TEST(test_power_of_two_boundaries);
+    RUN_TEST(test_buckets_tile_the_range);
+    RUN_TEST(test_percentile_bounds_exact_rank);
+    RUN_TEST(test_percentile_small_counts);
+    RUN_TEST(test_merge_matches_recording_together);
+    return UNITY_END();
+}
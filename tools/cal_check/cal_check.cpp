@@ -0,0 +1,193 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        cal_check.cpp
+//
+// Description:
+//
+//   Checks the Fixed16 calibration models in calibration.h on a host.
+//   First a table of worked examples, each with the text the firmware
+//   would send; then a sweep of raw values and humidities against the
+//   same formulas in double, which must agree to within half the 0.1
+//   ug/m3 the values are sent with.
+//
+//   Also checks which humidity texts from the mesh are taken.  Exits
+//   non-zero on the first mismatch and prints the largest error of the
+//   sweep per model.
+//
+//   Build:   g++ -O2 -std=c++17 -I../../include cal_check.cpp -o cal_check
+//   Usage:   cal_check
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <calibration.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+struct Example {
+    const char *what;
+    CalModel model;
+    int32_t gain25;         // Thousandths, for pm2.5
+    int32_t offset25;       // Tenths, for pm2.5
+    int rh;                 // Percent; -1 = none known
+    uint16_t raw[3];
+    const char *expect[3];  // As sent, one decimal
+    uint8_t flags;
+};
+
+static const Example kExamples[] = {
+    { "linear, defaults", CAL_LINEAR, 1000, 0, -1, { 5, 8, 12 }, { "5.0", "8.0", "12.0" }, CAL_FLAG_CALIBRATED },
+    { "linear, device gain and offset", CAL_LINEAR, 1100, -20, -1, { 5, 20, 12 }, { "5.0", "20.0", "12.0" },
+      CAL_FLAG_CALIBRATED },
+    { "linear, offset below zero", CAL_LINEAR, 1000, -30, -1, { 5, 2, 12 }, { "5.0", "0.0", "12.0" },
+      CAL_FLAG_CALIBRATED },
+    // 0.524 * 35 - 0.0862 * 50 + 5.75 = 19.78
+    { "epa, 35 at 50%", CAL_EPA, 1000, 0, 50, { 23, 35, 52 }, { "23.0", "19.8", "52.0" }, CAL_FLAG_CALIBRATED },
+    // 0.524 * 150 - 0.0862 * 85 + 5.75 = 77.02
+    { "epa, smoke at 85%", CAL_EPA, 1000, 0, 85, { 100, 150, 160 }, { "100.0", "77.0", "160.0" },
+      CAL_FLAG_CALIBRATED },
+    // 5.75 - 8.62 < 0
+    { "epa, clean and saturated", CAL_EPA, 1000, 0, 100, { 0, 0, 0 }, { "0.0", "0.0", "0.0" }, CAL_FLAG_CALIBRATED },
+    { "epa, no humidity", CAL_EPA, 1000, 0, -1, { 23, 35, 52 }, { "23.0", "35.0", "52.0" },
+      CAL_FLAG_CALIBRATED | CAL_FLAG_NO_HUMIDITY },
+    // 1 + 0.4 * 80 / 20 = 2.6
+    { "kohler, 80%", CAL_KOHLER, 1000, 0, 80, { 26, 50, 65 }, { "10.0", "19.2", "25.0" }, CAL_FLAG_CALIBRATED },
+    // Capped at 95%: 1 + 0.4 * 19 = 8.6
+    { "kohler, 99% capped", CAL_KOHLER, 1000, 0, 99, { 43, 100, 172 }, { "5.0", "11.6", "20.0" },
+      CAL_FLAG_CALIBRATED },
+    { "kohler, dry", CAL_KOHLER, 1000, 0, 0, { 7, 9, 11 }, { "7.0", "9.0", "11.0" }, CAL_FLAG_CALIBRATED },
+};
+
+static CalCoefficients coefficients(CalModel model, int32_t gain25, int32_t offset25) {
+    CalCoefficients c;
+    calDefaults(c);
+    c.model = model;
+    c.gain[1] = Fixed16::fromDecimal(gain25, 3).raw();
+    c.offset[1] = Fixed16::fromDecimal(offset25, 1).raw();
+    calSeal(c);
+    return c;
+}
+
+static bool checkExamples() {
+    for (const Example &e : kExamples) {
+        Calibrator cal;
+        if (!cal.set(coefficients(e.model, e.gain25, e.offset25))) {
+            printf("FAIL %s: coefficients rejected\n", e.what);
+            return false;
+        }
+        if (e.rh >= 0) {
+            cal.humidity(Fixed16::fromInt(e.rh), 1000);
+        }
+        Fixed16 out[CAL_CHANNELS];
+        uint8_t flags = cal.apply(e.raw, 2000, out);
+        for (int i = 0; i < CAL_CHANNELS; i++) {
+            char text[FIXED_FORMAT_MAX];
+            out[i].format(text, 1);
+            if (strcmp(text, e.expect[i]) != 0) {
+                printf("FAIL %s: channel %d gave %s, expected %s\n", e.what, i, text, e.expect[i]);
+                return false;
+            }
+        }
+        if (flags != e.flags) {
+            printf("FAIL %s: flags %02x, expected %02x\n", e.what, flags, e.flags);
+            return false;
+        }
+    }
+    printf("%d examples ok\n", (int)(sizeof(kExamples) / sizeof(kExamples[0])));
+    return true;
+}
+
+// The models in double, as in the papers
+static double reference(CalModel model, double gain, double offset, double rh, int ch, double raw) {
+    double v = raw * gain + offset;
+    if (model == CAL_EPA && ch == 1) {
+        v = 0.524 * v - 0.0862 * rh + 5.75;
+    } else if (model == CAL_KOHLER) {
+        double h = rh > CAL_RH_MAX ? CAL_RH_MAX : rh;
+        v = v / (1 + 0.40 * h / (100 - h));
+    }
+    return v < 0 ? 0 : v;
+}
+
+static bool sweep(CalModel model) {
+    const double gain = 1.083, offset = -1.7;
+    double worst = 0;
+    CalCoefficients c;
+    calDefaults(c);
+    c.model = model;
+    for (int i = 0; i < CAL_CHANNELS; i++) {
+        c.gain[i] = Fixed16::fromDecimal(1083, 3).raw();
+        c.offset[i] = Fixed16::fromDecimal(-17, 1).raw();
+    }
+    calSeal(c);
+    Calibrator cal;
+    cal.set(c);
+    for (int rhTenths = 0; rhTenths <= 1000; rhTenths += 7) {
+        cal.humidity(Fixed16::fromDecimal(rhTenths, 1), 0);
+        for (uint16_t raw = 0; raw <= 1000; raw += 3) {
+            uint16_t in[CAL_CHANNELS] = { raw, raw, raw };
+            Fixed16 out[CAL_CHANNELS];
+            cal.apply(in, 0, out);
+            for (int ch = 0; ch < CAL_CHANNELS; ch++) {
+                double want = reference(model, gain, offset, rhTenths / 10.0, ch, raw);
+                double got = out[ch].raw() / 65536.0;
+                double err = fabs(got - want);
+                worst = err > worst ? err : worst;
+                if (err > 0.05) {
+                    printf("FAIL %s: raw %u at %.1f%% channel %d gave %.4f, expected %.4f\n", kCalModelNames[model],
+                           raw, rhTenths / 10.0, ch, got, want);
+                    return false;
+                }
+            }
+        }
+    }
+    printf("%-7s sweep ok, largest error %.5f ug/m3\n", kCalModelNames[model], worst);
+    return true;
+}
+
+// Only a number from 0 to 100 is a humidity; "null" and the like, from
+// nodes without the sensor, must leave the models falling back to linear
+static bool checkHumidityText() {
+    static const char *const kTaken[] = { "43.20", "0", "100", "7" };
+    static const char *const kIgnored[] = { "null", "", "101", "-1", "43x", "12.", "nan" };
+    for (const char *text : kTaken) {
+        Calibrator cal;
+        if (!cal.humidity(text, 0) || !cal.haveHumidity(0)) {
+            printf("FAIL: humidity \"%s\" not taken\n", text);
+            return false;
+        }
+    }
+    for (const char *text : kIgnored) {
+        Calibrator cal;
+        if (cal.humidity(text, 0) || cal.haveHumidity(0)) {
+            printf("FAIL: humidity \"%s\" taken\n", text);
+            return false;
+        }
+    }
+    printf("humidity text ok\n");
+    return true;
+}
+
+int main() {
+    CalCoefficients c;
+    calDefaults(c);
+    c.gain[0]++;  // Changed without resealing
+    Calibrator cal;
+    if (cal.set(c)) {
+        printf("FAIL: coefficients with a stale CRC accepted\n");
+        return 1;
+    }
+    if (!checkExamples() || !checkHumidityText()) {
+        return 1;
+    }
+    for (int m = 0; m < CAL_MODEL_COUNT; m++) {
+        if (!sweep((CalModel)m)) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,405 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        collector.cpp
+//
+// Description:
+//
+//   Linux collector for a gateway built with SERIAL_BRIDGE.  Reads the
+//   framed reading stream (include/serial_frame.h) from the USB serial
+//   port, a pipe/pty or a recorded capture, and appends every reading to
+//   a CSV file and/or the columnar store in tsdb.h.  Binary log records
+//   (include/binlog.h) in the same stream are formatted to stderr or the
+//   -l file.  All buffers are fixed size, so memory stays flat no matter
+//   how long it runs or how fast readings arrive.
+//
+//   Build:   g++ -O2 -std=c++17 -I../../include collector.cpp -o collector
+//   Usage:   collector [-b baud] [-c capture.bin] [-l log.txt] [-s store] <device|file|-> [out.csv]
+//
+//   -c records everything read, each chunk with the host time it
+//   arrived, so a capture replays with its readings at the times they
+//   were received: a regular file as input is read to the end and then
+//   the collector exits.  Any other regular file is taken as raw bytes
+//   with no times; its CSV rows leave host_ms empty, and -s refuses it
+//   rather than file everything under the time of the replay.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <serial_frame.h>
+#include <binlog.h>
+#include "tsdb.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t g_Stop = 0;
+
+// A -c capture starts with this, then holds each read as [host ms, 8
+// bytes][length, 4 bytes][that many bytes], little-endian
+static const char kCaptureMagic[8] = { 'A', 'Q', 'C', 'A', 'P', '1', '\n', '\0' };
+#define CAPTURE_HEADER  12
+
+enum InputKind {
+    INPUT_LIVE,         // Port, pipe or pty: stamped as read
+    INPUT_CAPTURE,      // Timestamped -c capture: stamped as recorded
+    INPUT_RAW_FILE      // Bytes with no times
+};
+
+static void onSignal(int) {
+    g_Stop = 1;
+}
+
+static int usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [-b baud] [-c capture.bin] [-l log.txt] [-s store] <device|file|-> [out.csv]\n", argv0);
+    return 2;
+}
+
+static speed_t baudConstant(long baud) {
+    switch (baud) {
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default:     return 0;
+    }
+}
+
+// Puts a tty into raw mode at the given rate; pipes and files are left alone
+static bool configurePort(int fd, long baud) {
+    if (!isatty(fd)) {
+        return true;
+    }
+    speed_t speed = baudConstant(baud);
+    if (!speed) {
+        fprintf(stderr, "unsupported baud rate %ld\n", baud);
+        return false;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+        perror("tcgetattr");
+        return false;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+static uint64_t nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Hundredths back to text, e.g. -350 -> "-3.50"
+static int formatHundredths(char *out, int32_t v) {
+    const char *sign = v < 0 ? "-" : "";
+    uint32_t a = v < 0 ? -(uint32_t)v : v;
+    return sprintf(out, "%s%u.%02u", sign, a / 100, a % 100);
+}
+
+static void putLe(uint8_t *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static uint64_t getLe(const uint8_t *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        v = v << 8 | p[i];
+    }
+    return v;
+}
+
+// Reads len bytes unless the input ends first; returns how many, or -1
+static ssize_t readFull(int fd, uint8_t *p, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, p + got, len - got);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        got += n;
+    }
+    return got;
+}
+
+// A regular file is a capture if it starts with kCaptureMagic, and is
+// left just past it; anything else is read from the start
+static InputKind inputKind(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return INPUT_LIVE;
+    }
+    uint8_t head[sizeof(kCaptureMagic)];
+    if (readFull(fd, head, sizeof(head)) == (ssize_t)sizeof(head) && memcmp(head, kCaptureMagic, sizeof(head)) == 0) {
+        return INPUT_CAPTURE;
+    }
+    lseek(fd, 0, SEEK_SET);
+    return INPUT_RAW_FILE;
+}
+
+// Opens a capture to append to, writing the magic if it is new; an old
+// raw capture can't be continued with timestamped records
+static FILE *openCapture(const char *path) {
+    FILE *f = fopen(path, "ab+");
+    if (!f) {
+        perror(path);
+        return nullptr;
+    }
+    struct stat st;
+    char head[sizeof(kCaptureMagic)];
+    bool ok = fstat(fileno(f), &st) == 0;
+    if (ok && st.st_size == 0) {
+        ok = fwrite(kCaptureMagic, 1, sizeof(kCaptureMagic), f) == sizeof(kCaptureMagic);
+    } else if (ok) {
+        ok = fseek(f, 0, SEEK_SET) == 0 && fread(head, 1, sizeof(head), f) == sizeof(head) &&
+             memcmp(head, kCaptureMagic, sizeof(head)) == 0;
+        if (!ok) {
+            fprintf(stderr, "%s: not a timestamped capture; won't append to it\n", path);
+        }
+    }
+    if (!ok) {
+        fclose(f);
+        return nullptr;
+    }
+    return f;
+}
+
+struct Stats {
+    uint64_t bytes;
+    uint64_t readings;
+    uint64_t logs;
+    uint64_t otherFrames;
+};
+
+int main(int argc, char **argv) {
+    long baud = 921600;
+    const char *capturePath = nullptr;
+    const char *storePath = nullptr;
+    const char *logPath = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:c:l:s:")) != -1) {
+        switch (opt) {
+        case 'b': baud = atol(optarg); break;
+        case 'c': capturePath = optarg; break;
+        case 'l': logPath = optarg; break;
+        case 's': storePath = optarg; break;
+        default:  return usage(argv[0]);
+        }
+    }
+    int positional = argc - optind;
+    if (positional < 1 || positional > 2 || (positional == 1 && !storePath)) {
+        return usage(argv[0]);
+    }
+    const char *inputPath = argv[optind];
+    const char *outputPath = positional == 2 ? argv[optind + 1] : nullptr;
+
+    int fd = strcmp(inputPath, "-") == 0 ? STDIN_FILENO : open(inputPath, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        perror(inputPath);
+        return 1;
+    }
+    if (!configurePort(fd, baud)) {
+        return 1;
+    }
+    InputKind input = inputKind(fd);
+    if (input == INPUT_RAW_FILE && storePath) {
+        fprintf(stderr, "%s: no arrival times in this file, so -s can't date its readings; "
+                        "record captures with -c\n", inputPath);
+        return 1;
+    }
+
+    FILE *capture = nullptr;
+    if (capturePath) {
+        capture = openCapture(capturePath);
+        if (!capture) {
+            return 1;
+        }
+    }
+
+    FILE *out = nullptr;
+    if (outputPath) {
+        out = fopen(outputPath, "a");
+        if (!out) {
+            perror(outputPath);
+            return 1;
+        }
+        static char outBuffer[1 << 16];
+        setvbuf(out, outBuffer, _IOFBF, sizeof(outBuffer));
+        struct stat st;
+        if (fstat(fileno(out), &st) == 0 && st.st_size == 0) {
+            fputs("host_ms,node,node_ms,pm1_0,pm2_5,pm10_0,temp,hum\n", out);
+        }
+    }
+
+    tsdb::Writer *store = nullptr;  // Large; kept off the stack
+    bool storeFailed = false;       // Stops the run and fails the exit status
+    if (storePath) {
+        store = new tsdb::Writer(storePath);
+    }
+
+    FILE *logOut = stderr;
+    if (logPath) {
+        logOut = fopen(logPath, "a");
+        if (!logOut) {
+            perror(logPath);
+            return 1;
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    FrameDecoder decoder;
+    Stats stats = {};
+    uint8_t buf[4096];
+    uint64_t lastFlush = nowMs();
+    uint64_t lastBlock = lastFlush;
+
+    while (!g_Stop) {
+        ssize_t n;
+        uint64_t host = 0;  // When the bytes arrived; 0 if nobody knows
+        if (input == INPUT_CAPTURE) {
+            uint8_t head[CAPTURE_HEADER];
+            ssize_t got = readFull(fd, head, sizeof(head));
+            if (got == 0) {
+                break;  // End of capture
+            }
+            uint32_t len = getLe(head + 8, 4);
+            if (got != (ssize_t)sizeof(head) || len > sizeof(buf) || (n = readFull(fd, buf, len)) != (ssize_t)len) {
+                fprintf(stderr, "%s: capture truncated or damaged after %llu bytes\n", inputPath,
+                        (unsigned long long)stats.bytes);
+                break;
+            }
+            host = getLe(head, 8);
+        } else {
+            n = read(fd, buf, sizeof(buf));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                perror("read");
+                break;
+            }
+            if (n == 0) {
+                break;  // End of file or pipe closed
+            }
+            host = input == INPUT_LIVE ? nowMs() : 0;  // One timestamp per read is plenty
+        }
+        stats.bytes += n;
+        if (capture) {
+            uint8_t head[CAPTURE_HEADER];
+            putLe(head, host, 8);
+            putLe(head + 8, n, 4);
+            fwrite(head, 1, sizeof(head), capture);
+            fwrite(buf, 1, n, capture);
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (!decoder.feed(buf[i])) {
+                continue;
+            }
+            if (decoder.type() == FRAME_TYPE_LOG) {
+                LogRecord rec;
+                if (decodeLogRecord(decoder.payload(), decoder.payloadLen(), rec)) {
+                    char text[256];
+                    formatLogRecord(text, sizeof(text), rec);
+                    fprintf(logOut, "%s\n", text);
+                    stats.logs++;
+                } else {
+                    stats.otherFrames++;
+                }
+                continue;
+            }
+            WireReading r;
+            if (decoder.type() != FRAME_TYPE_READING ||
+                !decodeReading(decoder.payload(), decoder.payloadLen(), r)) {
+                stats.otherFrames++;
+                continue;
+            }
+            if (out) {
+                char line[160];
+                int len = host ? sprintf(line, "%llu,%u,%u", (unsigned long long)host, r.node, r.time)
+                               : sprintf(line, ",%u,%u", r.node, r.time);
+                for (int v = 0; v < 5; v++) {
+                    line[len++] = ',';
+                    len += formatHundredths(line + len, r.value[v]);
+                }
+                line[len++] = '\n';
+                fwrite(line, 1, len, out);
+            }
+            if (store) {
+                tsdb::Row row;
+                row.time = host;
+                row.node = r.node;
+                memcpy(row.value, r.value, sizeof(row.value));
+                if (!store->append(row)) {
+                    storeFailed = true;
+                    g_Stop = 1;
+                    break;
+                }
+            }
+            stats.readings++;
+        }
+
+        uint64_t wall = nowMs();
+        if (wall - lastFlush >= 1000) {
+            if (out) {
+                fflush(out);
+            }
+            if (capture) {
+                fflush(capture);
+            }
+            fflush(logOut);
+            lastFlush = wall;
+        }
+        if (store && wall - lastBlock >= 60000) {
+            if (!store->flush()) {  // Bounds what a crash can lose on a slow mesh
+                storeFailed = true;
+                g_Stop = 1;
+            }
+            lastBlock = wall;
+        }
+    }
+
+    if (out) {
+        fclose(out);
+    }
+    if (store) {
+        storeFailed = !store->close() || storeFailed;  // Writes the last partial block
+        delete store;
+    }
+    if (capture) {
+        fclose(capture);
+    }
+    if (logOut != stderr) {
+        fclose(logOut);
+    }
+    fprintf(stderr, "%llu bytes, %llu readings, %llu log records, %u bad frames, %llu other frames\n",
+            (unsigned long long)stats.bytes, (unsigned long long)stats.readings, (unsigned long long)stats.logs,
+            decoder.errors(), (unsigned long long)stats.otherFrames);
+    return storeFailed ? 1 : 0;
+}
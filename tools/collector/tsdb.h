@@ -0,0 +1,414 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        tsdb.h
+//
+// Description:
+//
+//   Columnar time-series store for collected mesh readings (host only).
+//
+//   <root>/<YYYY-MM-DD>/          one partition per UTC day
+//       time.col node.col         one file per column
+//       pm1_0.col ... hum.col
+//       index.idx                 one BlockIndex per block
+//
+//   Rows are written in blocks of up to TSDB_BLOCK_ROWS.  Each column of
+//   a block is zigzag delta encoded into varints and appended to its
+//   file; the index record is appended last, so a block cut short by a
+//   crash is simply never seen.  The index doubles as a sparse time
+//   index: readers mmap it, skip blocks outside the query range and only
+//   decode the columns they ask for.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+#define TSDB_BLOCK_ROWS 4096
+#define TSDB_DAY_MS     86400000ULL
+
+namespace tsdb {
+
+enum Column { kTime, kNode, kPm1_0, kPm2_5, kPm10_0, kTemp, kHum, kColumns };
+
+static const char *const kColumnNames[kColumns] = {
+    "time", "node", "pm1_0", "pm2_5", "pm10_0", "temp", "hum"
+};
+
+// Looks a metric column up by name; returns kColumns if unknown
+inline int columnByName(const char *name) {
+    for (int c = kPm1_0; c < kColumns; c++) {
+        if (strcmp(kColumnNames[c], name) == 0) {
+            return c;
+        }
+    }
+    return kColumns;
+}
+
+struct Row {
+    uint64_t time;              // Host time, ms since the epoch
+    uint32_t node;
+    int32_t value[5];           // Hundredths, same order as the metric columns
+};
+
+struct BlockIndex {
+    uint64_t timeMin;
+    uint64_t timeMax;
+    uint32_t rows;
+    uint32_t reserved;
+    uint64_t offset[kColumns];  // Byte offset of the block in each column file
+    uint32_t bytes[kColumns];   // Encoded size in each column file
+    uint32_t reserved2;
+};
+static_assert(sizeof(BlockIndex) == 24 + 8 * kColumns + 4 * kColumns + 4, "BlockIndex layout");
+
+// Worst case for one encoded column of a block
+#define TSDB_MAX_COLUMN_BYTES (TSDB_BLOCK_ROWS * 10)
+
+inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Delta + zigzag + LEB128 varint.  Returns bytes written.
+inline size_t encodeColumn(const int64_t *values, uint32_t count, uint8_t *out) {
+    size_t n = 0;
+    int64_t prev = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t v = zigzag(values[i] - prev);
+        prev = values[i];
+        while (v >= 0x80) {
+            out[n++] = (uint8_t)v | 0x80;
+            v >>= 7;
+        }
+        out[n++] = (uint8_t)v;
+    }
+    return n;
+}
+
+// Inverse of encodeColumn; returns false if the data is truncated
+inline bool decodeColumn(const uint8_t *in, size_t len, uint32_t count, int64_t *values) {
+    const uint8_t *end = in + len;
+    int64_t prev = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t v = 0;
+        int shift = 0;
+        while (true) {
+            if (in == end || shift > 63) {
+                return false;
+            }
+            uint8_t b = *in++;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                break;
+            }
+            shift += 7;
+        }
+        prev += unzigzag(v);
+        values[i] = prev;
+    }
+    return true;
+}
+
+inline std::string dayName(uint64_t day) {
+    time_t t = (time_t)(day * (TSDB_DAY_MS / 1000));
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char name[16];
+    strftime(name, sizeof(name), "%Y-%m-%d", &tm);
+    return name;
+}
+
+// "YYYY-MM-DD" to days since the epoch; returns -1 if malformed
+inline int64_t dayFromName(const char *name) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if (!strptime(name, "%Y-%m-%d", &tm)) {
+        return -1;
+    }
+    return timegm(&tm) / (time_t)(TSDB_DAY_MS / 1000);
+}
+
+// Appends rows; expects them roughly in time order
+class Writer {
+public:
+    explicit Writer(const std::string &root) : m_root(root) {
+        mkdir(m_root.c_str(), 0755);
+        for (int c = 0; c < kColumns; c++) {
+            m_fd[c] = -1;
+        }
+    }
+
+    ~Writer() { close(); }
+
+    bool append(const Row &row) {
+        int64_t day = row.time / TSDB_DAY_MS;
+        if (day != m_day) {
+            if (!flush() || !openDay(day)) {
+                return false;
+            }
+        }
+        m_rows[m_count++] = row;
+        return m_count < TSDB_BLOCK_ROWS || flush();
+    }
+
+    // Writes the partial block; later rows start a new one
+    bool flush() {
+        if (m_count == 0) {
+            return true;
+        }
+        BlockIndex idx;
+        memset(&idx, 0, sizeof(idx));
+        idx.rows = m_count;
+        idx.timeMin = idx.timeMax = m_rows[0].time;
+        for (uint32_t i = 0; i < m_count; i++) {
+            idx.timeMin = m_rows[i].time < idx.timeMin ? m_rows[i].time : idx.timeMin;
+            idx.timeMax = m_rows[i].time > idx.timeMax ? m_rows[i].time : idx.timeMax;
+        }
+
+        for (int c = 0; c < kColumns; c++) {
+            for (uint32_t i = 0; i < m_count; i++) {
+                const Row &r = m_rows[i];
+                m_scratch[i] = c == kTime ? (int64_t)r.time : c == kNode ? (int64_t)r.node : r.value[c - kPm1_0];
+            }
+            size_t len = encodeColumn(m_scratch, m_count, m_encoded);
+            if (!writeAll(m_fd[c], m_encoded, len)) {
+                return false;
+            }
+            idx.offset[c] = m_offset[c];
+            idx.bytes[c] = len;
+            m_offset[c] += len;
+            m_written[c] += len;
+        }
+        m_count = 0;
+        return writeAll(m_indexFd, &idx, sizeof(idx));
+    }
+
+    // Returns false if the last block couldn't be written
+    bool close() {
+        bool ok = flush();
+        closeFiles();
+        return ok;
+    }
+
+    uint64_t bytesWritten() const {
+        uint64_t total = 0;
+        for (int c = 0; c < kColumns; c++) {
+            total += m_written[c];
+        }
+        return total;
+    }
+
+private:
+    bool openDay(int64_t day) {
+        closeFiles();
+        std::string dir = m_root + "/" + dayName(day);
+        mkdir(dir.c_str(), 0755);
+
+        // Drop anything past the last indexed block left by a crash
+        std::string indexPath = dir + "/index.idx";
+        m_indexFd = open(indexPath.c_str(), O_RDWR | O_CREAT, 0644);
+        if (m_indexFd < 0) {
+            perror(indexPath.c_str());
+            return false;
+        }
+        struct stat st;
+        if (fstat(m_indexFd, &st) != 0) {
+            return fail(indexPath);
+        }
+        off_t blocks = st.st_size / sizeof(BlockIndex);
+        BlockIndex last;
+        memset(&last, 0, sizeof(last));
+        if (blocks > 0 &&
+            pread(m_indexFd, &last, sizeof(last), (blocks - 1) * sizeof(BlockIndex)) != (ssize_t)sizeof(last)) {
+            return fail(indexPath);
+        }
+        if (ftruncate(m_indexFd, blocks * sizeof(BlockIndex)) != 0 || lseek(m_indexFd, 0, SEEK_END) < 0) {
+            return fail(indexPath);
+        }
+
+        for (int c = 0; c < kColumns; c++) {
+            std::string path = dir + "/" + kColumnNames[c] + ".col";
+            m_fd[c] = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+            if (m_fd[c] < 0) {
+                return fail(path);
+            }
+            m_offset[c] = blocks > 0 ? last.offset[c] + last.bytes[c] : 0;
+
+            // Shorter than the index says: truncating would pad it with
+            // zeros that decode as rows, so stop instead
+            if (fstat(m_fd[c], &st) != 0) {
+                return fail(path);
+            }
+            if ((uint64_t)st.st_size < m_offset[c]) {
+                fprintf(stderr, "%s: %llu bytes, index expects %llu\n", path.c_str(),
+                        (unsigned long long)st.st_size, (unsigned long long)m_offset[c]);
+                closeFiles();
+                return false;
+            }
+            if (ftruncate(m_fd[c], m_offset[c]) != 0 || lseek(m_fd[c], m_offset[c], SEEK_SET) < 0) {
+                return fail(path);
+            }
+        }
+        m_day = day;
+        return true;
+    }
+
+    // Reports errno against path and leaves no day open
+    bool fail(const std::string &path) {
+        perror(path.c_str());
+        closeFiles();
+        return false;
+    }
+
+    void closeFiles() {
+        for (int c = 0; c < kColumns; c++) {
+            if (m_fd[c] >= 0) {
+                ::close(m_fd[c]);
+                m_fd[c] = -1;
+            }
+        }
+        if (m_indexFd >= 0) {
+            ::close(m_indexFd);
+            m_indexFd = -1;
+        }
+        m_day = -1;
+    }
+
+    bool writeAll(int fd, const void *data, size_t len) {
+        const uint8_t *p = (const uint8_t *)data;
+        while (len) {
+            ssize_t n = write(fd, p, len);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                perror("write");
+                return false;
+            }
+            p += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    std::string m_root;
+    int64_t m_day = -1;
+    int m_fd[kColumns];
+    int m_indexFd = -1;
+    uint64_t m_offset[kColumns] = {};
+    uint64_t m_written[kColumns] = {};
+    Row m_rows[TSDB_BLOCK_ROWS];
+    uint32_t m_count = 0;
+    int64_t m_scratch[TSDB_BLOCK_ROWS];
+    uint8_t m_encoded[TSDB_MAX_COLUMN_BYTES];
+};
+
+// Read-only view of one day, memory mapped.  Column files are only
+// mapped the first time a query touches them.
+class Partition {
+public:
+    Partition() {
+        for (int c = 0; c < kColumns; c++) {
+            m_col[c] = nullptr;
+            m_colLen[c] = 0;
+        }
+    }
+
+    ~Partition() {
+        unmap((void *)m_index, m_indexLen);
+        for (int c = 0; c < kColumns; c++) {
+            unmap((void *)m_col[c], m_colLen[c]);
+        }
+    }
+
+    Partition(const Partition &) = delete;
+    Partition &operator=(const Partition &) = delete;
+
+    // Returns false if the day has no data
+    bool open(const std::string &root, uint64_t day) {
+        m_dir = root + "/" + dayName(day);
+        size_t len;
+        m_index = (const BlockIndex *)map(m_dir + "/index.idx", &len);
+        m_indexLen = len;
+        m_blocks = len / sizeof(BlockIndex);
+        return m_index != nullptr && m_blocks > 0;
+    }
+
+    size_t blocks() const { return m_blocks; }
+    const BlockIndex &block(size_t i) const { return m_index[i]; }
+
+    // Decodes one column of one block into out[0 .. rows)
+    bool column(size_t block, int c, int64_t *out) {
+        if (!m_col[c]) {
+            size_t len;
+            m_col[c] = (const uint8_t *)map(m_dir + "/" + kColumnNames[c] + ".col", &len);
+            m_colLen[c] = len;
+            if (!m_col[c]) {
+                return false;
+            }
+        }
+        const BlockIndex &b = m_index[block];
+        if (b.offset[c] + b.bytes[c] > m_colLen[c]) {
+            return false;
+        }
+        m_bytesRead += b.bytes[c];
+        return decodeColumn(m_col[c] + b.offset[c], b.bytes[c], b.rows, out);
+    }
+
+    uint64_t bytesRead() const { return m_bytesRead; }
+
+private:
+    static const void *map(const std::string &path, size_t *len) {
+        *len = 0;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st;
+        void *p = nullptr;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                p = nullptr;
+            } else {
+                *len = st.st_size;
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+        return p;
+    }
+
+    static void unmap(void *p, size_t len) {
+        if (p) {
+            munmap(p, len);
+        }
+    }
+
+    std::string m_dir;
+    const BlockIndex *m_index = nullptr;
+    size_t m_indexLen = 0;
+    size_t m_blocks = 0;
+    const uint8_t *m_col[kColumns];
+    size_t m_colLen[kColumns];
+    uint64_t m_bytesRead = 0;
+};
+
+}  // namespace tsdb
@@ -0,0 +1,277 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        tsq.cpp
+//
+// Description:
+//
+//   Command line front end for the columnar store in tsdb.h.
+//
+//   Build:   g++ -O2 -std=c++17 tsq.cpp -o tsq
+//
+//   tsq import <root> <collector.csv>...
+//       Loads CSV written by the collector into the store.
+//
+//   tsq hourly <root> <metric> <from> <to>
+//       Mean and max of a metric (pm1_0, pm2_5, pm10_0, temp, hum) per
+//       node per UTC hour for the days from..to (YYYY-MM-DD, inclusive).
+//       Only blocks overlapping the range are decoded, and only the time,
+//       node and metric columns.
+//
+//   tsq gen <root> <readings> <nodes> <from> <days>
+//       Writes a synthetic dataset for benchmarking, e.g. 100000000
+//       readings from 200 nodes over 30 days.
+//
+//   Timing and scan statistics go to stderr so stdout stays parseable.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include "tsdb.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace tsdb;
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int usage() {
+    fprintf(stderr,
+            "usage: tsq import <root> <csv>...\n"
+            "       tsq hourly <root> <metric> <from> <to>\n"
+            "       tsq gen <root> <readings> <nodes> <from> <days>\n");
+    return 2;
+}
+
+// Parses "12.34" style CSV fields written by the collector into hundredths
+static int32_t parseHundredths(const char *&p) {
+    bool negative = *p == '-';
+    if (negative) {
+        p++;
+    }
+    int32_t whole = 0;
+    while (*p >= '0' && *p <= '9') {
+        whole = whole * 10 + (*p++ - '0');
+    }
+    int32_t frac = 0;
+    if (*p == '.') {
+        p++;
+        for (int i = 0; i < 2; i++) {
+            frac *= 10;
+            if (*p >= '0' && *p <= '9') {
+                frac += *p++ - '0';
+            }
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    int32_t v = whole * 100 + frac;
+    return negative ? -v : v;
+}
+
+static int cmdImport(const char *root, int files, char **paths) {
+    std::unique_ptr<Writer> writer(new Writer(root));
+    auto start = std::chrono::steady_clock::now();
+    uint64_t rows = 0;
+    uint64_t skipped = 0;
+    char line[256];
+
+    for (int f = 0; f < files; f++) {
+        FILE *in = fopen(paths[f], "r");
+        if (!in) {
+            perror(paths[f]);
+            return 1;
+        }
+        while (fgets(line, sizeof(line), in)) {
+            // host_ms,node,node_ms,pm1_0,pm2_5,pm10_0,temp,hum
+            const char *p = line;
+            if (*p < '0' || *p > '9') {
+                skipped++;  // Header
+                continue;
+            }
+            Row row;
+            char *end;
+            row.time = strtoull(p, &end, 10);
+            row.node = strtoul(end + 1, &end, 10);
+            strtoul(end + 1, &end, 10);
+            p = end;
+            for (int v = 0; v < 5 && *p == ',';) {
+                p++;
+                row.value[v++] = parseHundredths(p);
+            }
+            if (!writer->append(row)) {
+                return 1;
+            }
+            rows++;
+        }
+        fclose(in);
+    }
+    if (!writer->close()) {
+        return 1;
+    }
+    fprintf(stderr, "imported %llu rows (%llu skipped) in %.2fs, %.1f bytes/row\n",
+            (unsigned long long)rows, (unsigned long long)skipped, secondsSince(start),
+            rows ? (double)writer->bytesWritten() / rows : 0.0);
+    return 0;
+}
+
+static int cmdGen(const char *root, uint64_t readings, uint32_t nodes, const char *from, uint32_t days) {
+    int64_t firstDay = dayFromName(from);
+    if (firstDay < 0 || nodes == 0 || days == 0) {
+        return usage();
+    }
+    std::unique_ptr<Writer> writer(new Writer(root));
+    auto start = std::chrono::steady_clock::now();
+
+    // Nodes report round-robin, evenly spaced over the whole span
+    uint64_t t0 = firstDay * TSDB_DAY_MS;
+    double step = (double)days * TSDB_DAY_MS / readings;
+    uint32_t rng = 12345;
+    for (uint64_t i = 0; i < readings; i++) {
+        Row row;
+        row.time = t0 + (uint64_t)(i * step);
+        row.node = 100000 + (uint32_t)(i % nodes);
+        rng = rng * 1664525 + 1013904223;
+        double hour = (row.time % TSDB_DAY_MS) / 3600000.0;
+        int32_t base = (int32_t)(1200 + 800 * sin(hour / 24 * 2 * M_PI) + (row.node % 17) * 50);
+        int32_t noise = (int32_t)(rng >> 24) - 128;
+        row.value[0] = base * 6 / 10 + noise / 2;
+        row.value[1] = base + noise;
+        row.value[2] = base * 14 / 10 + noise;
+        row.value[3] = 2000 + (int32_t)(500 * sin(hour / 24 * 2 * M_PI));
+        row.value[4] = 4500 + (noise & 0x3F);
+        if (!writer->append(row)) {
+            return 1;
+        }
+    }
+    if (!writer->close()) {
+        return 1;
+    }
+    double secs = secondsSince(start);
+    fprintf(stderr, "wrote %llu rows in %.2fs (%.0f rows/s), %.2f bytes/row\n",
+            (unsigned long long)readings, secs, readings / secs, (double)writer->bytesWritten() / readings);
+    return 0;
+}
+
+struct HourStats {
+    uint32_t count;
+    int32_t max;
+    int64_t sum;
+};
+
+static int cmdHourly(const char *root, const char *metric, const char *from, const char *to) {
+    int column = columnByName(metric);
+    int64_t firstDay = dayFromName(from);
+    int64_t lastDay = dayFromName(to);
+    if (column == kColumns || firstDay < 0 || lastDay < firstDay) {
+        return usage();
+    }
+    uint64_t t0 = firstDay * TSDB_DAY_MS;
+    uint64_t t1 = (lastDay + 1) * TSDB_DAY_MS;
+    size_t hours = (t1 - t0) / 3600000;
+
+    auto start = std::chrono::steady_clock::now();
+    std::unordered_map<uint32_t, std::vector<HourStats>> perNode;
+    std::vector<int64_t> times(TSDB_BLOCK_ROWS), nodes(TSDB_BLOCK_ROWS), values(TSDB_BLOCK_ROWS);
+    uint64_t blocksRead = 0, blocksSkipped = 0, rowsScanned = 0, bytesRead = 0;
+
+    for (int64_t day = firstDay; day <= lastDay; day++) {
+        Partition part;
+        if (!part.open(root, day)) {
+            continue;
+        }
+        for (size_t b = 0; b < part.blocks(); b++) {
+            const BlockIndex &idx = part.block(b);
+            if (idx.timeMax < t0 || idx.timeMin >= t1) {
+                blocksSkipped++;
+                continue;
+            }
+            if (!part.column(b, kTime, times.data()) || !part.column(b, kNode, nodes.data()) ||
+                !part.column(b, column, values.data())) {
+                fprintf(stderr, "corrupt block %zu in %s\n", b, dayName(day).c_str());
+                continue;
+            }
+            blocksRead++;
+            rowsScanned += idx.rows;
+
+            uint32_t lastNode = 0;
+            std::vector<HourStats> *slots = nullptr;
+            for (uint32_t i = 0; i < idx.rows; i++) {
+                uint64_t t = times[i];
+                if (t < t0 || t >= t1) {
+                    continue;
+                }
+                uint32_t node = nodes[i];
+                if (!slots || node != lastNode) {
+                    slots = &perNode[node];
+                    if (slots->empty()) {
+                        slots->assign(hours, HourStats{0, INT32_MIN, 0});
+                    }
+                    lastNode = node;
+                }
+                HourStats &h = (*slots)[(t - t0) / 3600000];
+                int32_t v = values[i];
+                h.count++;
+                h.sum += v;
+                h.max = v > h.max ? v : h.max;
+            }
+        }
+        bytesRead += part.bytesRead();
+    }
+    double secs = secondsSince(start);
+
+    printf("node,hour,count,mean_%s,max_%s\n", metric, metric);
+    std::vector<uint32_t> order;
+    for (auto &kv : perNode) {
+        order.push_back(kv.first);
+    }
+    std::sort(order.begin(), order.end());
+    for (uint32_t node : order) {
+        const std::vector<HourStats> &slots = perNode[node];
+        for (size_t h = 0; h < hours; h++) {
+            if (!slots[h].count) {
+                continue;
+            }
+            time_t hourStart = (t0 + h * 3600000) / 1000;
+            struct tm tm;
+            gmtime_r(&hourStart, &tm);
+            char when[24];
+            strftime(when, sizeof(when), "%Y-%m-%dT%H:00Z", &tm);
+            printf("%u,%s,%u,%.2f,%.2f\n", node, when, slots[h].count,
+                   slots[h].sum / 100.0 / slots[h].count, slots[h].max / 100.0);
+        }
+    }
+    fprintf(stderr, "scanned %llu rows in %llu blocks (%llu skipped), %.1f MB decoded, %.3fs, %.0f rows/s\n",
+            (unsigned long long)rowsScanned, (unsigned long long)blocksRead, (unsigned long long)blocksSkipped,
+            bytesRead / 1e6, secs, rowsScanned / secs);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        return usage();
+    }
+    const char *cmd = argv[1];
+    if (strcmp(cmd, "import") == 0 && argc >= 4) {
+        return cmdImport(argv[2], argc - 3, argv + 3);
+    }
+    if (strcmp(cmd, "hourly") == 0 && argc == 6) {
+        return cmdHourly(argv[2], argv[3], argv[4], argv[5]);
+    }
+    if (strcmp(cmd, "gen") == 0 && argc == 7) {
+        return cmdGen(argv[2], strtoull(argv[3], nullptr, 10), strtoul(argv[4], nullptr, 10), argv[5],
+                      strtoul(argv[6], nullptr, 10));
+    }
+    return usage();
+}
@@ -0,0 +1,199 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        fixed_bench.cpp
+//
+// Description:
+//
+//   Checks Fixed16 against exact decimal text and times it against the
+//   float path the old firmware used: strtof() to read a value and
+//   String(float) to print one.  Arduino's String is not available on a
+//   host, so std::string built from snprintf("%.2f") stands in for it;
+//   both format into a heap-allocated string.
+//
+//   The checks exit non-zero on the first mismatch.  The last line is a
+//   checksum over a fixed sweep of arithmetic results; the same build of
+//   fixed_point.h must print the same value on every machine.
+//
+//   Build:   g++ -O2 -std=c++17 -I../../include fixed_bench.cpp -o fixed_bench
+//   Usage:   fixed_bench [iterations]
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <fixed_point.h>
+#include <aqi.h>
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Keeps the optimizer from dropping work whose result is unused
+static volatile uint32_t g_sink;
+
+// Every hundredth from -100.00 to 1000.00 must survive parse and format
+static bool checkRoundTrip() {
+    for (int32_t h = -10000; h <= 100000; h++) {
+        char text[FIXED_FORMAT_MAX];
+        snprintf(text, sizeof(text), "%s%d.%02d", h < 0 ? "-" : "", abs(h) / 100, abs(h) % 100);
+        Fixed16 v = Fixed16::parse(text);
+        char out[FIXED_FORMAT_MAX];
+        v.format(out, 2);
+        if (strcmp(text, out) != 0 || v.toDecimal(2) != h) {
+            fprintf(stderr, "round trip: %s -> %s (%lld)\n", text, out, (long long)v.toDecimal(2));
+            return false;
+        }
+        if (h >= 0 && v.truncDecimal(1) != h / 10) {
+            fprintf(stderr, "truncate: %s -> %lld\n", text, (long long)v.truncDecimal(1));
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool checkArithmetic() {
+    struct Case {
+        Fixed16 got;
+        const char *expect;
+    } cases[] = {
+        { Fixed16::fromDecimal(125, 1) + Fixed16::fromDecimal(-35, 1), "9.00" },
+        { Fixed16::fromDecimal(15, 1) * Fixed16::fromDecimal(-25, 1), "-3.75" },
+        { Fixed16::fromInt(10) / Fixed16::fromInt(3), "3.33" },
+        { Fixed16::fromInt(-10) / Fixed16::fromInt(3), "-3.33" },
+        { Fixed16::fromInt(2) / 3, "0.67" },
+        { Fixed16::fromInt(32000) + Fixed16::fromInt(1000), "32768.00" },  // Saturated
+        { Fixed16::fromInt(-32000) - Fixed16::fromInt(1000), "-32768.00" },
+        { Fixed16::fromInt(1) / Fixed16(), "32768.00" },
+        { -Fixed16::minValue(), "32768.00" },
+        { Fixed16::parse("+7.125"), "7.13" },
+        { Fixed16::parse("-0.004"), "0.00" },
+        { Fixed16::parse("abc"), "0.00" },
+    };
+    for (const Case &c : cases) {
+        char out[FIXED_FORMAT_MAX];
+        c.got.format(out, 2);
+        if (strcmp(out, c.expect) != 0) {
+            fprintf(stderr, "arithmetic: got %s, expected %s\n", out, c.expect);
+            return false;
+        }
+    }
+
+    FixedMean<16> mean;
+    for (int i = 1; i <= 4; i++) {
+        mean.add(Fixed16::fromInt(i));
+    }
+    if (mean.mean() != Fixed16::fromDecimal(25, 1)) {
+        fprintf(stderr, "mean: got %d\n", mean.mean().raw());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    if (!checkRoundTrip() || !checkArithmetic()) {
+        return 1;
+    }
+
+    // Readings as they arrive over the mesh
+    std::vector<std::string> texts;
+    for (int i = 0; i < 1024; i++) {
+        char text[16];
+        snprintf(text, sizeof(text), "%d.%d", (i * 37) % 500, i % 10);
+        texts.push_back(text);
+    }
+
+    printf("%-26s %10s %10s\n", "operation", "fixed_ns", "float_ns");
+
+    // Parse
+    auto start = std::chrono::steady_clock::now();
+    uint32_t acc = 0;
+    for (int i = 0; i < iterations; i++) {
+        acc += Fixed16::parse(texts[i & 1023].c_str()).raw();
+    }
+    double fixedNs = seconds(start) * 1e9 / iterations;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        acc += (uint32_t)strtof(texts[i & 1023].c_str(), nullptr);
+    }
+    double floatNs = seconds(start) * 1e9 / iterations;
+    printf("%-26s %10.1f %10.1f\n", "parse", fixedNs, floatNs);
+
+    // Format
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        char out[FIXED_FORMAT_MAX];
+        acc += Fixed16::fromRaw(i * 977).format(out, 2);
+    }
+    fixedNs = seconds(start) * 1e9 / iterations;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.2f", (i * 977) / 65536.0f);
+        std::string s(buf);  // String(float, 2)
+        acc += s.size();
+    }
+    floatNs = seconds(start) * 1e9 / iterations;
+    printf("%-26s %10.1f %10.1f\n", "format 2 decimals", fixedNs, floatNs);
+
+    // A calibration-style multiply-add and a running mean
+    std::vector<Fixed16> fx(1024);
+    std::vector<float> fl(1024);
+    for (int i = 0; i < 1024; i++) {
+        fx[i] = Fixed16::parse(texts[i].c_str());
+        fl[i] = strtof(texts[i].c_str(), nullptr);
+    }
+    const Fixed16 gain = Fixed16::fromDecimal(1025, 3), offset = Fixed16::fromDecimal(-15, 1);
+    start = std::chrono::steady_clock::now();
+    FixedMean<16> fixedMean;
+    for (int i = 0; i < iterations; i++) {
+        fixedMean.add(fx[i & 1023] * gain + offset);
+    }
+    acc += fixedMean.mean().raw();
+    fixedNs = seconds(start) * 1e9 / iterations;
+    start = std::chrono::steady_clock::now();
+    double floatSum = 0;
+    for (int i = 0; i < iterations; i++) {
+        floatSum += fl[i & 1023] * 1.025f - 1.5f;
+    }
+    acc += (uint32_t)(floatSum / iterations);
+    floatNs = seconds(start) * 1e9 / iterations;
+    printf("%-26s %10.1f %10.1f\n", "scale + mean", fixedNs, floatNs);
+
+    // Text reading to AQI, as the metrics and UI pages do it
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        acc += aqiPm25(tenthsFromText(texts[i & 1023].c_str()));
+    }
+    fixedNs = seconds(start) * 1e9 / iterations;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        acc += aqiPm25((uint32_t)(strtof(texts[i & 1023].c_str(), nullptr) * 10));
+    }
+    floatNs = seconds(start) * 1e9 / iterations;
+    printf("%-26s %10.1f %10.1f\n", "text to AQI", fixedNs, floatNs);
+    g_sink = acc;
+
+    // Platform checksum: FNV-1a over the raw results of a fixed sweep
+    uint32_t hash = 2166136261u;
+    for (int32_t i = -5000; i < 5000; i++) {
+        Fixed16 a = Fixed16::fromDecimal(i * 7, 2);
+        Fixed16 b = Fixed16::fromDecimal(i % 97 + 1, 1);
+        int32_t results[] = { (a * b).raw(), (a / b).raw(), (a + b * 3).raw(), (int32_t)a.toDecimal(1) };
+        for (int32_t r : results) {
+            hash = (hash ^ (uint32_t)r) * 16777619u;
+        }
+    }
+    printf("checksum %08x\n", hash);
+    return 0;
+}
@@ -0,0 +1,29 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        Client.h
+//
+// Description:
+//
+//   Arduino's Client interface, as far as mqtt_uplink.h uses it, for
+//   building it on a host in tools/mqtt_bench.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Client {
+public:
+    virtual ~Client() {}
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual size_t write(const uint8_t *buf, size_t size) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+};
@@ -0,0 +1,525 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        mqtt_bench.cpp
+//
+// Description:
+//
+//   Runs MqttUplink (include/mqtt_uplink.h) on a host against a local
+//   broker over TCP and measures it in three phases:
+//
+//     throughput  the queue kept full: readings acknowledged per second,
+//                 publishes per second and readings per publish
+//     drops       the same load with the connection cut every --drop-ms:
+//                 time from each cut to the next CONNACK, and readings
+//                 the broker saw more than once
+//     outage      20 readings/s while the broker resets every connection
+//                 for --outage-ms: connect attempts against failures
+//                 counted, readings the queue had to drop, and time from
+//                 the end of the outage to the next CONNACK
+//
+//   Readings come from --nodes nodes in turn, one reading each, the way
+//   the mesh interleaves them at a gateway.  Then it drains the queue.  By default the broker is a minimal one
+//   built in (CONNECT, QoS 1 PUBLISH, PINGREQ), which also records every
+//   reading it receives; --host and --port point at a real one, such as
+//   mosquitto on localhost, instead.  Cuts and outages are made on the
+//   client side, so they work the same against either.
+//
+//   Exits non-zero if the built-in broker is missing a reading the queue
+//   didn't drop, or if failures don't match one per cut or failed attempt.
+//
+//   Build:   g++ -O2 -std=c++17 -pthread -Ihost -I../../include mqtt_bench.cpp -o mqtt_bench
+//            (host/ holds the Arduino.h and Client.h stand-ins)
+//   Usage:   mqtt_bench [--host H] [--port N] [--nodes N] [--seconds N] [--drop-ms N] [--outage-ms N]
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <mqtt_uplink.h>
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_OUTAGE_RATE   20      // Readings/s offered during the outage phase
+
+// A TCP Client.  cut() drops the connection as a network loss would;
+// while resetting, connect() appears to succeed but nothing can be
+// written, as with a broker that resets each connection.
+class SocketClient : public Client {
+public:
+    int connect(const char *host, uint16_t port) override {
+        stop();
+        m_attempts++;
+        if (m_resetting) {
+            m_fake = true;
+            return 1;
+        }
+        char service[8];
+        snprintf(service, sizeof(service), "%u", port);
+        addrinfo hints = {}, *res = nullptr;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, service, &hints, &res) != 0) {
+            return 0;
+        }
+        m_fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        if (m_fd < 0 || ::connect(m_fd, res->ai_addr, res->ai_addrlen) != 0) {
+            freeaddrinfo(res);
+            stop();
+            return 0;
+        }
+        freeaddrinfo(res);
+        int one = 1;
+        setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+        return 1;
+    }
+
+    size_t write(const uint8_t *buf, size_t size) override {
+        size_t done = 0;
+        while (m_fd >= 0 && done < size) {
+            ssize_t n = send(m_fd, buf + done, size - done, MSG_NOSIGNAL);
+            if (n > 0) {
+                done += n;
+            } else if (n < 0 && errno == EAGAIN) {
+                pollfd p = { m_fd, POLLOUT, 0 };
+                poll(&p, 1, 1000);
+            } else {
+                stop();
+            }
+        }
+        return done;
+    }
+
+    int available() override {
+        if (m_pos == m_len && m_fd >= 0) {
+            ssize_t n = recv(m_fd, m_buf, sizeof(m_buf), 0);
+            if (n > 0) {
+                m_pos = 0;
+                m_len = n;
+            } else if (n == 0 || errno != EAGAIN) {
+                stop();
+            }
+        }
+        return (int)(m_len - m_pos);
+    }
+
+    int read() override { return available() ? m_buf[m_pos++] : -1; }
+
+    void stop() override {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+        m_fd = -1;
+        m_fake = false;
+        m_pos = m_len = 0;
+    }
+
+    uint8_t connected() override { return m_fd >= 0; }
+
+    void cut() { stop(); }
+    void resetting(bool on) { m_resetting = on; }
+    uint32_t attempts() const { return m_attempts; }
+
+private:
+    int m_fd = -1;
+    bool m_fake = false;
+    bool m_resetting = false;
+    uint8_t m_buf[4096];
+    size_t m_pos = 0;
+    size_t m_len = 0;
+    uint32_t m_attempts = 0;
+};
+
+// Accepts one connection at a time and answers what MqttUplink sends.
+// Each reading's first value is its id, so it can tell which arrived.
+class LocalBroker {
+public:
+    bool start() {
+        m_listen = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(m_listen, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(m_listen, 4) != 0 ||
+            getsockname(m_listen, (sockaddr *)&addr, &len) != 0) {
+            return false;
+        }
+        m_port = ntohs(addr.sin_port);
+        m_thread = std::thread([this] { run(); });
+        return true;
+    }
+
+    void stop() {
+        m_stop = true;
+        m_thread.join();
+        close(m_listen);
+    }
+
+    uint16_t port() const { return m_port; }
+
+    // Readings received, and how many of them were repeats
+    void counts(uint32_t &readings, uint32_t &repeats) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        readings = m_readings;
+        repeats = m_repeats;
+    }
+
+    bool received(uint32_t id) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return id < m_seen.size() && m_seen[id];
+    }
+
+private:
+    void run() {
+        while (!m_stop) {
+            pollfd p = { m_listen, POLLIN, 0 };
+            if (poll(&p, 1, 50) <= 0) {
+                continue;
+            }
+            int fd = accept(m_listen, nullptr, nullptr);
+            if (fd >= 0) {
+                serve(fd);
+                close(fd);
+            }
+        }
+    }
+
+    // Reads exactly len bytes; false on EOF, error or shutdown
+    bool readAll(int fd, uint8_t *out, size_t len) {
+        size_t done = 0;
+        while (done < len) {
+            pollfd p = { fd, POLLIN, 0 };
+            if (m_stop) {
+                return false;
+            }
+            if (poll(&p, 1, 50) <= 0) {
+                continue;
+            }
+            ssize_t n = recv(fd, out + done, len - done, 0);
+            if (n <= 0) {
+                return false;
+            }
+            done += n;
+        }
+        return true;
+    }
+
+    void serve(int fd) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::vector<uint8_t> body;
+        for (;;) {
+            uint8_t header;
+            if (!readAll(fd, &header, 1)) {
+                return;
+            }
+            size_t len = 0;
+            for (int shift = 0;; shift += 7) {
+                uint8_t b;
+                if (!readAll(fd, &b, 1)) {
+                    return;
+                }
+                len |= (size_t)(b & 0x7F) << shift;
+                if (!(b & 0x80)) {
+                    break;
+                }
+            }
+            body.resize(len);
+            if (len && !readAll(fd, body.data(), len)) {
+                return;
+            }
+            uint8_t type = header & 0xF0;
+            if (type == 0x10) {
+                static const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+                send(fd, connack, sizeof(connack), MSG_NOSIGNAL);
+            } else if (type == 0x30 && len >= 4) {
+                size_t topicLen = (body[0] << 8) | body[1];
+                size_t at = 2 + topicLen;
+                uint8_t puback[] = { 0x40, 0x02, body[at], body[at + 1] };
+                record((const char *)body.data() + at + 2, len - at - 2);
+                send(fd, puback, sizeof(puback), MSG_NOSIGNAL);
+            } else if (type == 0xC0) {
+                static const uint8_t pingresp[] = { 0xD0, 0x00 };
+                send(fd, pingresp, sizeof(pingresp), MSG_NOSIGNAL);
+            }
+        }
+    }
+
+    // Payload: [{"age":ms,"v":["<id>",...]}, ...]
+    void record(const char *payload, size_t len) {
+        std::string text(payload, len);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t at = 0; (at = text.find("\"v\":[\"", at)) != std::string::npos;) {
+            at += 6;
+            uint32_t id = strtoul(text.c_str() + at, nullptr, 10);
+            if (id >= m_seen.size()) {
+                m_seen.resize(id + 1024);
+            }
+            m_repeats += m_seen[id];
+            m_seen[id] = true;
+            m_readings++;
+        }
+    }
+
+    int m_listen = -1;
+    uint16_t m_port = 0;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{ false };
+    std::mutex m_mutex;
+    std::vector<bool> m_seen;
+    uint32_t m_readings = 0;
+    uint32_t m_repeats = 0;
+};
+
+// Feeds the uplink numbered readings and mirrors its queue, so it knows
+// which ids were dropped when the queue overflowed
+struct Feeder {
+    Feeder(MqttUplink &u, uint32_t n) : uplink(u), nodes(n) {}
+
+    MqttUplink &uplink;
+    uint32_t nodes;
+    uint32_t nextId = 0;
+    std::deque<uint32_t> queued;    // Not yet acknowledged, oldest first
+    std::vector<uint32_t> dropped;
+
+    void offer() {
+        NodeEntry e = {};
+        e.nodeId = 0xA000 + nextId % nodes;  // Round robin
+        snprintf(e.value[0], NODE_VALUE_LEN, "%u", nextId);
+        snprintf(e.value[1], NODE_VALUE_LEN, "12.3");
+        snprintf(e.value[2], NODE_VALUE_LEN, "20.1");
+        snprintf(e.value[3], NODE_VALUE_LEN, "71.6");
+        snprintf(e.value[4], NODE_VALUE_LEN, "44.0");
+        if (uplink.backlog() == MQTT_QUEUE_SIZE) {
+            dropped.push_back(queued.front());
+            queued.pop_front();
+        }
+        uplink.enqueue(e);
+        queued.push_back(nextId++);
+    }
+
+    // Forgets what the broker has acknowledged
+    void sync() {
+        while (queued.size() > uplink.backlog()) {
+            queued.pop_front();
+        }
+    }
+};
+
+struct Options {
+    const char *host = "127.0.0.1";
+    uint16_t port = 0;              // 0 = the built-in broker
+    uint32_t nodes = 4;
+    uint32_t seconds = 5;
+    uint32_t dropMs = 500;
+    uint32_t outageMs = 5000;
+};
+
+static bool waitConnected(MqttUplink &uplink, Feeder &feed, uint32_t timeoutMs) {
+    unsigned long start = millis();
+    while (!uplink.connected() && millis() - start < timeoutMs) {
+        uplink.update();
+        feed.sync();
+        std::this_thread::yield();
+    }
+    return uplink.connected();
+}
+
+static void throughput(MqttUplink &uplink, Feeder &feed, uint32_t seconds) {
+    MqttStats before = uplink.stats();
+    unsigned long start = millis();
+    while (millis() - start < seconds * 1000) {
+        while (uplink.backlog() < MQTT_QUEUE_SIZE) {
+            feed.offer();
+        }
+        uplink.update();
+        feed.sync();
+    }
+    double s = (millis() - start) / 1000.0;
+    const MqttStats &st = uplink.stats();
+    uint32_t acked = st.acked - before.acked, publishes = st.publishes - before.publishes;
+    printf("throughput: %.0f readings/s acknowledged, %.0f publishes/s, %.1f readings per publish\n", acked / s,
+           publishes / s, publishes ? (double)acked / publishes : 0.0);
+}
+
+// Returns the number of cuts
+static uint32_t drops(MqttUplink &uplink, SocketClient &client, Feeder &feed, const Options &opt) {
+    MqttStats before = uplink.stats();
+    unsigned long start = millis(), cutAt = 0;
+    uint32_t cuts = 0, reconnects = 0;
+    unsigned long latencyTotal = 0, latencyMax = 0;
+    bool down = false;
+    while (millis() - start < opt.seconds * 1000) {
+        unsigned long now = millis();
+        if (!down && uplink.connected() && now - cutAt >= opt.dropMs) {
+            client.cut();
+            cutAt = now;
+            down = true;
+            cuts++;
+        }
+        while (uplink.backlog() < MQTT_QUEUE_SIZE) {
+            feed.offer();
+        }
+        uplink.update();
+        feed.sync();
+        if (down && uplink.connected()) {
+            unsigned long latency = millis() - cutAt;
+            latencyTotal += latency;
+            latencyMax = latency > latencyMax ? latency : latencyMax;
+            reconnects++;
+            down = false;
+        }
+    }
+    const MqttStats &st = uplink.stats();
+    printf("drops: %u cuts, %u reconnects, %.1f ms mean and %lu ms max to CONNACK, %u failures, %u readings "
+           "acknowledged\n",
+           cuts, reconnects, reconnects ? (double)latencyTotal / reconnects : 0.0, latencyMax,
+           st.failures - before.failures, st.acked - before.acked);
+    return cuts;
+}
+
+// Returns the number of cuts: none if the last drop hasn't reconnected yet
+static uint32_t outage(MqttUplink &uplink, SocketClient &client, Feeder &feed, const Options &opt) {
+    MqttStats before = uplink.stats();
+    uint32_t attemptsBefore = client.attempts();
+    uint32_t cuts = uplink.connected();
+    client.resetting(true);
+    client.cut();
+    unsigned long start = millis(), lastOffer = start;
+    bool over = false;
+    unsigned long recovered = 0;
+    while (millis() - start < opt.outageMs + 60000 && !recovered) {
+        unsigned long now = millis();
+        if (!over && now - start >= opt.outageMs) {
+            client.resetting(false);
+            over = true;
+        }
+        while (now - lastOffer >= 1000 / BENCH_OUTAGE_RATE) {
+            feed.offer();
+            lastOffer += 1000 / BENCH_OUTAGE_RATE;
+        }
+        uplink.update();
+        feed.sync();
+        if (over && uplink.connected()) {
+            recovered = millis() - start - opt.outageMs;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const MqttStats &st = uplink.stats();
+    printf("outage: %u ms, %u connect attempts, %u failures counted (%u for the cut), %u readings dropped, "
+           "reconnected %lu ms after it ended\n",
+           opt.outageMs, client.attempts() - attemptsBefore, st.failures - before.failures, cuts,
+           st.dropped - before.dropped, recovered);
+    return cuts;
+}
+
+static bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *arg = argv[i];
+        uint32_t value = strtoul(argv[i + 1], nullptr, 0);
+        if (strcmp(arg, "--host") == 0) {
+            opt.host = argv[i + 1];
+        } else if (strcmp(arg, "--port") == 0) {
+            opt.port = (uint16_t)value;
+        } else if (strcmp(arg, "--nodes") == 0) {
+            opt.nodes = value;
+        } else if (strcmp(arg, "--seconds") == 0) {
+            opt.seconds = value;
+        } else if (strcmp(arg, "--drop-ms") == 0) {
+            opt.dropMs = value;
+        } else if (strcmp(arg, "--outage-ms") == 0) {
+            opt.outageMs = value;
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && opt.seconds > 0 && opt.nodes > 0;
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        fprintf(stderr, "usage: %s [--host H] [--port N] [--nodes N] [--seconds N] [--drop-ms N] [--outage-ms N]\n",
+                argv[0]);
+        return 2;
+    }
+    LocalBroker broker;
+    bool local = opt.port == 0;
+    if (local) {
+        if (!broker.start()) {
+            fprintf(stderr, "can't start the local broker\n");
+            return 2;
+        }
+        opt.port = broker.port();
+    }
+    printf("broker %s:%u%s, %u nodes\n", opt.host, opt.port, local ? " (built in)" : "", opt.nodes);
+
+    SocketClient client;
+    static MqttUplink uplink(client, opt.host, opt.port, "aq-bench", "aq/bench");
+    Feeder feed(uplink, opt.nodes);
+    if (!waitConnected(uplink, feed, 5000)) {
+        fprintf(stderr, "no CONNACK from the broker\n");
+        return 1;
+    }
+    throughput(uplink, feed, opt.seconds);
+    MqttStats before = uplink.stats();
+    uint32_t attemptsBefore = client.attempts();
+    uint32_t cuts = drops(uplink, client, feed, opt);
+    cuts += outage(uplink, client, feed, opt);
+    uint32_t failures = uplink.stats().failures - before.failures;
+    uint32_t failedAttempts = client.attempts() - attemptsBefore - (uplink.stats().connects - before.connects);
+
+    unsigned long start = millis();
+    while ((uplink.backlog() || uplink.inflight()) && millis() - start < 10000) {
+        uplink.update();
+        feed.sync();
+    }
+    const MqttStats &st = uplink.stats();
+    printf("total: %u queued, %u dropped, %u acknowledged, %u publishes, %u connects, %u failures\n", st.queued,
+           st.dropped, st.acked, st.publishes, st.connects, st.failures);
+
+    bool ok = !uplink.backlog();
+    if (!ok) {
+        printf("FAIL: %u readings never acknowledged\n", uplink.backlog());
+    }
+    // Every cut fails the session once, and so does every attempt that
+    // doesn't end in a CONNACK
+    if (failures != cuts + failedAttempts) {
+        printf("FAIL: %u failures counted for %u cuts and %u failed attempts\n", failures, cuts, failedAttempts);
+        ok = false;
+    }
+    if (local) {
+        broker.stop();
+        uint32_t readings, repeats;
+        broker.counts(readings, repeats);
+        std::vector<bool> dropped(feed.nextId);
+        for (uint32_t id : feed.dropped) {
+            dropped[id] = true;
+        }
+        uint32_t missing = 0;
+        for (uint32_t id = 0; id < feed.nextId; id++) {
+            missing += !dropped[id] && !broker.received(id);
+        }
+        printf("broker: %u readings received, %u repeats, %u missing\n", readings, repeats, missing);
+        ok = ok && !missing;
+    }
+    return ok ? 0 : 1;
+}
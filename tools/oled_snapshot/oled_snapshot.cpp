@@ -0,0 +1,222 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        oled_snapshot.cpp
+//
+// Description:
+//
+//   Renders every OLED page (include/ui_pages.h) on the host from a fixed
+//   sample model, using the same FrameBuffer code the firmware draws
+//   with.  Each page is written as a PBM image, or as ASCII art with -a,
+//   so layout changes can be reviewed and frames diffed byte for byte
+//   without flashing a board.
+//
+//   -c compares the pages against the PBMs in a directory instead and
+//   exits 1 if any differ.  golden/ holds the reviewed ones; after an
+//   intended layout change, regenerate them with "oled_snapshot golden"
+//   and check the new images in with the change.
+//
+//   Build:   g++ -O2 -std=c++17 -I../../include oled_snapshot.cpp -o oled_snapshot
+//   Usage:   oled_snapshot [-a] [outdir]      outdir is created if missing
+//            oled_snapshot -c golden
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <ui_pages.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+static const char *kPageNames[PAGE_COUNT] = {
+    "readings", "summary", "node", "trend_pm1_0", "trend_pm2_5", "trend_pm10_0"
+};
+
+// A few nodes and twenty minutes of history with a spike in the middle,
+// labelled as the firmware labels them.  The second node's values are
+// as long as a value gets, to show the rows still don't collide.
+static void sampleModel(UiModel &m, NodeTable &nodes, History *trend) {
+    static const char *values[NODE_VALUES] = { "4.0", "7.3", "9.1", "71.60", "43.20" };
+
+    static const char *nodeValues[3][NODE_VALUES] = {
+        { "4.0", "7.3", "9.1", "71.60", "43.20" },
+        { "1234.5", "12345.6", "999999.9", "-40.00", "null" },
+        { "1", "2", "2", "23.00", "38.10" },
+    };
+    const uint32_t ids[3] = { 2733514221u, 2733490120u, 3825016441u };
+    for (int n = 0; n < 3; n++) {
+        NodeEntry *e = nodes.update(ids[n], 100000 + n * 7000);
+        for (int i = 0; i < NODE_VALUES; i++) {
+            NodeTable::setValue(e, i, nodeValues[n][i]);
+        }
+    }
+
+    for (int s = 0; s < HISTORY_SAMPLES; s++) {
+        uint16_t base = 60 + (s % 17) * 3;
+        uint16_t spike = (s > 70 && s < 76) ? 400 : 0;
+        trend[0].push(base / 2 + spike / 3);
+        trend[1].push(base + spike);
+        trend[2].push(base + 30 + spike);
+    }
+
+    m.nowMs = 125000;
+    m.selfId = ids[0];
+    m.meshNodes = 3;
+    m.received = 1284;
+    m.parseErrors = 2;
+    for (int i = 0; i < NODE_VALUES; i++) {
+        m.keys[i] = kUiLabels[i];
+        m.suffix[i] = kUiSuffix[i];
+        m.values[i] = values[i];
+    }
+    m.nodes = &nodes;
+    m.nodeIndex = 1;
+    for (int i = 0; i < 3; i++) {
+        m.trend[i] = &trend[i];
+    }
+}
+
+static inline bool lit(const uint8_t *buf, int x, int y) {
+    return buf[(y >> 3) * FB_WIDTH + x] & (1 << (y & 7));
+}
+
+// The frame as a binary PBM file
+static std::string pbm(const uint8_t *buf) {
+    char header[32];
+    snprintf(header, sizeof(header), "P4\n%d %d\n", FB_WIDTH, FB_HEIGHT);
+    std::string image(header);
+    for (int y = 0; y < FB_HEIGHT; y++) {
+        uint8_t line[FB_WIDTH / 8] = {};
+        for (int x = 0; x < FB_WIDTH; x++) {
+            if (lit(buf, x, y)) {
+                line[x >> 3] |= 0x80 >> (x & 7);
+            }
+        }
+        image.append((const char *)line, sizeof(line));
+    }
+    return image;
+}
+
+static bool writePbm(const char *path, const uint8_t *buf) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    std::string image = pbm(buf);
+    bool ok = fwrite(image.data(), 1, image.size(), f) == image.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        perror(path);
+    }
+    return ok;
+}
+
+// True if path holds exactly this frame; says what differs if not
+static bool matchesPbm(const char *path, const uint8_t *buf) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    std::string golden;
+    char chunk[512];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        golden.append(chunk, n);
+    }
+    fclose(f);
+    std::string image = pbm(buf);
+    if (golden.size() != image.size()) {
+        printf("%s: %zu bytes, expected %zu\n", path, image.size(), golden.size());
+        return false;
+    }
+    int pixels = 0;
+    for (size_t i = 0; i < image.size(); i++) {
+        pixels += __builtin_popcount((uint8_t)(image[i] ^ golden[i]));
+    }
+    if (pixels) {
+        printf("%s: %d pixels differ\n", path, pixels);
+    }
+    return pixels == 0;
+}
+
+// mkdir -p
+static bool makeDirs(const std::string &path) {
+    for (size_t at = 1; at <= path.size(); at++) {
+        if (at == path.size() || path[at] == '/') {
+            std::string part = path.substr(0, at);
+            if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST) {
+                perror(part.c_str());
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void writeAscii(FILE *f, const char *name, const uint8_t *buf) {
+    fprintf(f, "== %s\n", name);
+    for (int y = 0; y < FB_HEIGHT; y++) {
+        char line[FB_WIDTH + 2];
+        for (int x = 0; x < FB_WIDTH; x++) {
+            line[x] = lit(buf, x, y) ? '#' : '.';
+        }
+        line[FB_WIDTH] = '\n';
+        line[FB_WIDTH + 1] = '\0';
+        fputs(line, f);
+    }
+}
+
+int main(int argc, char **argv) {
+    bool ascii = false;
+    const char *goldenDir = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "ac:")) != -1) {
+        if (opt == 'a') {
+            ascii = true;
+        } else if (opt == 'c') {
+            goldenDir = optarg;
+        } else {
+            fprintf(stderr, "usage: %s [-a] [outdir]\n       %s -c goldendir\n", argv[0], argv[0]);
+            return 2;
+        }
+    }
+    const char *outDir = optind < argc ? argv[optind] : ".";
+    if (!ascii && !goldenDir && !makeDirs(outDir)) {
+        return 1;
+    }
+
+    static NodeTable nodes;  // Large; kept off the stack
+    static History trend[3];
+    UiModel model;
+    sampleModel(model, nodes, trend);
+
+    uint8_t buf[FB_BYTES];
+    FrameBuffer fb(buf);
+    int mismatches = 0;
+    for (int page = 0; page < PAGE_COUNT; page++) {
+        renderPage(fb, model, page);
+        if (ascii) {
+            writeAscii(stdout, kPageNames[page], buf);
+            continue;
+        }
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%d_%s.pbm", goldenDir ? goldenDir : outDir, page + 1, kPageNames[page]);
+        if (goldenDir) {
+            mismatches += !matchesPbm(path, buf);
+        } else if (!writePbm(path, buf)) {
+            return 1;
+        }
+    }
+    if (goldenDir) {
+        printf("%d of %d pages match %s\n", PAGE_COUNT - mismatches, PAGE_COUNT, goldenDir);
+    }
+    return mismatches ? 1 : 0;
+}
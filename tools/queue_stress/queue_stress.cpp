@@ -0,0 +1,163 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        queue_stress.cpp
+//
+// Description:
+//
+//   Hammers SpscQueue and MpscQueue from real threads on a Linux host.
+//   Producers claim slots and fill them with an item whose every field is
+//   derived from (producer, sequence); the consumer checks each item is
+//   whole, arrives exactly once and in per-producer order.  Exits non-zero
+//   on the first violation, so it can gate changes to either queue.
+//
+//   Build:   g++ -O2 -std=c++17 -pthread -I../../include queue_stress.cpp -o queue_stress
+//   Usage:   queue_stress [items per producer] [producers]
+//
+//   Run it under -fsanitize=thread as well; the queues should be clean.
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <spsc_queue.h>
+#include <mpsc_queue.h>
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+// About the size of a reading, so a torn copy would show up
+struct Item {
+    uint32_t producer;
+    uint32_t seq;
+    uint32_t check[6];
+};
+
+static void fill(Item &item, uint32_t producer, uint32_t seq) {
+    item.producer = producer;
+    item.seq = seq;
+    for (int i = 0; i < 6; i++) {
+        item.check[i] = (seq * 2654435761u) ^ (producer << 24) ^ i;
+    }
+}
+
+static bool intact(const Item &item) {
+    for (int i = 0; i < 6; i++) {
+        if (item.check[i] != ((item.seq * 2654435761u) ^ (item.producer << 24) ^ (uint32_t)i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool stressSpsc(uint32_t count) {
+    static SpscQueue<Item, 64> queue;
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread producer([count] {
+        for (uint32_t seq = 0; seq < count;) {
+            Item *slot = queue.claim();
+            if (!slot) {
+                std::this_thread::yield();
+                continue;
+            }
+            fill(*slot, 0, seq++);
+            queue.publish();
+        }
+    });
+
+    bool ok = true;
+    for (uint32_t expect = 0; expect < count;) {
+        Item *item = queue.front();
+        if (!item) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!intact(*item) || item->seq != expect) {
+            fprintf(stderr, "spsc: expected %u, got %u (%s)\n", expect, item->seq, intact(*item) ? "intact" : "torn");
+            ok = false;
+            break;
+        }
+        queue.pop();
+        expect++;
+    }
+    if (!ok) {
+        exit(1);  // The producer may be stuck on a full queue
+    }
+    producer.join();
+    double s = seconds(start);
+    printf("spsc  1 producer   %u items  %.2f s  %.1f M items/s  ok\n", count, s, count / s / 1e6);
+    return true;
+}
+
+static bool stressMpsc(uint32_t count, int producers) {
+    static MpscQueue<Item, 64> queue;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([count, p] {
+            for (uint32_t seq = 0; seq < count;) {
+                size_t ticket;
+                Item *slot = queue.claim(ticket);
+                if (!slot) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                fill(*slot, p, seq++);
+                queue.publish(ticket);
+            }
+        });
+    }
+
+    bool ok = true;
+    std::vector<uint32_t> next(producers, 0);
+    uint64_t total = (uint64_t)count * producers;
+    for (uint64_t received = 0; received < total && ok;) {
+        Item *item = queue.front();
+        if (!item) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!intact(*item) || item->producer >= (uint32_t)producers || item->seq != next[item->producer]) {
+            fprintf(stderr, "mpsc: producer %u expected %u, got %u (%s)\n", item->producer,
+                    item->producer < (uint32_t)producers ? next[item->producer] : 0, item->seq,
+                    intact(*item) ? "intact" : "torn");
+            ok = false;
+            break;
+        }
+        next[item->producer]++;
+        queue.pop();
+        received++;
+    }
+    if (!ok) {
+        exit(1);  // Producers may be stuck on a full queue
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    double s = seconds(start);
+    printf("mpsc  %d producers  %llu items  %.2f s  %.1f M items/s  ok\n", producers,
+           (unsigned long long)total, s, total / s / 1e6);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    uint32_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 5000000;
+    int producers = argc > 2 ? atoi(argv[2]) : 3;
+    if (count == 0 || producers < 1 || producers > 64) {
+        fprintf(stderr, "usage: %s [items per producer] [producers]\n", argv[0]);
+        return 2;
+    }
+    stressSpsc(count);
+    stressMpsc(count, producers);
+    return 0;
+}
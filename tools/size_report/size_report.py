@@ -0,0 +1,77 @@
+#+--------------------------------------------------------------------------
+#
+# Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+#
+# File:        size_report.py
+#
+# Description:
+#
+#   PlatformIO post-build script: after each firmware link, prints the
+#   flash and static RAM the image uses and the change since the last
+#   build of the same env, and records both in .pio/sizes.json.  Sizes
+#   are summed with the platform's own section patterns, so they match
+#   the RAM/Flash lines pio prints.  Building every role in one go
+#   ("pio run") leaves a line per profile to compare.
+#
+#   Build:   extra_scripts = post:tools/size_report/size_report.py
+#   Usage:   pio run; cat .pio/sizes.json
+#
+# History:     Oct-18-2026     cfl429      Created
+#---------------------------------------------------------------------------
+
+Import("env")
+
+import json
+import os
+import re
+import subprocess
+
+
+def section_sizes(elf):
+    out = subprocess.run([env.subst("$SIZETOOL"), "-A", "-d", elf],
+                         capture_output=True, text=True, check=True).stdout
+    sizes = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0].startswith(".") and parts[1].isdigit():
+            sizes[parts[0]] = int(parts[1])
+    return sizes
+
+
+def total(sizes, pattern):
+    regex = re.compile(pattern)
+    return sum(size for name, size in sizes.items()
+               if regex.match("%s %d" % (name, size)))
+
+
+def git_revision():
+    try:
+        return subprocess.run(["git", "rev-parse", "--short", "HEAD"], cwd=env.subst("$PROJECT_DIR"),
+                              capture_output=True, text=True, check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return ""
+
+
+def report(source, target, env):
+    sizes = section_sizes(str(target[0]))
+    flash = total(sizes, env.get("SIZEPROGREGEXP", r"^(?:\.iram0\.text|\.iram0\.vectors|\.dram0\.data|\.flash\.text|\.flash\.rodata)\s"))
+    ram = total(sizes, env.get("SIZEDATAREGEXP", r"^(?:\.dram0\.data|\.dram0\.bss|\.noinit)\s"))
+
+    path = os.path.join(env.subst("$PROJECT_DIR"), ".pio", "sizes.json")
+    history = {}
+    if os.path.exists(path):
+        with open(path) as f:
+            history = json.load(f)
+    name = env.subst("$PIOENV")
+    last = history.get(name)
+
+    def delta(key, now):
+        return " (%+d)" % (now - last[key]) if last else ""
+
+    print("size %s: flash %d%s, ram %d%s" % (name, flash, delta("flash", flash), ram, delta("ram", ram)))
+    history[name] = {"flash": flash, "ram": ram, "revision": git_revision()}
+    with open(path, "w") as f:
+        json.dump(history, f, indent=1, sort_keys=True)
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)
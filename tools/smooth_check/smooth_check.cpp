@@ -0,0 +1,259 @@
+//+--------------------------------------------------------------------------
+//
+// Air Quality Monitor - (c) 2024 Chris Londal.  All Rights Reserved.
+//
+// File:        smooth_check.cpp
+//
+// Description:
+//
+//   Characterizes the smoothing filters in smoothing.h on a host, at the
+//   default latency and at the sample rates the sensor runs at:
+//
+//     step     how long a step takes to get 63% and 90% of the way, up
+//              and down, small and large
+//     noise    the spread left of steady readings with PMS-like noise,
+//              against what an ideal EMA of that gain leaves
+//     trace    on a recorded trace (or, without one, a synthetic day with
+//              a smoke event and noise): LED category changes of the
+//              pm2.5 AQI, the mean change between readings, and the mean
+//              distance from the noise-free value where that is known
+//
+//   Exits non-zero if a filter misses its limits: the EMA's 63% point
+//   more than a sample from the latency, a large step taking the Kalman
+//   filter more than SMOOTH_CONFIRM + 1 samples, noise not reduced to
+//   within 25% of the ideal, or more category changes than the readings.
+//
+//   Build:   g++ -O2 -std=c++17 -I../../include smooth_check.cpp -o smooth_check
+//   Usage:   smooth_check [trace.csv]
+//            trace lines are "ms,pm1.0,pm2.5,pm10.0", as for replay
+//
+// History:     Oct-18-2026     cfl429      Created
+//---------------------------------------------------------------------------
+
+#include <smoothing.h>
+#include <led_status.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+struct Sample {
+    uint32_t ms;
+    int reading;        // What the sensor said
+    double truth;       // The air; < 0 if unknown
+};
+
+static const SmoothConfig kFilters[] = {
+    { SMOOTH_OFF, SMOOTH_LATENCY_MS, 0 },
+    { SMOOTH_EMA, SMOOTH_LATENCY_MS, 0 },
+    { SMOOTH_KALMAN, SMOOTH_LATENCY_MS, SMOOTH_GATE },
+};
+static const int kFilterCount = sizeof(kFilters) / sizeof(kFilters[0]);
+
+static uint32_t g_Random = 1;
+
+static double uniform() {
+    g_Random ^= g_Random << 13;
+    g_Random ^= g_Random >> 17;
+    g_Random ^= g_Random << 5;
+    return (g_Random + 0.5) / 4294967296.0;
+}
+
+static double gaussian() {
+    return sqrt(-2 * log(uniform())) * cos(2 * M_PI * uniform());
+}
+
+// The sensor's reading of level: noise as SMOOTH_NOISE_* models it, in
+// whole ug/m3
+static int noisy(double level) {
+    double sigma = fmax(SMOOTH_NOISE_MIN, level * SMOOTH_NOISE_PCT / 100);
+    return (int)fmax(0, lround(level + sigma * gaussian()));
+}
+
+static double run(Smoother &s, const Sample &in) {
+    return s.update(Fixed16::fromInt(in.reading), in.ms).raw() / 65536.0;
+}
+
+// Samples from the step until the output is fraction of the way there
+static int stepSamples(const SmoothConfig &c, uint32_t periodMs, int from, int to, double fraction) {
+    Smoother s(c);
+    uint32_t ms = 0;
+    for (int i = 0; i < 100; i++, ms += periodMs) {
+        run(s, { ms, from, -1 });
+    }
+    for (int i = 1; i <= 1000; i++, ms += periodMs) {
+        double v = run(s, { ms, to, -1 });
+        if ((v - from) / (to - from) >= fraction) {
+            return i;
+        }
+    }
+    return 1000;
+}
+
+static bool checkSteps() {
+    static const int kSteps[][2] = { { 12, 20 }, { 20, 12 }, { 12, 60 }, { 60, 12 }, { 10, 150 }, { 150, 10 } };
+    static const uint32_t kPeriods[] = { 1000, 2000, 10000 };
+    bool ok = true;
+    printf("step response, samples to 63%% / 90%% (latency %u ms)\n", SMOOTH_LATENCY_MS);
+    printf("%-8s %-10s", "period", "step");
+    for (int f = 1; f < kFilterCount; f++) {
+        printf(" %14s", kSmoothModeNames[kFilters[f].mode]);
+    }
+    printf("\n");
+    for (uint32_t period : kPeriods) {
+        for (const auto &step : kSteps) {
+            char what[16];
+            snprintf(what, sizeof(what), "%d->%d", step[0], step[1]);
+            printf("%-8.0f %-10s", period / 1000.0, what);
+            for (int f = 1; f < kFilterCount; f++) {
+                int n63 = stepSamples(kFilters[f], period, step[0], step[1], 0.63);
+                int n90 = stepSamples(kFilters[f], period, step[0], step[1], 0.90);
+                printf(" %6d / %5d", n63, n90);
+                // The EMA is at 1 - (1 - a)^n after n samples
+                double a = (double)period / (SMOOTH_LATENCY_MS + period);
+                int ideal = (int)ceil(log(0.37) / log(1 - a));
+                if (kFilters[f].mode == SMOOTH_EMA && abs(n63 - ideal) > 1) {
+                    printf("\nFAIL ema: 63%% after %d samples, expected %d\n", n63, ideal);
+                    ok = false;
+                }
+                if (kFilters[f].mode == SMOOTH_KALMAN && abs(step[1] - step[0]) >= 40 && n90 > SMOOTH_CONFIRM + 1) {
+                    printf("\nFAIL kalman: a %s step took %d samples to 90%%\n", what, n90);
+                    ok = false;
+                }
+            }
+            printf("\n");
+        }
+    }
+    return ok;
+}
+
+static bool checkNoise() {
+    static const double kLevels[] = { 5, 12, 35, 100 };
+    static const uint32_t kPeriods[] = { 1000, 10000 };
+    bool ok = true;
+    printf("\nnoise, standard deviation of steady readings (ideal ema in brackets)\n");
+    printf("%-8s %-7s %8s %8s %8s %9s\n", "period", "level", "raw", "ema", "kalman", "restarts");
+    for (uint32_t period : kPeriods) {
+        for (double level : kLevels) {
+            double a = (double)period / (SMOOTH_LATENCY_MS + period);
+            double sum[kFilterCount] = {}, sq[kFilterCount] = {};
+            Smoother s[kFilterCount] = { Smoother(kFilters[0]), Smoother(kFilters[1]), Smoother(kFilters[2]) };
+            const int warmup = 200, n = 20000;
+            for (int i = 0; i < warmup + n; i++) {
+                Sample in = { i * period, noisy(level), level };
+                for (int f = 0; f < kFilterCount; f++) {
+                    double v = run(s[f], in);
+                    if (i >= warmup) {
+                        sum[f] += v;
+                        sq[f] += v * v;
+                    }
+                }
+            }
+            double sd[kFilterCount];
+            for (int f = 0; f < kFilterCount; f++) {
+                sd[f] = sqrt(fmax(0, sq[f] / n - (sum[f] / n) * (sum[f] / n)));
+            }
+            double ideal = sd[0] * sqrt(a / (2 - a));
+            printf("%-8.0f %-7.0f %8.2f %8.2f %8.2f %9u  (%.2f)\n", period / 1000.0, level, sd[0], sd[1], sd[2],
+                   s[2].resets(), ideal);
+            for (int f = 1; f < kFilterCount; f++) {
+                if (sd[f] > ideal * 1.25) {
+                    printf("FAIL %s: %.2f left at %.0f, ideal %.2f\n", kSmoothModeNames[kFilters[f].mode], sd[f], level,
+                           ideal);
+                    ok = false;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+// A day sampled every 2 s: clean air drifting around the "good" and
+// "moderate" boundary, then smoke arriving over a minute and clearing
+// over two hours
+static std::vector<Sample> syntheticTrace() {
+    std::vector<Sample> trace;
+    for (uint32_t ms = 0; ms < 86400000u; ms += 2000) {
+        double hour = ms / 3600000.0;
+        double level = 10 + 4 * sin(2 * M_PI * hour / 24);
+        if (hour >= 17 && hour < 17 + 1.0 / 60) {
+            level += 140 * (hour - 17) * 60;
+        } else if (hour >= 17 + 1.0 / 60 && hour < 19) {
+            level += 140 * (19 - hour) / (2 - 1.0 / 60);
+        }
+        trace.push_back({ ms, noisy(level), level });
+    }
+    return trace;
+}
+
+static bool loadTrace(const char *path, std::vector<Sample> &trace) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned ms, a, b, c;
+        if (line[0] != '#' && sscanf(line, "%u,%u,%u,%u", &ms, &a, &b, &c) == 4) {
+            trace.push_back({ ms, (int)b, -1 });
+        }
+    }
+    fclose(f);
+    return !trace.empty();
+}
+
+static int ledLevel(double pm25) {
+    return ledLevelFromAqi(aqiPm25((uint32_t)(fmax(0, pm25) * 10)));  // Truncated to tenths, as sent
+}
+
+static bool checkTrace(const std::vector<Sample> &trace, const char *name) {
+    bool ok = true;
+    printf("\n%s, %zu readings of pm2.5\n", name, trace.size());
+    printf("%-8s %10s %12s %12s %9s\n", "filter", "led steps", "mean change", "mean error", "restarts");
+    int rawSteps = 0;
+    for (int f = 0; f < kFilterCount; f++) {
+        Smoother s(kFilters[f]);
+        int steps = 0, level = -1;
+        double change = 0, error = 0, last = 0;
+        int known = 0;
+        for (size_t i = 0; i < trace.size(); i++) {
+            double v = run(s, trace[i]);
+            int l = ledLevel(v);
+            steps += level >= 0 && l != level;
+            level = l;
+            change += i ? fabs(v - last) : 0;
+            last = v;
+            if (trace[i].truth >= 0) {
+                error += fabs(v - trace[i].truth);
+                known++;
+            }
+        }
+        printf("%-8s %10d %12.2f", kSmoothModeNames[kFilters[f].mode], steps, change / trace.size());
+        if (known) {
+            printf(" %12.2f", error / known);
+        } else {
+            printf(" %12s", "-");
+        }
+        printf(" %9u\n", s.resets());
+        if (f == 0) {
+            rawSteps = steps;
+        } else if (steps > rawSteps) {
+            printf("FAIL %s: more category changes than the readings\n", kSmoothModeNames[kFilters[f].mode]);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    std::vector<Sample> trace;
+    if (argc > 1 && !loadTrace(argv[1], trace)) {
+        fprintf(stderr, "can't read a trace from %s\n", argv[1]);
+        return 2;
+    }
+    bool ok = checkSteps();
+    ok = checkNoise() && ok;
+    ok = checkTrace(argc > 1 ? trace : syntheticTrace(), argc > 1 ? argv[1] : "synthetic day") && ok;
+    return ok ? 0 : 1;
+}